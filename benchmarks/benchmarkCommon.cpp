@@ -0,0 +1,152 @@
+// The fixtures the benchmarks share, see benchmarkCommon.h.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "../include/meshProcessing.h"
+#include "benchmarkCommon.h"
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+using namespace std;
+
+const char *bundledModels[5] = {
+    "../models/Bunny.obj", "../models/Cat.obj", "../models/Dog.obj", "../models/Duck.obj", "../models/Tiger.obj"
+};
+
+const char *bundledImages[8] = {
+    "../models/TigerTexture.bmp", "../textures/grass.bmp", "../textures/nightSky.bmp", "../textures/IceRiver/posx.bmp",
+    "../textures/earth.bmp", "../textures/trees.bmp", "../textures/number1.bmp", "../textures/propellerMetal.bmp"
+};
+
+map<string, string> settings;
+
+double setting(const string& key, double defaultValue)
+{
+    auto found = settings.find(key);
+    return found == settings.end() ? defaultValue : atof(found->second.c_str());
+}
+
+double nowMilliseconds()
+{
+    using namespace std::chrono;
+    return duration<double, milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool loadSceneMesh(const string& fileName, Mesh& mesh)
+{
+    if (!loadMesh(fileName, mesh)) {
+        cout << "Cannot load " << fileName << endl;
+        return false;
+    }
+    weldMesh(mesh);
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    ComputeBoundingBox(mesh);
+    return true;
+}
+
+void writeSyntheticOBJ(const string& fileName, size_t triangleCount)
+{
+    auto side = (size_t)ceil(sqrt((double)triangleCount / 2.0));
+    FILE *file = fopen(fileName.c_str(), "wb");
+    vector<char> buffer(1 << 20);
+    size_t used = 0;
+    auto flush = [&] { fwrite(buffer.data(), 1, used, file); used = 0; };
+
+    fprintf(file, "# synthetic %zux%zu grid\n", side, side);
+    for (size_t z = 0; z <= side; z++) {
+        for (size_t x = 0; x <= side; x++) {
+            if (used > buffer.size() - 128) flush();
+            used += snprintf(buffer.data() + used, 128, "v %.4f %.4f %.4f\n",
+                             (double)x / side, sin((double)(x + z) * 0.01), (double)z / side);
+        }
+    }
+    for (size_t z = 0; z < side; z++) {
+        for (size_t x = 0; x < side; x++) {
+            if (used > buffer.size() - 128) flush();
+            size_t first = z * (side + 1) + x + 1;
+            used += snprintf(buffer.data() + used, 128, "f %zu %zu %zu %zu\n",
+                             first, first + 1, first + side + 2, first + side + 1);
+        }
+    }
+    flush();
+    fclose(file);
+}
+
+bool printComparison(const string& result, bool same, const string& reference)
+{
+    cout << result << (same ? " identical to " : " DIFFERENT from ") << reference << endl;
+    return same;
+}
+
+void createBenchmarkContext(int width, int height)
+{
+    int argc = 1;
+    char name[] = "benchmark";
+    char *argv[] = {name, nullptr};
+    glutInit(&argc, argv);
+    glutInitContextVersion(4, 3);
+    glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+    glutInitWindowSize(width, height);
+    glutCreateWindow("benchmark");
+    glutHideWindow();
+    glewExperimental = GL_TRUE;
+    glewInit();
+    cout << "GL renderer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << endl;
+
+    GLuint framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glViewport(0, 0, width, height);
+}
+
+void printFrameTimesHeader(const string& label, const string& columns)
+{
+    cout << left << setw(26) << label << right << setw(9) << "mean ms" << setw(9) << "median" << setw(9) << "p99"
+         << setw(9) << "max" << setw(8) << "spikes" << columns << endl;
+}
+
+void printFrameTimes(const string& label, vector<double> frameTimes, const string& columns)
+{
+    double sum = 0;
+    for (double time : frameTimes) sum += time;
+    sort(frameTimes.begin(), frameTimes.end());
+    double median = frameTimes[frameTimes.size() / 2];
+    size_t spikes = frameTimes.end() - upper_bound(frameTimes.begin(), frameTimes.end(), 2 * median);
+    cout << left << setw(26) << label << right << fixed << setprecision(2) << setw(9) << sum / frameTimes.size()
+         << setw(9) << median << setw(9) << frameTimes[frameTimes.size() * 99 / 100] << setw(9) << frameTimes.back()
+         << setw(8) << spikes << defaultfloat << columns << endl;
+}
+
+vector<unsigned char> readFrame(int width, int height)
+{
+    vector<unsigned char> pixels((size_t)width * height * 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+size_t countDifferentPixels(const vector<unsigned char>& a, const vector<unsigned char>& b, int tolerance)
+{
+    size_t different = 0;
+    for (size_t i = 0; i + 3 < a.size() && i + 3 < b.size(); i += 4)
+        for (int channel = 0; channel < 3; channel++)
+            if (abs(a[i + channel] - b[i + channel]) > tolerance) {
+                different++;
+                break;
+            }
+    return different;
+}
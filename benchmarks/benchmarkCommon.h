@@ -0,0 +1,105 @@
+#ifndef BENCHMARKCOMMON_H
+#define BENCHMARKCOMMON_H
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../include/mesh.h"
+
+/**
+ * A command line benchmark: times the code it covers against what it replaced and checks that both give the same
+ * results, printing a table of both.
+ */
+struct Benchmark
+{
+    const char *name;
+    bool (*run)(); // false if a check failed
+    bool opensWindow; // only run when named, it needs a display
+};
+
+// The benchmarks of each module, in the order they are run.
+std::vector<Benchmark> loaderBenchmarks();
+std::vector<Benchmark> meshBenchmarks();
+std::vector<Benchmark> textureBenchmarks();
+std::vector<Benchmark> drawBenchmarks();
+
+// Paths are relative to the build directory, same as in the viewer's setup().
+extern const char *bundledModels[5]; // bunny, cat, dog, duck, tiger, in the viewer's order
+extern const char *bundledImages[8];
+
+// "key=value" arguments given after the benchmark names.
+extern std::map<std::string, std::string> settings;
+
+/**
+ * Read a numeric benchmark setting.
+ * @param key The setting name, e.g. "faces" for "faces=50000000".
+ * @param defaultValue Returned if the setting was not given.
+ */
+double setting(const std::string& key, double defaultValue);
+
+double nowMilliseconds();
+
+/**
+ * Time a function, returning the best of several runs in milliseconds.
+ */
+template <typename Function>
+double bestTime(int runs, Function function)
+{
+    double best = 1e300;
+    for (int run = 0; run < runs; run++) {
+        double start = nowMilliseconds();
+        function();
+        best = std::min(best, nowMilliseconds() - start);
+    }
+    return best;
+}
+
+/**
+ * Load a model as the viewer does: welded, its faces reordered for the vertex cache and its vertices for fetch
+ * locality, centred on its bounding box. Normals are left to be computed on demand.
+ * @return false if the file cannot be loaded, which is printed.
+ */
+bool loadSceneMesh(const std::string& fileName, Mesh& mesh);
+
+/**
+ * Write a square grid of quads as an OBJ file, each quad being one "f" record of 4 vertices.
+ * @param triangleCount Approximate number of triangles after fan triangulation.
+ */
+void writeSyntheticOBJ(const std::string& fileName, size_t triangleCount);
+
+/**
+ * Print the outcome of comparing a result with its reference, e.g. "vertex normals identical to the original".
+ * @return same, to be folded into the benchmark's result.
+ */
+bool printComparison(const std::string& result, bool same, const std::string& reference);
+
+/**
+ * Open a hidden GLUT window for the GL benchmarks and render into a framebuffer object of the given size,
+ * so frames do not wait for the display. Headless, run under e.g. "LIBGL_ALWAYS_SOFTWARE=1 xvfb-run" for llvmpipe.
+ */
+void createBenchmarkContext(int width, int height);
+
+/**
+ * Print the header of printFrameTimes()'s columns, followed by any further columns.
+ */
+void printFrameTimesHeader(const std::string& label, const std::string& columns = "");
+
+/**
+ * Print mean, median, 99th percentile and worst frame time, and how many frames took over twice the median,
+ * followed by any further columns.
+ */
+void printFrameTimes(const std::string& label, std::vector<double> frameTimes, const std::string& columns = "");
+
+/**
+ * Read the RGBA pixels of the framebuffer of createBenchmarkContext().
+ */
+std::vector<unsigned char> readFrame(int width, int height);
+
+/**
+ * Count the pixels of two frames of readFrame() whose color differs by more than tolerance in a channel.
+ */
+size_t countDifferentPixels(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tolerance = 0);
+
+#endif
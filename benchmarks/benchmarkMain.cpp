@@ -0,0 +1,55 @@
+// Command line benchmarks for the asset pipeline and the drawing code, e.g. "benchmarks objparser faces=50000000".
+// Run from the build directory, where the viewer runs, so that the bundled models and textures are found.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmarkCommon.h"
+
+using namespace std;
+
+/**
+ * Run the benchmarks named on the command line, or all of those that open no window if none is named.
+ * @param argv Benchmark names and "key=value" settings.
+ * @return Non-zero if a benchmark name is unknown or a check failed.
+ */
+int main(int argc, char **argv)
+{
+    vector<Benchmark> benchmarks;
+    for (auto module : {loaderBenchmarks, meshBenchmarks, textureBenchmarks, drawBenchmarks}) {
+        vector<Benchmark> added = module();
+        benchmarks.insert(benchmarks.end(), added.begin(), added.end());
+    }
+
+    vector<string> names;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        if (equals == string::npos) names.push_back(argument);
+        else settings[argument.substr(0, equals)] = argument.substr(equals + 1);
+    }
+    for (const string& name : names) {
+        bool known = false;
+        for (const Benchmark& benchmark : benchmarks) known = known || name == benchmark.name;
+        if (!known) {
+            cout << "Unknown benchmark: " << name << ". Available:";
+            for (const Benchmark& benchmark : benchmarks) cout << " " << benchmark.name;
+            cout << endl;
+            return 1;
+        }
+    }
+
+    bool passed = true;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (names.empty() ? benchmark.opensWindow : find(names.begin(), names.end(), benchmark.name) == names.end()) continue;
+        cout << "== " << benchmark.name << endl;
+        if (!benchmark.run()) {
+            cout << "!! " << benchmark.name << " failed its checks" << endl;
+            passed = false;
+        }
+        cout << endl;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,422 @@
+// Benchmarks of drawing the models in a hidden window: meshlet culling, vertex buffers and instancing.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/meshBuffers.h"
+#include "../include/meshEmission.h"
+#include "../include/meshInstances.h"
+#include "../include/meshLod.h"
+#include "../include/meshlet.h"
+#include "../include/meshProcessing.h"
+#include "benchmarkCommon.h"
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Frame times of drawing the tiger and the bunny with their meshlets culled against the view and without, with
+ * GL_CULL_FACE on so that meshlets facing away are culled too: "copies" rotated copies of the model (default 32) stand
+ * on a ring around the camera, which turns once over "frames" frames (default 180), and every copy is drawn with the
+ * smooth shaded loop of drawMesh(). Reports the triangles submitted and seen per frame and the time of culling, and
+ * compares the last frame of both ways. Also reports the ACMR of a 16 entry FIFO cache before and after building the
+ * meshlets.
+ */
+bool benchmarkMeshlets()
+{
+    const int width = 800, height = 800;
+    auto frameCount = (int)setting("frames", 180);
+    auto copies = (int)setting("copies", 32);
+    createBenchmarkContext(width, height);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(70.0, 1.0, 0.1, 200.0);
+    glMatrixMode(GL_MODELVIEW);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_COLOR_MATERIAL);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+    glEnable(GL_CULL_FACE); // so that meshlets facing away may be culled too
+
+    bool passed = true;
+    for (const char *model : {"../models/Tiger.obj", "../models/Bunny.obj"}) {
+        Mesh mesh;
+        if (!loadSceneMesh(model, mesh)) return false;
+        vector<Meshlet> meshlets;
+        double acmrBefore = analyzeVertexCache(mesh).acmr;
+        double buildTime = bestTime(1, [&] { buildMeshlets(mesh, meshlets); });
+        requireVertexNormals(mesh);
+        cout << model << ": " << mesh.faceCount << " triangles in " << meshlets.size() << " meshlets, built in "
+             << buildTime << " ms" << endl;
+        // each meshlet loads its vertices at least once, whatever the order within it
+        size_t meshletVertices = 0;
+        for (const Meshlet& meshlet : meshlets) meshletVertices += meshlet.vertexCount;
+        cout << fixed << setprecision(3) << "ACMR " << acmrBefore << " before the meshlets, "
+             << analyzeVertexCache(mesh).acmr << " after (" << (double)meshletVertices / mesh.faceCount
+             << " if each meshlet loaded its vertices once)" << defaultfloat << endl;
+        ostringstream header;
+        header << setw(12) << "submitted" << setw(8) << "seen" << setw(10) << "cull ms";
+        printFrameTimesHeader("", header.str());
+
+        vector<unsigned char> pixels[2];
+        vector<pair<size_t, size_t>> ranges;
+        for (int culling = 0; culling < 2; culling++) {
+            vector<double> frameTimes;
+            double submitted = 0.0, seen = 0.0, cullTime = 0.0;
+            for (int frame = 0; frame < frameCount; frame++) {
+                auto start = chrono::steady_clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glLoadIdentity();
+                glRotatef(360.0f * frame / frameCount, 0.0f, 1.0f, 0.0f);
+                for (int i = 0; i < copies; i++) {
+                    glPushMatrix();
+                    float angle = 2.0f * (float)M_PI * i / copies;
+                    glTranslatef(12.0f * sinf(angle), 0.0f, -12.0f * cosf(angle));
+                    glRotatef(97.0f * i, 0.3f, 1.0f, 0.2f);
+                    glScalef(4.0f / mesh.diagonalLength, 4.0f / mesh.diagonalLength, 4.0f / mesh.diagonalLength);
+
+                    ranges.assign(1, make_pair((size_t)0, mesh.faceCount));
+                    if (culling) {
+                        double cullStart = nowMilliseconds();
+                        float modelview[16], projection[16];
+                        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+                        glGetFloatv(GL_PROJECTION_MATRIX, projection);
+                        MeshletView view;
+                        meshletViewFromMatrices(modelview, projection, view);
+                        view.backFacesCulled = true;
+                        cullMeshlets(meshlets, view, ranges);
+                        cullTime += nowMilliseconds() - cullStart;
+                        for (const auto& range : ranges) seen += countVisibleFaces(mesh, range.first, range.second, view);
+                    }
+                    glBegin(GL_TRIANGLES);
+                    for (const auto& range : ranges) {
+                        submitted += range.second;
+                        for (size_t corner = range.first * 3; corner < (range.first + range.second) * 3; corner++) {
+                            glNormal3fv(mesh.vertexNormals + mesh.faces[corner] * 3);
+                            glVertex3fv(mesh.positions + mesh.faces[corner] * 3);
+                        }
+                    }
+                    glEnd();
+                    glPopMatrix();
+                }
+                glFinish();
+                frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+            }
+            pixels[culling] = readFrame(width, height);
+            ostringstream columns;
+            columns << fixed << setprecision(0) << setw(12) << submitted / frameCount;
+            if (culling) columns << setw(8) << seen / frameCount << setprecision(3) << setw(10) << cullTime / frameCount;
+            printFrameTimes(culling ? "meshlets culled" : "every triangle", frameTimes, columns.str());
+        }
+
+        // culling only drops faces that GL_CULL_FACE or the frustum drops too
+        size_t different = countDifferentPixels(pixels[0], pixels[1]);
+        cout << "pixels differing between the last frames: " << different << endl;
+        if (different > (size_t)width * height / 1000) passed = false;
+    }
+    if (glGetError() != GL_NO_ERROR) passed = false;
+    return passed;
+}
+
+/**
+ * Frame times of drawing the tiger and the bunny in immediate mode, as drawMesh() does with "--immediate-mode", and
+ * from MeshBuffers, smooth and flat shaded: "copies" copies (default 32) on a ring around the camera, which turns
+ * once over "frames" frames (default 180). Reports the upload time and size of the buffers and the vertices added
+ * for flat shading, and compares the last frame of both ways, which the directional light makes the same.
+ */
+bool benchmarkBuffers()
+{
+    const int width = 800, height = 800;
+    auto frameCount = (int)setting("frames", 180);
+    auto copies = (int)setting("copies", 32);
+    createBenchmarkContext(width, height);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(70.0, 1.0, 0.1, 200.0);
+    glMatrixMode(GL_MODELVIEW);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_COLOR_MATERIAL);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+
+    bool passed = true;
+    for (const char *model : {"../models/Tiger.obj", "../models/Bunny.obj"}) {
+        Mesh mesh;
+        if (!loadSceneMesh(model, mesh)) return false;
+        const float *faceNormals = requireFaceNormals(mesh), *vertexNormals = requireVertexNormals(mesh);
+        bool hasTexture = mesh.hasTextureCoordinates();
+        cout << model << ": " << mesh.vertexCount << " vertices, " << mesh.faceCount << " triangles" << endl;
+        ostringstream header;
+        header << setw(11) << "upload ms" << setw(9) << "KB" << setw(10) << "vertices";
+        printFrameTimesHeader("", header.str());
+
+        vector<pair<size_t, size_t>> ranges(1, make_pair((size_t)0, mesh.faceCount));
+        for (int flat = 0; flat < 2; flat++) {
+            glShadeModel(flat ? GL_FLAT : GL_SMOOTH);
+            vector<unsigned char> pixels[2];
+            for (int retained = 0; retained < 2; retained++) {
+                MeshBuffers buffers;
+                double uploadTime = 0.0;
+                if (retained) {
+                    uploadTime = bestTime(1, [&] {
+                        if (!buffers.create(mesh, flat != 0)) passed = false;
+                        glFinish();
+                    });
+                    if (!buffers.created()) {
+                        cout << "vertex array objects are not supported" << endl;
+                        return false;
+                    }
+                }
+                vector<double> frameTimes;
+                for (int frame = 0; frame < frameCount; frame++) {
+                    auto start = chrono::steady_clock::now();
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glLoadIdentity();
+                    glRotatef(360.0f * frame / frameCount, 0.0f, 1.0f, 0.0f);
+                    for (int copy = 0; copy < copies; copy++) {
+                        glPushMatrix();
+                        float angle = 2.0f * (float)M_PI * copy / copies;
+                        glTranslatef(12.0f * sinf(angle), 0.0f, -12.0f * cosf(angle));
+                        glRotatef(97.0f * copy, 0.3f, 1.0f, 0.2f);
+                        glScalef(4.0f / mesh.diagonalLength, 4.0f / mesh.diagonalLength, 4.0f / mesh.diagonalLength);
+                        if (retained) buffers.draw(ranges);
+                        else {
+                            glBegin(GL_TRIANGLES);
+                            for (size_t i = 0; i < mesh.faceCount * 3; i += 3) {
+                                if (flat) glNormal3fv(faceNormals + i);
+                                for (size_t corner = i; corner < i + 3; corner++) {
+                                    if (!flat) glNormal3fv(vertexNormals + mesh.faces[corner] * 3);
+                                    if (hasTexture) glTexCoord2fv(mesh.textureCoordinates + mesh.faces[corner] * 2);
+                                    glVertex3fv(mesh.positions + mesh.faces[corner] * 3);
+                                }
+                            }
+                            glEnd();
+                        }
+                        glPopMatrix();
+                    }
+                    glFinish();
+                    frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                }
+                pixels[retained] = readFrame(width, height);
+                ostringstream columns;
+                if (retained)
+                    columns << fixed << setprecision(2) << setw(11) << uploadTime << setprecision(0) << setw(9)
+                            << buffers.bytes() / 1024.0 << setw(10) << buffers.vertexCount();
+                printFrameTimes(string(flat ? "flat" : "smooth") + (retained ? ", buffers" : ", immediate"), frameTimes,
+                                columns.str());
+                buffers.destroy();
+            }
+
+            size_t different = countDifferentPixels(pixels[0], pixels[1]);
+            cout << "pixels differing between the last frames: " << different << endl;
+            if (different > (size_t)width * height / 1000) passed = false;
+        }
+    }
+    if (glGetError() != GL_NO_ERROR) passed = false;
+    return passed;
+}
+
+// A sink of emitMeshTriangles() sending the corners of a mesh to glBegin(GL_TRIANGLES), as drawMesh() does.
+struct ImmediateSink
+{
+    const float *positions, *normals, *textureCoordinates;
+
+    void faceNormal(size_t face) { glNormal3fv(normals + face * 3); }
+    void vertexNormal(size_t vertex) { glNormal3fv(normals + vertex * 3); }
+    void textureCoordinate(size_t vertex) { glTexCoord2fv(textureCoordinates + vertex * 2); }
+    void vertex(size_t vertex) { glVertex3fv(positions + vertex * 3); }
+};
+
+/**
+ * Frame times of a stress scene: "counts" copies (default 10,100,1000,10000,100000) of the bundled models, placed
+ * as drawScene() places them, scattered over the 200 unit field and seen from above one of its edges. Each frame
+ * culls the copies against the view and sorts them into levels of detail, then draws them one at a time in
+ * immediate mode as drawMesh() would (up to "percopy" copies, default 10000), with InstanceBatcher and with
+ * InstancedMeshRenderer. Prints the median of "frames" frames (default 5) and a chart of them.
+ */
+bool benchmarkInstances()
+{
+    const int width = 800, height = 800;
+    const float fieldOfView = 60.0f;
+    auto frameCount = (int)setting("frames", 5);
+    auto perCopyLimit = (size_t)setting("percopy", 10000);
+    vector<size_t> counts;
+    istringstream countList(settings.count("counts") ? settings["counts"] : "10,100,1000,10000,100000");
+    for (string count; getline(countList, count, ',');) counts.push_back((size_t)atof(count.c_str()));
+    createBenchmarkContext(width, height);
+
+    // the scene's light and camera, which like the viewer's lives in the projection matrix
+    float lightAmbient[] = {0.0f, 0.0f, 0.0f, 1.0f}, light[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float lightPosition[] = {-20.0f, 20.0f, 20.0f, 0.0f}, globalAmbient[] = {0.2f, 0.2f, 0.2f, 1.0f};
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glLightfv(GL_LIGHT0, GL_AMBIENT, lightAmbient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, light);
+    glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbient);
+    glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+    glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, GL_TRUE);
+    glLightModeli(GL_LIGHT_MODEL_COLOR_CONTROL, GL_SEPARATE_SPECULAR_COLOR);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_NORMALIZE);
+    gluPerspective(fieldOfView, 1.0, 0.1, 500.0);
+    gluLookAt(0.0, 12.0, 115.0, 0.0, 0.0, 40.0, 0.0, 1.0, 0.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    float specular[] = {1.0f, 1.0f, 1.0f, 1.0f}, shininess[] = {50.0f};
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+    MeshletView view;
+    float modelview[16], projection[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    meshletViewFromMatrices(modelview, projection, view);
+
+    // the models as drawScene() places them: bunny, cat, dog, duck, tiger
+    const float sizes[] = {10.0f, 10.0f, 10.0f, 10.0f, 20.0f}, heights[] = {3.0f, 5.0f, 5.0f, 3.0f, 5.0f};
+    const float rotations[][3] = {{0.0f, 0.0f, 0.0f}, {-90.0f, 0.0f, 60.0f}, {-90.0f, 0.0f, 30.0f}, {-90.0f, 0.0f, 0.0f},
+                                  {-90.0f, 0.0f, 115.0f}};
+    const float colors[][3] = {{1.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+    const bool flatShaded[] = {false, true, true, false, false};
+    const int modelCount = 5;
+    Mesh meshes[modelCount];
+    vector<MeshLod> lodsOf[modelCount];
+    MeshBuffers buffersOf[modelCount][MESH_MAX_LODS];
+    vector<ScatteredModel> models;
+    for (int i = 0; i < modelCount; i++) {
+        if (!loadSceneMesh(bundledModels[i], meshes[i])) return false;
+        buildMeshLods(meshes[i], lodsOf[i]);
+        ScatteredModel model = {sizes[i] / meshes[i].diagonalLength, {rotations[i][0], rotations[i][1], rotations[i][2]},
+                                heights[i], {colors[i][0], colors[i][1], colors[i][2]}, flatShaded[i]};
+        models.push_back(model);
+    }
+    auto meshOf = [&](int model, int level) -> Mesh& { return level ? lodsOf[model][level - 1].mesh : meshes[model]; };
+
+    InstancedMeshRenderer renderer;
+    if (!renderer.create()) {
+        cout << "instanced drawing is not supported" << endl;
+        return false;
+    }
+    InstanceBatcher batcher;
+    vector<vector<MeshInstance>> instancesOf, levels[modelCount];
+    const char *ways[] = {"per copy", "batched", "instanced"};
+    vector<vector<double>> medians(counts.size(), vector<double>(3, 0.0)), submitMedians = medians;
+    cout << "median ms per frame (to submit it)" << endl;
+    cout << setw(10) << "copies" << setw(10) << "drawn" << setw(12) << "triangles" << setw(18) << "per copy" << setw(18)
+         << "batched" << setw(18) << "instanced" << endl;
+    for (size_t c = 0; c < counts.size(); c++) {
+        scatterInstances(models, counts[c], 200.0f, 1, instancesOf);
+        size_t drawn = 0, triangles = 0;
+        for (int way = 0; way < 3; way++) {
+            if (way == 0 && counts[c] > perCopyLimit) continue;
+            vector<double> frameTimes, submitTimes;
+            for (int frame = 0; frame <= frameCount; frame++) { // frame 0 uploads the buffers and is not counted
+                auto start = chrono::steady_clock::now();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                drawn = triangles = 0;
+                for (int model = 0; model < modelCount; model++) {
+                    drawn += sortInstancesByLod(instancesOf[model], lodsOf[model], meshes[model].diagonalLength * 0.5f,
+                                                view, fieldOfView, height, 1.0f, levels[model]);
+                    for (int level = 0; level < (int)levels[model].size(); level++) {
+                        const vector<MeshInstance>& instances = levels[model][level];
+                        Mesh& mesh = meshOf(model, level);
+                        triangles += instances.size() * mesh.faceCount;
+                        if (instances.empty()) continue;
+                        if (way == 0) {
+                            bool flat = flatShaded[model];
+                            ImmediateSink sink = {mesh.positions, flat ? requireFaceNormals(mesh) : requireVertexNormals(mesh),
+                                                  mesh.textureCoordinates};
+                            vector<pair<size_t, size_t>> allFaces(1, make_pair((size_t)0, mesh.faceCount));
+                            glShadeModel(flat ? GL_FLAT : GL_SMOOTH);
+                            for (const MeshInstance& instance : instances) {
+                                float color[] = {instance.color[0], instance.color[1], instance.color[2], 1.0f};
+                                glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+                                glPushMatrix();
+                                glMultMatrixf(instance.transform);
+                                glBegin(GL_TRIANGLES);
+                                emitMeshTriangles(flat, mesh.hasTextureCoordinates(), mesh.faces, allFaces, sink);
+                                glEnd();
+                                glPopMatrix();
+                            }
+                        }
+                        else if (way == 1) batcher.draw(mesh, instances);
+                        else {
+                            MeshBuffers& buffers = buffersOf[model][level];
+                            if (!buffers.created()) buffers.create(mesh, false);
+                            renderer.draw(buffers, instances);
+                        }
+                    }
+                }
+                double submitTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                glFinish();
+                if (frame) {
+                    frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                    submitTimes.push_back(submitTime);
+                }
+            }
+            sort(frameTimes.begin(), frameTimes.end());
+            sort(submitTimes.begin(), submitTimes.end());
+            medians[c][way] = frameTimes[frameTimes.size() / 2];
+            submitMedians[c][way] = submitTimes[submitTimes.size() / 2];
+        }
+        cout << setw(10) << counts[c] << setw(10) << drawn << setw(12) << triangles << fixed << setprecision(1);
+        for (int way = 0; way < 3; way++) {
+            ostringstream times;
+            if (medians[c][way] > 0.0)
+                times << fixed << setprecision(1) << medians[c][way] << " (" << submitMedians[c][way] << ")";
+            else times << "-";
+            cout << setw(18) << times.str();
+        }
+        cout << defaultfloat << endl;
+    }
+
+    // frame time against copies, bars on a log scale from 1 ms to the slowest frame
+    double slowest = 1.0;
+    for (const auto& row : medians)
+        for (double median : row) slowest = max(slowest, median);
+    cout << "frame time (log scale, 1 to " << fixed << setprecision(0) << slowest << " ms)" << defaultfloat << endl;
+    for (size_t c = 0; c < counts.size(); c++)
+        for (int way = 0; way < 3; way++) {
+            if (medians[c][way] <= 0.0) continue;
+            auto bar = (int)lround(50.0 * log(max(medians[c][way], 1.0)) / max(log(slowest), 1e-9));
+            cout << setw(8) << (way == 1 ? to_string(counts[c]) : "") << " " << left << setw(10) << ways[way] << right
+                 << "|" << string((size_t)bar, '#') << " " << fixed << setprecision(1) << medians[c][way] << defaultfloat
+                 << endl;
+        }
+
+    for (auto& levels : buffersOf)
+        for (MeshBuffers& buffers : levels) buffers.destroy();
+    renderer.destroy();
+    return glGetError() == GL_NO_ERROR;
+}
+
+} // namespace
+
+vector<Benchmark> drawBenchmarks()
+{
+    return {
+        {"meshlets", benchmarkMeshlets, true},
+        {"buffers", benchmarkBuffers, true},
+        {"instances", benchmarkInstances, true},
+    };
+}
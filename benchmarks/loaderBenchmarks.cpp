@@ -0,0 +1,377 @@
+// Benchmarks of the model importers: the OBJ parsers, PLY files and streaming under a memory budget.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/mappedFile.h"
+#include "../include/meshProcessing.h"
+#include "../include/objLoader.h"
+#include "../include/plyLoader.h"
+#include "benchmarkCommon.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/**
+ * The original getline/istringstream OBJ loader, kept as the reference for comparisons.
+ */
+void loadOBJReference(const std::string& fileName, vector<float>& vertices, vector<float>& textureCoordinates, vector<int>& faces)
+{
+    vertices.clear();
+    faces.clear();
+    textureCoordinates.clear();
+
+    std::string line;
+    int count, vertexIndex1, vertexIndex2, vertexIndex3;
+    float coordinateValue;
+    char currentCharacter, previousCharacter;
+
+    std::ifstream inFile(fileName.c_str(), std::ifstream::in);
+    while (getline(inFile, line))
+    {
+        if (line.substr(0, 2) == "v ")
+        {
+            std::istringstream currentString(line.substr(2));
+            for (count = 1; count <= 3; count++)
+            {
+                currentString >> coordinateValue;
+                vertices.push_back(coordinateValue);
+            }
+        }
+        else if (line.substr(0, 2) == "f ")
+        {
+            std::istringstream currentString(line.substr(2));
+            previousCharacter = ' ';
+            count = 0;
+            while (currentString.get(currentCharacter))
+            {
+                if ((previousCharacter == '#') || (currentCharacter == '#')) break;
+                if ((previousCharacter == ' ') && (currentCharacter != ' '))
+                {
+                    currentString.unget();
+                    if (count == 0)
+                    {
+                        currentString >> vertexIndex1;
+                        vertexIndex1--;
+                        count++;
+                    }
+                    else if (count == 1)
+                    {
+                        currentString >> vertexIndex2;
+                        vertexIndex2--;
+                        count++;
+                    }
+                    else if (count == 2)
+                    {
+                        currentString >> vertexIndex3;
+                        vertexIndex3--;
+                        count++;
+                        faces.push_back(vertexIndex1);
+                        faces.push_back(vertexIndex2);
+                        faces.push_back(vertexIndex3);
+                    }
+                    else
+                    {
+                        vertexIndex2 = vertexIndex3;
+                        currentString >> vertexIndex3;
+                        vertexIndex3--;
+                        faces.push_back(vertexIndex1);
+                        faces.push_back(vertexIndex2);
+                        faces.push_back(vertexIndex3);
+                    }
+                    currentString.get(previousCharacter);
+                }
+                else previousCharacter = currentCharacter;
+            }
+        }
+        else if (line.substr(0, 3) == "vt ") {
+            std::istringstream currentString(line.substr(3));
+            for (count = 1; count <= 2; count++)
+            {
+                currentString >> coordinateValue;
+                textureCoordinates.push_back(coordinateValue);
+            }
+        }
+    }
+    inFile.close();
+}
+
+// Largest absolute difference of two float arrays, infinity if their sizes differ.
+float maxDifference(const vector<float>& a, const vector<float>& b)
+{
+    if (a.size() != b.size()) return INFINITY;
+    float result = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) result = max(result, fabs(a[i] - b[i]));
+    return result;
+}
+
+/**
+ * Compare load time of the original stream based OBJ loader and the mapped in-place parser.
+ */
+bool benchmarkOBJParser()
+{
+    bool passed = true;
+    cout << left << setw(22) << "model" << right << setw(10) << "faces"
+         << setw(14) << "stream ms" << setw(14) << "mapped ms" << setw(10) << "speedup" << setw(14) << "max diff" << endl;
+    for (const char *model : bundledModels) {
+        vector<float> referenceVertices, referenceTextureCoordinates, vertices, textureCoordinates;
+        vector<int> referenceFaces, faces;
+
+        double streamTime = bestTime(5, [&] { loadOBJReference(model, referenceVertices, referenceTextureCoordinates, referenceFaces); });
+        double mappedTime = bestTime(5, [&] { loadOBJFile(model, vertices, textureCoordinates, faces); });
+
+        float difference = max(maxDifference(referenceVertices, vertices),
+                               maxDifference(referenceTextureCoordinates, textureCoordinates));
+        bool same = referenceFaces == faces && difference == 0.0f;
+        passed = passed && same && !faces.empty();
+
+        cout << left << setw(22) << model << right << setw(10) << faces.size() / 3
+             << fixed << setprecision(3) << setw(14) << streamTime << setw(14) << mappedTime
+             << setprecision(1) << setw(9) << streamTime / mappedTime << "x"
+             << scientific << setprecision(2) << setw(14) << difference << defaultfloat
+             << (same ? "" : "  MISMATCH") << endl;
+    }
+    return passed;
+}
+/**
+ * Check that chunked parallel parsing matches serial parsing, and time it on a synthetic mesh
+ * for 1 up to the number of cores threads. Settings: faces (synthetic triangle count).
+ */
+bool benchmarkOBJParallel()
+{
+    bool passed = true;
+    for (const char *model : bundledModels) {
+        MappedFile file(model);
+        vector<float> serialVertices, serialTextureCoordinates, vertices, textureCoordinates;
+        vector<int> serialFaces, faces;
+        parseOBJ(file.data(), file.data() + file.size(), serialVertices, serialTextureCoordinates, serialFaces);
+        // deliberately more chunks than cores so that small files are split too
+        for (unsigned int threads : {2u, 3u, 8u, 31u}) {
+            parseOBJParallel(file.data(), file.data() + file.size(), threads, vertices, textureCoordinates, faces);
+            bool same = vertices == serialVertices && textureCoordinates == serialTextureCoordinates && faces == serialFaces;
+            if (!same) cout << model << ": " << threads << " chunks differ from the serial result" << endl;
+            passed = passed && same;
+        }
+    }
+    printComparison("bundled models: parallel output", passed, "serial output");
+
+    auto triangleCount = (size_t)setting("faces", 2000000);
+    const string fileName = "synthetic_benchmark.obj";
+    double start = nowMilliseconds();
+    writeSyntheticOBJ(fileName, triangleCount);
+    cout << "wrote " << fileName << " in " << fixed << setprecision(0) << nowMilliseconds() - start << " ms" << endl;
+
+    MappedFile file(fileName);
+    cout << "synthetic mesh: " << file.size() / (1 << 20) << " MB" << endl;
+    cout << setw(10) << "threads" << setw(12) << "ms" << setw(12) << "MB/s" << setw(10) << "speedup" << endl;
+    vector<float> vertices, textureCoordinates;
+    vector<int> faces;
+    double serialTime = 0.0;
+    unsigned int cores = max(1u, thread::hardware_concurrency());
+    for (unsigned int threads = 1; ; threads = min(threads * 2, cores)) {
+        double time = bestTime(3, [&] { parseOBJParallel(file.data(), file.data() + file.size(), threads, vertices, textureCoordinates, faces); });
+        if (threads == 1) serialTime = time;
+        cout << setw(10) << threads << fixed << setprecision(1) << setw(12) << time
+             << setw(12) << file.size() / 1048576.0 / (time / 1000.0)
+             << setprecision(2) << setw(9) << serialTime / time << "x" << endl;
+        if (threads == cores) break;
+    }
+    cout << defaultfloat << "parsed " << faces.size() / 3 << " triangles" << endl;
+    file.close();
+    remove(fileName.c_str());
+    return passed;
+}
+
+/**
+ * Compare load throughput of the OBJ and binary PLY versions of the same models. The PLY files are
+ * written from the parsed OBJ data, with and without texture coordinates, and checked to load back identically.
+ * Also checks that files with more faces than their data holds or face indices past their vertices are rejected.
+ */
+bool benchmarkPLY()
+{
+    bool passed = true;
+    cout << left << setw(28) << "file" << right << setw(10) << "KB" << setw(10) << "ms"
+         << setw(10) << "MB/s" << setw(14) << "Mtri/s" << endl;
+    for (const char *model : {"../models/Bunny.obj", "../models/Tiger.obj"}) {
+        vector<float> vertices, textureCoordinates, plyVertices, plyTextureCoordinates;
+        vector<int> faces, plyFaces;
+        string plyFileName = string(model).substr(string(model).find_last_of('/') + 1) + ".ply";
+
+        double objTime = bestTime(10, [&] { loadOBJFile(model, vertices, textureCoordinates, faces, 1); });
+        if (!writePLYFile(plyFileName, vertices, textureCoordinates, faces)) {
+            cout << "cannot write " << plyFileName << endl;
+            return false;
+        }
+        double plyTime = bestTime(10, [&] { loadPLYFile(plyFileName, plyVertices, plyTextureCoordinates, plyFaces); });
+        bool same = plyVertices == vertices && plyTextureCoordinates == textureCoordinates && plyFaces == faces;
+        passed = passed && same;
+
+        size_t triangles = faces.size() / 3;
+        for (int format = 0; format < 2; format++) {
+            string fileName = format == 0 ? string(model) : plyFileName;
+            double time = format == 0 ? objTime : plyTime;
+            MappedFile file(fileName);
+            cout << left << setw(28) << fileName << right << setw(10) << file.size() / 1024
+                 << fixed << setprecision(3) << setw(10) << time << setprecision(1)
+                 << setw(10) << file.size() / 1048576.0 / (time / 1000.0)
+                 << setprecision(2) << setw(14) << triangles / (time / 1000.0) / 1e6
+                 << (format == 1 && !same ? "  MISMATCH" : "") << endl;
+        }
+        cout << defaultfloat << "  PLY loads " << setprecision(3) << objTime / plyTime << "x faster" << endl;
+        remove(plyFileName.c_str());
+    }
+
+    // malformed files are rejected: a face count the data cannot hold, and a face index past the vertices
+    const char *header = "ply\nformat binary_little_endian 1.0\nelement vertex 3\nproperty float x\nproperty float y\n"
+                         "property float z\nelement face %s\nproperty list uchar int vertex_indices\nend_header\n";
+    const float triangle[9] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+    const int indices[2][3] = {{0, 1, 2}, {0, 1, 3}};
+    const char *counts[2] = {"4000000000000", "1"};
+    for (int malformed = 0; malformed < 2; malformed++) {
+        const char *fileName = "malformed.ply";
+        FILE *file = fopen(fileName, "wb");
+        if (!file) return false;
+        fprintf(file, header, counts[malformed]);
+        fwrite(triangle, sizeof(triangle), 1, file);
+        fputc(3, file);
+        fwrite(indices[malformed], sizeof(indices[malformed]), 1, file);
+        fclose(file);
+        vector<float> vertices, textureCoordinates;
+        vector<int> faces;
+        bool rejected = !loadPLYFile(fileName, vertices, textureCoordinates, faces) && faces.empty();
+        passed = passed && rejected;
+        cout << (malformed == 0 ? "face count past the end of the file: " : "face index past the vertices: ")
+             << (rejected ? "rejected" : "NOT REJECTED") << endl;
+        remove(fileName);
+    }
+    return passed;
+}
+
+/**
+ * Peak resident memory of this process in MB since the last resetPeakMemory().
+ */
+double peakMemoryMB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1048576.0;
+#else
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0) return atof(line.c_str() + 6) / 1024.0;
+    return 0.0;
+#endif
+}
+
+/**
+ * Restart peak memory tracking (Linux only, elsewhere the peak covers the whole process lifetime).
+ * @return false if the peak could not be reset.
+ */
+bool resetPeakMemory()
+{
+#ifdef _WIN32
+    return false;
+#else
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    return (bool)clearRefs;
+#endif
+}
+
+/**
+ * Check that streaming matches the in-memory loader on the bundled models, then stream a synthetic
+ * mesh under a memory budget and compare its peak memory with loading it in memory. Fails if the peak memory of the
+ * process while streaming exceeds the budget.
+ * Settings: faces (synthetic triangle count), budget (streaming memory budget in MB), inmemory (0 skips loading the
+ * synthetic mesh in memory, which a multi-GB file may not fit).
+ */
+bool benchmarkOBJStream()
+{
+    bool passed = true;
+    for (const char *model : bundledModels) {
+        Mesh inMemory;
+        loadOBJFile(model, inMemory);
+        ComputeFaceNormals(inMemory);
+        StreamedMesh mesh;
+        // a tiny budget so that the read window and vertex cache are exercised on these small files
+        bool loaded = streamOBJFile(model, 0, mesh);
+        bool same = loaded && mesh.vertexCount == inMemory.vertexCount && mesh.triangleCount == inMemory.faceCount &&
+                    mesh.textureCoordinateCount == inMemory.textureCoordinateCount &&
+                    memcmp(mesh.vertices.data(), inMemory.positions, inMemory.vertexCount * 12) == 0 &&
+                    memcmp(mesh.faces.data(), inMemory.faces, inMemory.faceCount * 12) == 0 &&
+                    (!inMemory.hasTextureCoordinates() ||
+                     memcmp(mesh.textureCoordinates.data(), inMemory.textureCoordinates, inMemory.textureCoordinateCount * 8) == 0) &&
+                    memcmp(mesh.faceNormals.data(), inMemory.faceNormals, inMemory.faceCount * 12) == 0;
+        if (!same) cout << model << ": streamed mesh differs from loadOBJFile + ComputeFaceNormals" << endl;
+        passed = passed && same;
+    }
+    printComparison("bundled models: streamed output", passed, "in-memory output");
+
+    auto triangleCount = (size_t)setting("faces", 2000000);
+    auto budget = (size_t)(setting("budget", 64) * 1048576.0);
+    const string fileName = "synthetic_stream.obj";
+    writeSyntheticOBJ(fileName, triangleCount);
+    double fileMB = MappedFile(fileName).size() / 1048576.0;
+    cout << fixed << setprecision(1) << "synthetic mesh: " << fileMB << " MB, budget " << budget / 1048576.0 << " MB" << endl;
+
+    bool resettable = resetPeakMemory();
+    double baseline = peakMemoryMB();
+    double start = nowMilliseconds();
+    {
+        StreamedMesh mesh;
+        passed = streamOBJFile(fileName, budget, mesh) && passed;
+        double time = nowMilliseconds() - start, peak = peakMemoryMB();
+        cout << "streamed:  " << mesh.triangleCount << " triangles in " << time << " ms, peak memory "
+             << peak << " MB (" << peak - baseline << " MB above baseline)" << endl;
+        if (resettable && peak > budget / 1048576.0) {
+            cout << "peak memory OVER the budget" << endl;
+            passed = false;
+        }
+    }
+
+    if (resettable) resetPeakMemory();
+    start = nowMilliseconds();
+    if (setting("inmemory", 1) != 0) {
+        Mesh mesh;
+        loadOBJFile(fileName, mesh);
+        ComputeFaceNormals(mesh);
+        double time = nowMilliseconds() - start;
+        cout << "in memory: " << mesh.faceCount << " triangles in " << time << " ms, peak memory "
+             << peakMemoryMB() << " MB (" << peakMemoryMB() - baseline << " MB above baseline)" << endl;
+    }
+    if (!resettable) cout << "(peak memory cannot be reset here, run this benchmark on its own)" << endl;
+    cout << defaultfloat;
+    remove(fileName.c_str());
+    return passed;
+}
+
+} // namespace
+
+vector<Benchmark> loaderBenchmarks()
+{
+    return {
+        {"objparser", benchmarkOBJParser, false},
+        {"objparallel", benchmarkOBJParallel, false},
+        {"ply", benchmarkPLY, false},
+        {"objstream", benchmarkOBJStream, false},
+    };
+}
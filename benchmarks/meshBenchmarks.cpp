@@ -0,0 +1,1064 @@
+// Benchmarks of the mesh layout and processing: the arena, normals, welding, vertex cache order, quantization and
+// levels of detail, each against the code it replaced.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/cpuFeatures.h"
+#include "../include/mappedFile.h"
+#include "../include/meshCache.h"
+#include "../include/meshEmission.h"
+#include "../include/meshLod.h"
+#include "../include/meshProcessing.h"
+#include "../include/quantizedMesh.h"
+#include "benchmarkCommon.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Allocations and bytes held by the containers that use a CountingAllocator.
+ */
+struct AllocationCounter
+{
+    size_t allocations = 0;
+    size_t liveBlocks = 0;
+    size_t liveBytes = 0;
+};
+
+AllocationCounter allocationCounter;
+
+template <typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T *allocate(size_t count)
+    {
+        allocationCounter.allocations++;
+        allocationCounter.liveBlocks++;
+        allocationCounter.liveBytes += count * sizeof(T);
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T *pointer, size_t count)
+    {
+        allocationCounter.liveBlocks--;
+        allocationCounter.liveBytes -= count * sizeof(T);
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using CountedVector = vector<T, CountingAllocator<T>>;
+
+/**
+ * The per-model containers the viewer kept before Mesh, filled the way it filled them: the loaded arrays
+ * sized once, the computed ones grown by push_back.
+ */
+struct ParallelVectorModels
+{
+    CountedVector<CountedVector<float>> verticesOf, textureCoordinateOf, faceNormalsOf, vertexNormalsOf, faceVolumesOf;
+    CountedVector<CountedVector<int>> facesOf;
+    CountedVector<float> centerOf, diagonalLengthOf;
+
+    void add(const Mesh& mesh)
+    {
+        verticesOf.emplace_back(mesh.positions, mesh.positions + mesh.vertexCount * 3);
+        textureCoordinateOf.emplace_back(mesh.textureCoordinates, mesh.textureCoordinates + mesh.textureCoordinateCount * 2);
+        facesOf.emplace_back(mesh.faces, mesh.faces + mesh.faceCount * 3);
+        faceNormalsOf.emplace_back();
+        vertexNormalsOf.emplace_back();
+        faceVolumesOf.emplace_back();
+        for (size_t i = 0; i < mesh.faceCount * 3; i++) faceNormalsOf.back().push_back(mesh.faceNormals[i]);
+        for (size_t i = 0; i < mesh.vertexCount * 3; i++) vertexNormalsOf.back().push_back(mesh.vertexNormals[i]);
+        for (size_t i = 0; i < mesh.faceCount; i++) faceVolumesOf.back().push_back(mesh.faceAreas[i]);
+        centerOf.insert(centerOf.end(), mesh.center, mesh.center + 3);
+        diagonalLengthOf.push_back(mesh.diagonalLength);
+    }
+};
+
+// Stand-ins for glNormal3f, glTexCoord2f and glVertex3f: calls the compiler cannot see into, which may change
+// any global, so the draw loops reload whatever they index through after each one, as they do around GL calls.
+float emittedSum = 0.0f;
+void emitSum3(float x, float y, float z) { emittedSum += x + y + z; }
+void emitSum2(float u, float v) { emittedSum += u + v; }
+void (*volatile emit3)(float, float, float) = emitSum3;
+void (*volatile emit2)(float, float) = emitSum2;
+
+/**
+ * The smooth shaded loop of drawMesh() over the parallel vectors, indexed the way it was before Mesh.
+ */
+void emitParallelVectors(const ParallelVectorModels& models, int thisObj)
+{
+    bool hasTexture = !models.textureCoordinateOf[thisObj].empty();
+    for (size_t i = 0; i < models.facesOf[thisObj].size(); i += 3)
+        for (size_t corner = i; corner < i + 3; corner++) {
+            emit3(models.vertexNormalsOf[thisObj][models.facesOf[thisObj][corner]*3],
+                  models.vertexNormalsOf[thisObj][models.facesOf[thisObj][corner]*3+1],
+                  models.vertexNormalsOf[thisObj][models.facesOf[thisObj][corner]*3+2]);
+            if (hasTexture) emit2(models.textureCoordinateOf[thisObj][models.facesOf[thisObj][corner]*2],
+                                  models.textureCoordinateOf[thisObj][models.facesOf[thisObj][corner]*2 + 1]);
+            emit3(models.verticesOf[thisObj][models.facesOf[thisObj][corner]*3],
+                  models.verticesOf[thisObj][models.facesOf[thisObj][corner]*3+1],
+                  models.verticesOf[thisObj][models.facesOf[thisObj][corner]*3+2]);
+        }
+}
+
+/**
+ * The smooth shaded loop of drawMesh() over a Mesh.
+ */
+void emitMesh(const Mesh& mesh)
+{
+    const float *positions = mesh.positions, *normals = mesh.vertexNormals, *textureCoordinates = mesh.textureCoordinates;
+    const int *faces = mesh.faces;
+    bool hasTexture = mesh.hasTextureCoordinates();
+    for (size_t corner = 0; corner < mesh.faceCount * 3; corner++) {
+        const float *normal = normals + faces[corner] * 3, *position = positions + faces[corner] * 3;
+        emit3(normal[0], normal[1], normal[2]);
+        if (hasTexture) emit2(textureCoordinates[faces[corner] * 2], textureCoordinates[faces[corner] * 2 + 1]);
+        emit3(position[0], position[1], position[2]);
+    }
+}
+
+/**
+ * The smooth shaded loop of drawQuantizedTriangles() over a QuantizedMesh, positions going out as they are stored.
+ */
+void emitQuantizedMesh(const QuantizedMesh& mesh)
+{
+    const short *positions = mesh.positions.data(), *normals = mesh.vertexNormals.data();
+    bool hasTexture = mesh.textureCoordinateCount != 0;
+    float normal[3], textureCoordinate[2];
+    for (size_t corner = 0; corner < mesh.faceCount * 3; corner++) {
+        unsigned int vertex = mesh.vertex(corner);
+        const short *position = positions + vertex * 3;
+        decodeOctahedral(normals + vertex * 2, normal);
+        emit3(normal[0], normal[1], normal[2]);
+        if (hasTexture) {
+            mesh.decodeTextureCoordinate(vertex, textureCoordinate);
+            emit2(textureCoordinate[0], textureCoordinate[1]);
+        }
+        emit3(position[0], position[1], position[2]);
+    }
+}
+
+/**
+ * The flat and smooth shaded loops of drawMesh() before emitMeshTriangles(), writing the stream of VertexStreamSink:
+ * the shading is checked once per mesh, the texture at every corner.
+ */
+void buildVertexStreamReference(const Mesh& mesh, bool flatShaded, float *out)
+{
+    const float *positions = mesh.positions, *textureCoordinates = mesh.textureCoordinates;
+    const int *faces = mesh.faces;
+    bool hasTexture = mesh.hasTextureCoordinates();
+    if (flatShaded) {
+        const float *faceNormals = mesh.faceNormals;
+        for (size_t i = 0; i < mesh.faceCount * 3; i += 3) {
+            for (size_t corner = i; corner < i + 3; corner++) {
+                if (hasTexture) {
+                    memcpy(out, textureCoordinates + faces[corner] * 2, 2 * sizeof(float));
+                    out += 2;
+                }
+                memcpy(out, faceNormals + i, 3 * sizeof(float));
+                memcpy(out + 3, positions + faces[corner] * 3, 3 * sizeof(float));
+                out += 6;
+            }
+        }
+    }
+    else {
+        const float *vertexNormals = mesh.vertexNormals;
+        for (size_t i = 0; i < mesh.faceCount * 3; i += 3) {
+            for (size_t corner = i; corner < i + 3; corner++) {
+                if (hasTexture) {
+                    memcpy(out, textureCoordinates + faces[corner] * 2, 2 * sizeof(float));
+                    out += 2;
+                }
+                memcpy(out, vertexNormals + faces[corner] * 3, 3 * sizeof(float));
+                memcpy(out + 3, positions + faces[corner] * 3, 3 * sizeof(float));
+                out += 6;
+            }
+        }
+    }
+}
+
+/**
+ * Throughput of building the vertex stream of each model's triangles, flat and smooth shaded, with the loops of
+ * drawMesh() before emitMeshTriangles() and with each of its specializations, for 32 bit indices and a 16 bit
+ * copy of them; every stream must be the same. The tiger is textured, the bunny is not.
+ * Settings: copies (passes over the model per run, default 50), runs (default 10).
+ */
+bool benchmarkEmission()
+{
+    auto copies = (int)setting("copies", 50);
+    auto runs = (int)setting("runs", 10);
+
+    bool passed = true;
+    for (const char *model : {"../models/Tiger.obj", "../models/Bunny.obj"}) {
+        Mesh mesh;
+        if (!loadSceneMesh(model, mesh)) return false;
+        requireFaceNormals(mesh);
+        requireVertexNormals(mesh);
+        bool hasTexture = mesh.hasTextureCoordinates();
+        vector<unsigned short> shortFaces(mesh.faces, mesh.faces + mesh.faceCount * 3);
+        vector<pair<size_t, size_t>> ranges(1, make_pair((size_t)0, mesh.faceCount));
+        size_t streamFloats = mesh.faceCount * 3 * (hasTexture ? 8 : 6);
+        double triangles = (double)mesh.faceCount * copies;
+        cout << model << ": " << mesh.faceCount << " triangles, " << (hasTexture ? "textured" : "untextured")
+             << ", million triangles per second" << endl;
+        cout << setw(10) << "shading" << setw(12) << "reference" << setw(12) << "32 bit" << setw(12) << "16 bit"
+             << setw(10) << "speedup" << endl;
+
+        for (int flat = 0; flat < 2; flat++) {
+            const float *normals = flat ? mesh.faceNormals : mesh.vertexNormals;
+            // the reference, then the specializations for 32 and 16 bit indices
+            vector<float> streams[3];
+            for (vector<float>& stream : streams) stream.assign(streamFloats, 0.0f);
+            auto build = [&](int way) {
+                for (int copy = 0; copy < copies; copy++) {
+                    VertexStreamSink sink = {mesh.positions, normals, mesh.textureCoordinates, streams[way].data()};
+                    if (way == 0) buildVertexStreamReference(mesh, flat != 0, streams[0].data());
+                    else if (way == 1) emitMeshTriangles(flat != 0, hasTexture, mesh.faces, ranges, sink);
+                    else emitMeshTriangles(flat != 0, hasTexture, shortFaces.data(), ranges, sink);
+                }
+            };
+            // the ways take turns in each run, so that a busy moment does not favour one of them
+            double times[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+            for (int run = 0; run < runs; run++)
+                for (int way = 0; way < 3; way++) {
+                    double start = nowMilliseconds();
+                    build(way);
+                    times[way] = min(times[way], nowMilliseconds() - start);
+                }
+            if (streams[1] != streams[0] || streams[2] != streams[0]) passed = false;
+            cout << fixed << setprecision(1) << setw(10) << (flat ? "flat" : "smooth") << setw(12)
+                 << triangles / times[0] / 1000.0 << setw(12) << triangles / times[1] / 1000.0 << setw(12)
+                 << triangles / times[2] / 1000.0 << setprecision(2) << setw(9) << times[0] / times[1] << "x"
+                 << defaultfloat << endl;
+        }
+    }
+    if (!passed) cout << "the streams differ from the reference" << endl;
+    return passed;
+}
+
+/**
+ * Memory and allocations of the bundled models as one arena and its attribute blocks per Mesh against the seven
+ * per-model vectors the viewer used before, and the time of the smooth shaded draw loop over both, drawing every model
+ * "copies" times per frame. Both loops read the same streams in the same order and take the same time to within the
+ * noise between runs: the arena saves allocations, not drawing time. Cache misses of the two loops can be compared
+ * with e.g. "perf stat -e cache-misses,L1-dcache-load-misses benchmarks mesh layout=vectors".
+ * Settings: copies, frames, layout (mesh or vectors, both by default).
+ */
+bool benchmarkMesh()
+{
+    auto copies = (int)setting("copies", 20);
+    auto frames = (int)setting("frames", 20);
+    string layout = settings["layout"];
+
+    deque<Mesh> meshes;
+    size_t arenaBytes = 0, streamBytes = 0;
+    for (const char *model : bundledModels) {
+        meshes.emplace_back();
+        Mesh& mesh = meshes.back();
+        if (!loadMesh(model, mesh)) return false;
+        ComputeBoundingBox(mesh);
+        ComputeFaceNormals(mesh);
+        ComputeVertexNormals(mesh);
+        arenaBytes += mesh.arenaBytes() + mesh.attributeBytes();
+        streamBytes += (mesh.vertexCount * 6 + mesh.textureCoordinateCount * 2 + mesh.faceCount * 7) * 4;
+    }
+    allocationCounter = AllocationCounter();
+    ParallelVectorModels vectors;
+    for (const Mesh& mesh : meshes) vectors.add(mesh);
+
+    cout << meshes.size() << " models, " << streamBytes / 1024 << " KB of attributes" << endl;
+    cout << "  parallel vectors: " << allocationCounter.liveBlocks << " heap blocks, " << allocationCounter.liveBytes / 1024
+         << " KB, " << allocationCounter.allocations << " allocations while filling" << endl;
+    // an arena and three attribute blocks per mesh
+    cout << "  mesh arenas:      " << meshes.size() * 4 << " heap blocks, " << arenaBytes / 1024 << " KB, "
+         << meshes.size() * 4 << " allocations" << endl;
+
+    float sums[2] = {0.0f, 0.0f};
+    for (int useMesh = 0; useMesh < 2; useMesh++) {
+        if (!layout.empty() && layout != (useMesh ? "mesh" : "vectors")) continue;
+        emittedSum = 0.0f;
+        double time = bestTime(frames, [&] {
+            for (int copy = 0; copy < copies; copy++)
+                for (int i = 0; i < (int)meshes.size(); i++) {
+                    if (useMesh) emitMesh(meshes[i]);
+                    else emitParallelVectors(vectors, i);
+                }
+        });
+        sums[useMesh] = emittedSum / frames;
+        cout << "  draw loop over " << (useMesh ? "mesh arenas:      " : "parallel vectors: ") << fixed << setprecision(2)
+             << time << " ms per frame of " << copies << " copies" << defaultfloat << endl;
+    }
+    return layout.empty() ? sums[0] == sums[1] : true;
+}
+
+/**
+ * Load the scene's models the way the viewer did before normals were computed lazily (every attribute at load
+ * time and in the mesh cache) and the way it does now (only what drawScene shades with, on the first draw),
+ * and compare their load times, first draw work and resident memory. Both are timed from the OBJ files and
+ * from mesh caches.
+ */
+bool benchmarkAttributes()
+{
+    // drawScene shades the cat and the dog flat, the bunny, the duck and the tiger smooth
+    const bool flatShaded[] = {false, true, true, false, false};
+    int runs = (int)setting("runs", 20);
+    bool passed = true;
+
+    cout << left << setw(8) << "" << right << setw(14) << "from OBJ ms" << setw(15) << "from cache ms" << setw(15)
+         << "first draw ms" << setw(14) << "resident KB" << setw(12) << "cache KB" << endl;
+    double residentKB[2] = {0.0, 0.0};
+    for (int lazy = 0; lazy < 2; lazy++) {
+        vector<Mesh> meshes(sizeof(bundledModels) / sizeof(bundledModels[0]));
+        auto load = [&](size_t i) {
+            if (!loadMesh(bundledModels[i], meshes[i])) return false;
+            ComputeBoundingBox(meshes[i]);
+            if (!lazy) {
+                ComputeFaceNormals(meshes[i]);
+                ComputeVertexNormals(meshes[i]);
+            }
+            return true;
+        };
+        double objTime = bestTime(runs, [&] { for (size_t i = 0; i < meshes.size(); i++) passed = load(i) && passed; });
+
+        double cacheKB = 0.0;
+        vector<string> cacheFileNames;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            cacheFileNames.push_back(string(lazy ? "lazy_" : "eager_") + meshCacheFileName(bundledModels[i]));
+            passed = writeMeshCache(cacheFileNames[i], bundledModels[i], meshes[i]) && passed;
+            cacheKB += MappedFile(cacheFileNames[i]).size() / 1024.0;
+        }
+        double cacheTime = bestTime(runs, [&] {
+            for (size_t i = 0; i < meshes.size(); i++) passed = readMeshCache(cacheFileNames[i], bundledModels[i], meshes[i]) && passed;
+        });
+        for (const string& fileName : cacheFileNames) remove(fileName.c_str());
+
+        // what drawMesh asks for; a no-op for the eager meshes, whose attributes were loaded with them
+        double drawTime = bestTime(lazy ? 1 : runs, [&] {
+            for (size_t i = 0; i < meshes.size(); i++) {
+                if (flatShaded[i]) requireFaceNormals(meshes[i]);
+                else requireVertexNormals(meshes[i]);
+            }
+        });
+        size_t residentBytes = 0;
+        for (const Mesh& mesh : meshes) residentBytes += mesh.arenaBytes() + mesh.attributeBytes();
+        residentKB[lazy] = residentBytes / 1024.0;
+        cout << left << setw(8) << (lazy ? "lazy" : "eager") << right << fixed << setprecision(3) << setw(14) << objTime
+             << setw(15) << cacheTime << setw(15) << drawTime << setprecision(1) << setw(14) << residentKB[lazy]
+             << setw(12) << cacheKB << defaultfloat << endl;
+    }
+    cout << "lazy attributes keep " << fixed << setprecision(1) << 100.0 * (1.0 - residentKB[1] / residentKB[0])
+         << "% less mesh memory resident" << defaultfloat << endl;
+    return passed;
+}
+
+/**
+ * Deform a brush of "edits" vertices, the nearest ones around a random vertex, every frame and bring the normals and
+ * bounds up to date, with a MeshEditor and by recomputing them all. The normals and bounds must come out the same.
+ * @param setupTime Receives the milliseconds of creating the editor.
+ * @return Milliseconds per frame of the full and the incremental update.
+ */
+pair<double, double> deformFrames(Mesh& mesh, size_t edits, int frames, double& setupTime, bool& same)
+{
+    // the edited vertices of each frame, picked beforehand
+    mt19937 random(17);
+    vector<vector<int>> brushes(frames);
+    vector<pair<float, int>> distances(mesh.vertexCount);
+    for (vector<int>& brush : brushes) {
+        const float *seed = mesh.positions + random() % mesh.vertexCount * 3;
+        for (size_t i = 0; i < mesh.vertexCount; i++) {
+            const float *p = mesh.positions + i * 3;
+            distances[i] = {(p[0] - seed[0]) * (p[0] - seed[0]) + (p[1] - seed[1]) * (p[1] - seed[1]) +
+                            (p[2] - seed[2]) * (p[2] - seed[2]), (int)i};
+        }
+        nth_element(distances.begin(), distances.begin() + edits, distances.end());
+        for (size_t i = 0; i < edits; i++) brush.push_back(distances[i].second);
+    }
+
+    // a copy of the mesh recomputed as a whole
+    Mesh full;
+    full.allocate(mesh.vertexCount, 0, mesh.faceCount);
+    copy(mesh.positions, mesh.positions + mesh.vertexCount * 3, full.positions);
+    copy(mesh.faces, mesh.faces + mesh.faceCount * 3, full.faces);
+    float minimum[3], maximum[3], fullMinimum[3], fullMaximum[3];
+
+    double times[2] = {0.0, 0.0};
+    setupTime = nowMilliseconds();
+    MeshEditor editor(mesh);
+    setupTime = nowMilliseconds() - setupTime;
+    for (int frame = 0; frame < frames; frame++) {
+        float offset = 0.002f * mesh.diagonalLength * sin(frame * 0.5f);
+        double start = nowMilliseconds();
+        for (int vertex : brushes[frame]) full.positions[vertex * 3 + 1] += offset;
+        ComputeFaceNormals(full);
+        ComputeVertexNormals(full);
+        copy(full.positions, full.positions + 3, fullMinimum);
+        copy(full.positions, full.positions + 3, fullMaximum);
+        for (size_t i = 0; i < full.vertexCount * 3; i++) {
+            fullMinimum[i % 3] = min(fullMinimum[i % 3], full.positions[i]);
+            fullMaximum[i % 3] = max(fullMaximum[i % 3], full.positions[i]);
+        }
+        double middle = nowMilliseconds();
+        for (int vertex : brushes[frame]) editor.editPositions(vertex, 1)[1] += offset;
+        editor.update();
+        double end = nowMilliseconds();
+        times[0] += middle - start;
+        times[1] += end - middle;
+    }
+    editor.bounds(minimum, maximum);
+    same = memcmp(mesh.faceNormals, full.faceNormals, mesh.faceCount * 12) == 0 &&
+           memcmp(mesh.vertexNormals, full.vertexNormals, mesh.vertexCount * 12) == 0 &&
+           memcmp(minimum, fullMinimum, 12) == 0 && memcmp(maximum, fullMaximum, 12) == 0;
+    return {times[0] / frames, times[1] / frames};
+}
+
+/**
+ * Per frame cost of deforming part of a smooth shaded mesh: "percent" of Tiger.obj (default 1) and the same
+ * number of vertices of a synthetic mesh of "faces" triangles, then "percent" of that, over "frames" frames.
+ */
+bool benchmarkDeform()
+{
+    double percent = setting("percent", 1.0);
+    auto frames = (int)setting("frames", 100);
+    auto triangleCount = (size_t)setting("faces", 1000000);
+    const string syntheticFileName = "synthetic_deform.obj";
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+
+    bool passed = true;
+    size_t tigerEdits = 0;
+    cout << left << setw(28) << "model" << right << setw(10) << "vertices" << setw(8) << "edited" << setw(11) << "setup ms"
+         << setw(12) << "full ms" << setw(16) << "incremental ms" << setw(10) << "speedup" << endl;
+    for (const string& model : {string("../models/Tiger.obj"), syntheticFileName}) {
+        Mesh mesh;
+        if (!loadMesh(model, mesh)) return false;
+        ComputeBoundingBox(mesh);
+        requireVertexNormals(mesh);
+        size_t percentEdits = max<size_t>(1, (size_t)(mesh.vertexCount * percent / 100.0));
+        vector<size_t> editCounts = {percentEdits};
+        if (tigerEdits) editCounts.insert(editCounts.begin(), min(tigerEdits, mesh.vertexCount));
+        else tigerEdits = percentEdits;
+        for (size_t edits : editCounts) {
+            bool same = false;
+            double setupTime;
+            pair<double, double> times = deformFrames(mesh, edits, frames, setupTime, same);
+            passed = passed && same;
+            cout << left << setw(28) << model << right << setw(10) << mesh.vertexCount << setw(8) << edits << fixed
+                 << setprecision(3) << setw(11) << setupTime << setw(12) << times.first << setw(16) << times.second
+                 << setprecision(1) << setw(9) << times.first / times.second << "x" << defaultfloat
+                 << (same ? "" : "  DIFFERENT") << endl;
+        }
+    }
+    printComparison("incremental normals and bounds", passed, "recomputing them");
+    remove(syntheticFileName.c_str());
+    return passed;
+}
+
+/**
+ * Write a mesh as an exporter that splits normals would: every face with its own three vertices. After every 64th
+ * face come a face with a repeated corner and an exactly flat one.
+ * @return Number of degenerate faces written.
+ */
+size_t writeSplitOBJ(const Mesh& mesh, const string& fileName)
+{
+    FILE *file = fopen(fileName.c_str(), "wb");
+    size_t written = 0, degenerate = 0;
+    for (size_t face = 0; face < mesh.faceCount; face++) {
+        for (int corner = 0; corner < 3; corner++) {
+            const float *p = mesh.positions + mesh.faces[face * 3 + corner] * 3;
+            fprintf(file, "v %.9g %.9g %.9g\n", p[0], p[1], p[2]);
+        }
+        if (mesh.hasTextureCoordinates())
+            for (int corner = 0; corner < 3; corner++) {
+                const float *t = mesh.textureCoordinates + mesh.faces[face * 3 + corner] * 2;
+                fprintf(file, "vt %.9g %.9g\n", t[0], t[1]);
+            }
+        fprintf(file, "f %zu %zu %zu\n", written + 1, written + 2, written + 3);
+        if (face % 64 == 63) {
+            fprintf(file, "f %zu %zu %zu\n", written + 1, written + 2, written + 2);
+            degenerate++;
+        }
+        written += 3;
+        if (face % 64 == 63) {
+            for (int corner = 0; corner < 3; corner++) fprintf(file, "v %d 0 0\n", corner);
+            if (mesh.hasTextureCoordinates()) for (int corner = 0; corner < 3; corner++) fprintf(file, "vt 0 0\n");
+            fprintf(file, "f %zu %zu %zu\n", written + 1, written + 2, written + 3);
+            degenerate++;
+            written += 3;
+        }
+    }
+    fclose(file);
+    return degenerate;
+}
+
+/**
+ * Replace a mesh with a copy of another's geometry streams, without attributes.
+ */
+void copyGeometry(const Mesh& mesh, Mesh& copied)
+{
+    copied.allocate(mesh.vertexCount, mesh.textureCoordinateCount, mesh.faceCount);
+    copy(mesh.positions, mesh.positions + mesh.vertexCount * 3, copied.positions);
+    copy(mesh.textureCoordinates, mesh.textureCoordinates + mesh.textureCoordinateCount * 2, copied.textureCoordinates);
+    copy(mesh.faces, mesh.faces + mesh.faceCount * 3, copied.faces);
+}
+
+/**
+ * Best time of welding copies of a mesh's geometry, leaving the last welded copy in welded.
+ */
+double timeWeld(const Mesh& mesh, int runs, unsigned int threadCount, Mesh& welded, WeldStatistics& statistics)
+{
+    double best = 0.0;
+    for (int run = 0; run < runs; run++) {
+        copyGeometry(mesh, welded);
+        double start = nowMilliseconds();
+        statistics = weldMesh(welded, 1e-6f, threadCount);
+        double time = nowMilliseconds() - start;
+        if (run == 0 || time < best) best = time;
+    }
+    return best;
+}
+
+/**
+ * Split every bundled model into separate faces (see writeSplitOBJ()) and weld it back: the vertices and faces must
+ * come back, with the smooth shading normals of the original. Reports what was removed, the memory and the smooth
+ * shaded draw loop (as in the mesh benchmark) before and after, and the welding time on a split synthetic mesh of
+ * "faces" triangles for 1 to "threads" threads.
+ */
+bool benchmarkWeld()
+{
+    auto maxThreads = (unsigned int)setting("threads", max(1u, thread::hardware_concurrency()));
+    auto triangleCount = (size_t)setting("faces", 1000000);
+    const string splitFileName = "split.obj", syntheticFileName = "synthetic_weld.obj";
+    bool passed = true;
+
+    cout << left << setw(22) << "model" << right << setw(18) << "vertices" << setw(16) << "faces" << setw(18) << "memory KB"
+         << setw(20) << "draw loop ms" << setw(10) << "weld ms" << endl;
+    for (const char *model : bundledModels) {
+        Mesh original, split;
+        if (!loadMesh(model, original)) return false;
+        requireVertexNormals(original);
+        size_t degenerate = writeSplitOBJ(original, splitFileName);
+        if (!loadMesh(splitFileName, split)) return false;
+        size_t splitVertices = split.vertexCount, splitFaces = split.faceCount;
+        size_t splitBytes = split.arenaBytes() + (split.vertexCount + split.faceCount) * 12; // with the normals drawn
+
+        Mesh welded;
+        WeldStatistics statistics;
+        double weldTime = timeWeld(split, 20, 0, welded, statistics);
+        size_t weldedBytes = welded.arenaBytes() + (welded.vertexCount + welded.faceCount) * 12;
+        requireVertexNormals(split);
+        double splitDraw = bestTime(20, [&] { emitMesh(split); });
+        requireVertexNormals(welded);
+        double weldedDraw = bestTime(20, [&] { emitMesh(welded); });
+
+        // the welded mesh has the original's faces, corner by corner, and the original's smooth normals
+        bool same = welded.faceCount == original.faceCount && welded.vertexCount == original.vertexCount &&
+                    statistics.removedFaces == degenerate;
+        for (size_t corner = 0; same && corner < original.faceCount * 3; corner++) {
+            int a = original.faces[corner], b = welded.faces[corner];
+            same = memcmp(original.positions + a * 3, welded.positions + b * 3, 12) == 0 &&
+                   memcmp(original.vertexNormals + a * 3, welded.vertexNormals + b * 3, 12) == 0;
+        }
+        passed = passed && same;
+        cout << left << setw(22) << model << right << setw(8) << splitVertices << " -> " << setw(6) << welded.vertexCount
+             << setw(7) << splitFaces << " -> " << setw(5) << welded.faceCount << fixed << setprecision(1) << setw(8)
+             << splitBytes / 1024.0 << " -> " << setw(6) << weldedBytes / 1024.0 << setprecision(3) << setw(9)
+             << splitDraw << " -> " << setw(7) << weldedDraw << setw(10) << weldTime << defaultfloat
+             << (same ? "" : "  DIFFERENT") << endl;
+    }
+    printComparison("welded models", passed, "the originals");
+
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+    Mesh synthetic, split;
+    if (!loadMesh(syntheticFileName, synthetic)) return false;
+    writeSplitOBJ(synthetic, splitFileName);
+    if (!loadMesh(splitFileName, split)) return false;
+    cout << "split synthetic mesh, " << split.vertexCount << " vertices:" << endl;
+    for (unsigned int threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ? maxThreads : threads * 2) {
+        Mesh welded;
+        WeldStatistics statistics;
+        double time = timeWeld(split, 3, threads, welded, statistics);
+        passed = passed && welded.vertexCount == synthetic.vertexCount;
+        cout << setw(8) << threads << " threads: " << fixed << setprecision(1) << time << " ms, "
+             << split.vertexCount / time / 1000.0 << " M vertices/s, removed " << statistics.removedVertices
+             << " vertices and " << statistics.removedFaces << " faces" << defaultfloat << endl;
+    }
+    remove(splitFileName.c_str());
+    remove(syntheticFileName.c_str());
+    return passed;
+}
+
+/**
+ * The triangles of a mesh by value, each as the positions and texture coordinates of its corners in order, sorted.
+ * Equal for two meshes that draw the same triangles however their faces and vertices are numbered.
+ */
+vector<vector<float>> triangleSet(const Mesh& mesh)
+{
+    vector<vector<float>> triangles(mesh.faceCount);
+    for (size_t face = 0; face < mesh.faceCount; face++)
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = mesh.faces[face * 3 + corner];
+            triangles[face].insert(triangles[face].end(), mesh.positions + vertex * 3, mesh.positions + vertex * 3 + 3);
+            if ((size_t)vertex < mesh.textureCoordinateCount)
+                triangles[face].insert(triangles[face].end(), mesh.textureCoordinates + vertex * 2,
+                                       mesh.textureCoordinates + vertex * 2 + 2);
+        }
+    sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+/**
+ * Best time of optimizeVertexCache() and optimizeVertexFetch() on copies of a mesh's geometry, leaving the last
+ * optimized copy in optimized.
+ */
+double timeVertexCacheOptimization(const Mesh& mesh, int runs, Mesh& optimized)
+{
+    double best = 0.0;
+    for (int run = 0; run < runs; run++) {
+        copyGeometry(mesh, optimized);
+        double start = nowMilliseconds();
+        optimizeVertexCache(optimized);
+        optimizeVertexFetch(optimized);
+        double time = nowMilliseconds() - start;
+        if (run == 0 || time < best) best = time;
+    }
+    return best;
+}
+
+/**
+ * ACMR and ATVR (see analyzeVertexCache()) of the bundled models, welded as the viewer loads them, before and after
+ * reordering them for the vertex cache and for vertex fetch, with the time taken and the smooth shaded draw loop
+ * (as in the mesh benchmark); the reordered models must draw the same triangles. Then the same for a synthetic grid
+ * of "faces" triangles in a shuffled order. Settings: faces, cache (FIFO entries simulated, 16 by default).
+ */
+bool benchmarkVertexCache()
+{
+    auto triangleCount = (size_t)setting("faces", 1000000);
+    auto cacheSize = (int)setting("cache", 16);
+    const string syntheticFileName = "synthetic_vertexcache.obj";
+    bool passed = true;
+
+    // prints a row and returns the time of the reordering
+    auto report = [&](const string& name, Mesh& mesh, int runs) {
+        Mesh optimized;
+        double time = timeVertexCacheOptimization(mesh, runs, optimized);
+        VertexCacheStatistics before = analyzeVertexCache(mesh, cacheSize), after = analyzeVertexCache(optimized, cacheSize);
+        bool same = triangleSet(mesh) == triangleSet(optimized);
+        passed = passed && same;
+        requireVertexNormals(mesh);
+        requireVertexNormals(optimized);
+        double drawTime = bestTime(20, [&] { emitMesh(mesh); });
+        double optimizedDraw = bestTime(20, [&] { emitMesh(optimized); });
+        cout << left << setw(22) << name << right << fixed << setprecision(3) << setw(8) << before.acmr << " -> "
+             << setw(5) << after.acmr << setw(8) << before.atvr << " -> " << setw(5) << after.atvr << setw(10) << drawTime
+             << " -> " << setw(7) << optimizedDraw << setw(10) << time << defaultfloat << (same ? "" : "  DIFFERENT") << endl;
+        return time;
+    };
+
+    cout << "FIFO cache of " << cacheSize << " vertices" << endl;
+    cout << left << setw(22) << "model" << right << setw(17) << "ACMR" << setw(17) << "ATVR" << setw(21) << "draw loop ms"
+         << setw(10) << "order ms" << endl;
+    for (const char *model : bundledModels) {
+        Mesh mesh;
+        if (!loadMesh(model, mesh)) return false;
+        weldMesh(mesh);
+        report(model, mesh, 20);
+    }
+
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+    Mesh synthetic;
+    if (!loadMesh(syntheticFileName, synthetic)) return false;
+    remove(syntheticFileName.c_str());
+    report("synthetic grid", synthetic, 3);
+    mt19937 random(1);
+    for (size_t face = synthetic.faceCount - 1; face > 0; face--)
+        swap_ranges(synthetic.faces + face * 3, synthetic.faces + face * 3 + 3,
+                    synthetic.faces + uniform_int_distribution<size_t>(0, face)(random) * 3);
+    synthetic.releaseAttributes(MESH_ALL_ATTRIBUTES);
+    double time = report("synthetic, shuffled", synthetic, 3);
+    cout << "ordered " << fixed << setprecision(1) << synthetic.faceCount / time / 1000.0 << " M triangles/s" << defaultfloat << endl;
+    cout << "reordered models draw " << (passed ? "identical" : "DIFFERENT") << " triangles" << endl;
+    return passed;
+}
+
+/**
+ * Largest angle in degrees between unit normals and their octahedral encodings.
+ */
+double maxNormalError(const float *normals, const vector<short>& encoded)
+{
+    double largest = 0.0;
+    for (size_t i = 0; i < encoded.size() / 2; i++) {
+        float decoded[3];
+        decodeOctahedral(encoded.data() + i * 2, decoded);
+        double a[3] = {decoded[0], decoded[1], decoded[2]}, b[3] = {normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]};
+        double cross[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        double sine = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+        largest = max(largest, atan2(sine, a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) * 180.0 / M_PI);
+    }
+    return largest;
+}
+
+/**
+ * Memory of the bundled models, processed as the viewer loads them and with both kinds of normals, as float meshes
+ * and quantized, and the errors of decoding the quantized ones: positions and texture coordinates must decode to
+ * within half a quantization step, normals to within normalBound degrees. Positions errors are also given in pixels
+ * of a model filling an 800 pixel window. Also times the smooth shaded draw loop (as in the mesh benchmark)
+ * over both. Settings: normalBound (0.01 by default).
+ */
+bool benchmarkQuantize()
+{
+    double normalBound = setting("normalBound", 0.01);
+    bool passed = true;
+    size_t totalFloat = 0, totalQuantized = 0;
+
+    cout << left << setw(22) << "model" << right << setw(8) << "index" << setw(20) << "memory KB" << setw(12)
+         << "position px" << setw(12) << "normal deg" << setw(12) << "face deg" << setw(12) << "texture"
+         << setw(21) << "draw loop ms" << endl;
+    for (const char *model : bundledModels) {
+        Mesh mesh;
+        if (!loadSceneMesh(model, mesh)) return false;
+        ComputeFaceNormals(mesh);
+        ComputeVertexNormals(mesh);
+        mesh.releaseAttributes(MESH_FACE_AREAS);
+        QuantizedMesh quantized;
+        quantizeMesh(mesh, quantized);
+        size_t floatBytes = mesh.arenaBytes() + (mesh.faceCount + mesh.vertexCount) * 3 * sizeof(float);
+        totalFloat += floatBytes;
+        totalQuantized += quantized.bytes();
+
+        // errors in quantization steps beyond the rounding of decoding in float (2 ulp), which must be half a step at most
+        double positionSteps = 0.0, positionError = 0.0, textureSteps = 0.0;
+        for (size_t vertex = 0; vertex < mesh.vertexCount; vertex++) {
+            float position[3];
+            quantized.decodePosition(vertex, position);
+            for (int axis = 0; axis < 3; axis++) {
+                float original = mesh.positions[vertex * 3 + axis];
+                double error = fabs((double)position[axis] - original);
+                positionError = max(positionError, error);
+                positionSteps = max(positionSteps, (error - 2.0 * FLT_EPSILON * fabs(original)) / quantized.positionScale);
+            }
+        }
+        for (size_t vertex = 0; vertex < mesh.textureCoordinateCount; vertex++) {
+            float textureCoordinate[2];
+            quantized.decodeTextureCoordinate(vertex, textureCoordinate);
+            for (int axis = 0; axis < 2; axis++)
+                if (quantized.textureCoordinateScale[axis] > 0.0f) {
+                    float original = mesh.textureCoordinates[vertex * 2 + axis];
+                    double error = fabs((double)textureCoordinate[axis] - original);
+                    textureSteps = max(textureSteps, (error - 2.0 * FLT_EPSILON * fabs(original)) / quantized.textureCoordinateScale[axis]);
+                }
+        }
+        double vertexNormalError = maxNormalError(mesh.vertexNormals, quantized.vertexNormals);
+        double faceNormalError = maxNormalError(mesh.faceNormals, quantized.faceNormals);
+        bool within = positionSteps <= 0.5 && textureSteps <= 0.5 && vertexNormalError <= normalBound &&
+                      faceNormalError <= normalBound;
+        passed = passed && within;
+
+        double floatDraw = bestTime(20, [&] { emitMesh(mesh); });
+        double quantizedDraw = bestTime(20, [&] { emitQuantizedMesh(quantized); });
+        cout << left << setw(22) << model << right << setw(6) << (quantized.faces.empty() ? 16 : 32) << "-bit" << fixed
+             << setprecision(1) << setw(8) << floatBytes / 1024.0 << " -> " << setw(6) << quantized.bytes() / 1024.0
+             << setprecision(4) << setw(12) << positionError / mesh.diagonalLength * 800.0 << setw(12)
+             << vertexNormalError << setw(12) << faceNormalError << setprecision(2) << setw(8) << textureSteps << " step"
+             << setprecision(3) << setw(9) << floatDraw << " -> " << setw(7) << quantizedDraw << defaultfloat
+             << (within ? "" : "  OUT OF BOUNDS") << endl;
+    }
+    cout << "quantized models take " << fixed << setprecision(1) << 100.0 * (1.0 - (double)totalQuantized / totalFloat)
+         << "% less memory, decoded " << (passed ? "within" : "OUT OF") << " bounds" << defaultfloat << endl;
+    return passed;
+}
+
+/**
+ * Levels of detail of the bundled models, processed as the viewer loads them: the faces and error of each level (in
+ * pixels of a model filling an 800 pixel window), the time to build them and the simplification throughput, also
+ * timed halving a synthetic grid of "faces" triangles. Every level must keep vertices of the full model with their
+ * texture coordinates, so that texture seams stay where they were, and have no degenerate faces. Then the camera of
+ * the viewer's scene moves away over "frames" frames (default 480), doubling its distance every 60 and jittering
+ * back and forth by 2%, and the triangles drawn at a threshold of "pixels" (default 1) are reported along with the
+ * level switches with and without hysteresis.
+ */
+bool benchmarkLod()
+{
+    auto triangleCount = (size_t)setting("faces", 1000000);
+    auto frameCount = (int)setting("frames", 480);
+    auto threshold = (float)setting("pixels", 1.0);
+    const string syntheticFileName = "synthetic_lod.obj";
+    const int modelCount = sizeof(bundledModels) / sizeof(bundledModels[0]);
+    bool passed = true;
+
+    cout << left << setw(22) << "model" << right << setw(10) << "build ms" << setw(12) << "M faces/s"
+         << "   faces (error px)" << endl;
+    Mesh models[modelCount];
+    vector<MeshLod> lods[modelCount];
+    size_t fullFaces = 0;
+    for (int i = 0; i < modelCount; i++) {
+        Mesh& mesh = models[i];
+        if (!loadSceneMesh(bundledModels[i], mesh)) return false;
+        fullFaces += mesh.faceCount;
+        double time = bestTime(5, [&] { buildMeshLods(mesh, lods[i]); });
+        size_t simplifiedFaces = mesh.faceCount;
+        for (size_t level = 0; level + 1 < lods[i].size(); level++) simplifiedFaces += lods[i][level].mesh.faceCount;
+
+        // the vertices of the full model, as positions followed by texture coordinates
+        auto vertexOf = [](const Mesh& from, size_t vertex) {
+            vector<float> key(from.positions + vertex * 3, from.positions + vertex * 3 + 3);
+            if (vertex < from.textureCoordinateCount)
+                key.insert(key.end(), from.textureCoordinates + vertex * 2, from.textureCoordinates + vertex * 2 + 2);
+            return key;
+        };
+        vector<vector<float>> vertices;
+        for (size_t vertex = 0; vertex < mesh.vertexCount; vertex++) vertices.push_back(vertexOf(mesh, vertex));
+        sort(vertices.begin(), vertices.end());
+        bool kept = true;
+        ostringstream levels;
+        levels << fixed << setprecision(2) << mesh.faceCount;
+        for (const MeshLod& lod : lods[i]) {
+            for (size_t vertex = 0; vertex < lod.mesh.vertexCount; vertex++)
+                kept = kept && binary_search(vertices.begin(), vertices.end(), vertexOf(lod.mesh, vertex));
+            for (size_t face = 0; face < lod.mesh.faceCount; face++)
+                for (int corner = 0; corner < 3; corner++) {
+                    const float *p = lod.mesh.positions + lod.mesh.faces[face * 3 + corner] * 3;
+                    const float *q = lod.mesh.positions + lod.mesh.faces[face * 3 + (corner + 1) % 3] * 3;
+                    kept = kept && !equal(p, p + 3, q);
+                }
+            levels << " " << lod.mesh.faceCount << " (" << lod.error / mesh.diagonalLength * 800.0f << ")";
+        }
+        passed = passed && kept;
+        cout << left << setw(22) << bundledModels[i] << right << fixed << setprecision(3) << setw(10) << time
+             << setprecision(2) << setw(12) << simplifiedFaces / time / 1000.0 << "   " << levels.str() << defaultfloat
+             << (kept ? "" : "  NEW VERTICES OR DEGENERATE FACES") << endl;
+    }
+
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+    Mesh synthetic, halved;
+    if (!loadMesh(syntheticFileName, synthetic)) return false;
+    remove(syntheticFileName.c_str());
+    ComputeBoundingBox(synthetic);
+    double time = bestTime(1, [&] { simplifyMesh(synthetic, synthetic.faceCount / 2, halved); });
+    cout << "synthetic grid: " << synthetic.faceCount << " -> " << halved.faceCount << " faces in " << time << " ms, "
+         << fixed << setprecision(2) << synthetic.faceCount / time / 1000.0 << " M faces/s" << defaultfloat << endl;
+
+    // the viewer's scene: scale (diagonal in scene units) and position of each model, the camera moving back along z
+    const float scales[modelCount] = {10.0f, 10.0f, 10.0f, 10.0f, 20.0f};
+    const float positions[modelCount][3] = {{0.0f, 3.0f, 0.0f}, {5.0f, 5.0f, 0.0f}, {-6.0f, 5.0f, 0.0f},
+                                            {0.0f, 3.0f, 6.0f}, {-5.0f, 5.0f, -10.0f}};
+    int levels[2][modelCount] = {};
+    size_t switches[2] = {0, 0};
+    cout << "full detail: " << fullFaces << " triangles, error threshold " << threshold << " px" << endl;
+    cout << setw(10) << "distance" << setw(11) << "triangles" << "   levels" << endl;
+    for (int frame = 0; frame < frameCount; frame++) {
+        float distance = 15.0f * powf(2.0f, frame / 60.0f) * (1.0f + 0.02f * sinf(frame * 1.7f));
+        size_t triangles = 0;
+        for (int hysteresis = 0; hysteresis < 2; hysteresis++)
+            for (int i = 0; i < modelCount; i++) {
+                float dx = -positions[i][0], dy = 10.0f - positions[i][1], dz = distance - positions[i][2];
+                float nearest = max(sqrtf(dx * dx + dy * dy + dz * dz) - scales[i] * 0.5f, 0.01f);
+                float pixelsPerUnit = lodPixelsPerUnit(scales[i] / models[i].diagonalLength, nearest, 70.0f, 800);
+                // a current level above every level never holds a coarser one back
+                int level = selectMeshLod(lods[i], pixelsPerUnit, threshold, hysteresis ? levels[1][i] : MESH_MAX_LODS);
+                if (frame && level != levels[hysteresis][i]) switches[hysteresis]++;
+                levels[hysteresis][i] = level;
+                if (hysteresis) triangles += level ? lods[i][level - 1].mesh.faceCount : models[i].faceCount;
+            }
+        if (frame % 60 == 0 || frame == frameCount - 1) {
+            cout << fixed << setprecision(1) << setw(10) << distance << defaultfloat << setw(11) << triangles << "  ";
+            for (int level : levels[1]) cout << " " << level;
+            cout << endl;
+        }
+    }
+    cout << "level switches: " << switches[1] << " with hysteresis, " << switches[0] << " without" << endl;
+    return passed && switches[1] <= switches[0];
+}
+
+/**
+ * The original vertex normals, one face list per vertex and two temporary vectors per vertex, kept as the
+ * reference for comparisons. Reads the positions, faces and face normals of a mesh.
+ */
+void ComputeVertexNormalsReference(const Mesh& mesh, vector<float>& vertexNormals)
+{
+    const float *vertices = mesh.positions;
+    const int *faces = mesh.faces;
+    const float *faceNormals = mesh.faceNormals;
+    vector<float> faceVolumes;
+    vector<vector<int>> vertexToFace(mesh.vertexCount);
+    vertexNormals.clear();
+    for (size_t i = 0; i < mesh.faceCount * 3; i += 3) {
+        const float *firstPoint = vertices + faces[i] * 3;
+        const float *secondPoint = vertices + faces[i + 1] * 3;
+        const float *thirdPoint = vertices + faces[i + 2] * 3;
+        float temp1P = (secondPoint[1] - firstPoint[1]) * (thirdPoint[2] - firstPoint[2]);
+        float temp2P = (secondPoint[2] - firstPoint[2]) * (thirdPoint[0] - firstPoint[0]);
+        float temp3P = (secondPoint[0] - firstPoint[0]) * (thirdPoint[1] - firstPoint[1]);
+        float temp1N = (secondPoint[1] - firstPoint[1]) * (thirdPoint[0] - firstPoint[0]);
+        float temp2N = (secondPoint[0] - firstPoint[0]) * (thirdPoint[2] - firstPoint[2]);
+        float temp3N = (secondPoint[2] - firstPoint[2]) * (thirdPoint[1] - firstPoint[1]);
+        faceVolumes.push_back((float)0.5 * abs(temp1P + temp2P + temp3P - temp1N - temp2N - temp3N));
+        for (int corner = 0; corner < 3; corner++) vertexToFace[faces[i + corner]].push_back((int)(i / 3));
+    }
+    for (size_t i = 0; i < mesh.vertexCount; i++) {
+        float resultNormalX = 0.0, resultNormalY = 0.0, resultNormalZ = 0.0, totalVolume = 0.0;
+        vector<float> faceVolume, faceNormal;
+        for (int face : vertexToFace[i]) {
+            faceVolume.push_back(faceVolumes[face]);
+            faceNormal.insert(faceNormal.end(), faceNormals + face * 3, faceNormals + face * 3 + 3);
+        }
+        for (float volume : faceVolume) totalVolume += volume;
+        for (size_t j = 0; j < faceVolume.size(); j++) {
+            resultNormalX += (faceVolume[j] / totalVolume) * faceNormal[j * 3];
+            resultNormalY += (faceVolume[j] / totalVolume) * faceNormal[j * 3 + 1];
+            resultNormalZ += (faceVolume[j] / totalVolume) * faceNormal[j * 3 + 2];
+        }
+        auto resultNormalLength = (float)sqrt(pow(resultNormalX, 2) + pow(resultNormalY, 2) + pow(resultNormalZ, 2));
+        vertexNormals.push_back(resultNormalX / resultNormalLength);
+        vertexNormals.push_back(resultNormalY / resultNormalLength);
+        vertexNormals.push_back(resultNormalZ / resultNormalLength);
+    }
+}
+
+/**
+ * Vertex normals from the compressed sparse row adjacency on 1, 2, 4, ... up to "threads" threads (one per core
+ * by default) against the original per-vertex vectors, on the bundled models and a synthetic mesh of "faces"
+ * triangles. Meshes under 65536 vertices per thread use fewer threads than asked for.
+ */
+bool benchmarkNormals()
+{
+    auto maxThreads = (unsigned int)setting("threads", max(1u, thread::hardware_concurrency()));
+    auto triangleCount = (size_t)setting("faces", 10000000);
+    const string syntheticFileName = "synthetic_normals.obj";
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+    vector<string> models(begin(bundledModels), end(bundledModels));
+    models.push_back(syntheticFileName);
+
+    bool passed = true;
+    cout << left << setw(28) << "model" << right << setw(10) << "triangles" << setw(8) << "threads" << setw(11) << "ms"
+         << setw(16) << "vs 1 thread" << setw(16) << "vs original" << endl;
+    for (const string& model : models) {
+        Mesh mesh;
+        if (!loadMesh(model, mesh)) return false;
+        ComputeBoundingBox(mesh);
+        ComputeFaceNormals(mesh);
+        vector<float> reference;
+        int runs = mesh.faceCount > 1000000 ? 1 : 10;
+        double referenceTime = bestTime(runs, [&] { ComputeVertexNormalsReference(mesh, reference); });
+        cout << left << setw(28) << model << right << setw(10) << mesh.faceCount << setw(8) << "orig" << fixed
+             << setprecision(2) << setw(11) << referenceTime << defaultfloat << endl;
+
+        double singleTime = 0.0;
+        for (unsigned int threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ? maxThreads : threads * 2) {
+            double time = bestTime(runs, [&] { ComputeVertexNormals(mesh, threads); });
+            if (threads == 1) singleTime = time;
+            bool same = memcmp(mesh.vertexNormals, reference.data(), reference.size() * 4) == 0;
+            passed = passed && same;
+            cout << setw(46) << threads << fixed << setprecision(2) << setw(11) << time << setw(15) << singleTime / time
+                 << "x" << setw(15) << referenceTime / time << "x" << defaultfloat << (same ? "" : "  DIFFERENT") << endl;
+        }
+    }
+    printComparison("vertex normals", passed, "the original");
+    remove(syntheticFileName.c_str());
+    return passed;
+}
+
+/**
+ * Run the face normal and bounding box kernels at every SIMD level the CPU has, check their output is
+ * bit-identical to the scalar code's, and report their throughput.
+ */
+bool benchmarkGeometry()
+{
+    auto triangleCount = (size_t)setting("faces", 10000000);
+    const string syntheticFileName = "synthetic_geometry.obj";
+    writeSyntheticOBJ(syntheticFileName, triangleCount);
+    vector<string> models(begin(bundledModels), end(bundledModels));
+    models.push_back(syntheticFileName);
+
+    bool passed = true;
+    SIMDLevel levels[] = {SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2};
+    cout << "CPU SIMD level: " << simdLevelName(cpuSIMDLevel()) << endl;
+    cout << left << setw(28) << "model" << right << setw(10) << "triangles" << setw(8) << "level" << setw(14) << "normals ms"
+         << setw(12) << "Mtris/s" << setw(11) << "bbox ms" << setw(12) << "Mverts/s" << endl;
+    for (const string& model : models) {
+        Mesh mesh;
+        if (!loadMesh(model, mesh)) return false;
+        vector<float> positions(mesh.positions, mesh.positions + mesh.vertexCount * 3), centred, faceNormals, faceAreas;
+        int runs = mesh.faceCount > 1000000 ? 3 : 20;
+        double scalarNormals = 0.0, scalarBounds = 0.0;
+        for (SIMDLevel level : levels) {
+            if (level > cpuSIMDLevel()) continue;
+            setSIMDLevelLimit(level);
+            copy(positions.begin(), positions.end(), mesh.positions);
+            ComputeBoundingBox(mesh);
+            ComputeFaceNormals(mesh);
+            bool same = true;
+            if (level == SIMD_SCALAR) {
+                centred.assign(mesh.positions, mesh.positions + mesh.vertexCount * 3);
+                faceNormals.assign(mesh.faceNormals, mesh.faceNormals + mesh.faceCount * 3);
+                faceAreas.assign(mesh.faceAreas, mesh.faceAreas + mesh.faceCount);
+            }
+            else
+                same = memcmp(mesh.positions, centred.data(), centred.size() * 4) == 0 &&
+                       memcmp(mesh.faceNormals, faceNormals.data(), faceNormals.size() * 4) == 0 &&
+                       memcmp(mesh.faceAreas, faceAreas.data(), faceAreas.size() * 4) == 0;
+            passed = passed && same;
+
+            double normalsTime = bestTime(runs, [&] { ComputeFaceNormals(mesh); });
+            // the box of a centred mesh is computed and centred again, which moves it by nothing
+            double boundsTime = bestTime(runs, [&] { ComputeBoundingBox(mesh); });
+            if (level == SIMD_SCALAR) {
+                scalarNormals = normalsTime;
+                scalarBounds = boundsTime;
+            }
+            cout << left << setw(28) << (level == SIMD_SCALAR ? model : "") << right << setw(10)
+                 << (level == SIMD_SCALAR ? to_string(mesh.faceCount) : "") << setw(8) << simdLevelName(level) << fixed
+                 << setprecision(3) << setw(14) << normalsTime << setprecision(1) << setw(12)
+                 << mesh.faceCount / normalsTime / 1000.0 << setprecision(3) << setw(11) << boundsTime << setprecision(1)
+                 << setw(12) << mesh.vertexCount / boundsTime / 1000.0 << defaultfloat;
+            if (level != SIMD_SCALAR)
+                cout << fixed << setprecision(2) << "  " << scalarNormals / normalsTime << "x, " << scalarBounds / boundsTime
+                     << "x" << defaultfloat;
+            cout << (same ? "" : "  DIFFERENT") << endl;
+        }
+        setSIMDLevelLimit(SIMD_AVX2);
+    }
+    printComparison("face normals, areas and bounding boxes", passed, "the scalar code");
+    remove(syntheticFileName.c_str());
+    return passed;
+}
+
+} // namespace
+
+vector<Benchmark> meshBenchmarks()
+{
+    return {
+        {"mesh", benchmarkMesh, false},
+        {"emission", benchmarkEmission, false},
+        {"normals", benchmarkNormals, false},
+        {"geometry", benchmarkGeometry, false},
+        {"attributes", benchmarkAttributes, false},
+        {"deform", benchmarkDeform, false},
+        {"weld", benchmarkWeld, false},
+        {"vertexcache", benchmarkVertexCache, false},
+        {"quantize", benchmarkQuantize, false},
+        {"lod", benchmarkLod, false},
+    };
+}
@@ -0,0 +1,556 @@
+// Benchmarks of loading and uploading textures: the BMP decoder, mip chains and BC1, the asset cache, streamed
+// uploads and the atlas.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/assetCache.h"
+#include "../include/cpuFeatures.h"
+#include "../include/getBMP.h"
+#include "../include/mesh.h"
+#include "../include/meshProcessing.h"
+#include "../include/objLoader.h"
+#include "../include/textureAtlas.h"
+#include "../include/textureProcessing.h"
+#include "../include/textureUploadQueue.h"
+#include "benchmarkCommon.h"
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+using namespace std;
+
+namespace {
+
+/**
+ * The original three buffer getBMP, kept as the reference for comparisons (its leaks fixed).
+ */
+imageFile *getBMPReference(const std::string& fileName)
+{
+    int offset, w, h;
+    auto *outRGBA = new imageFile;
+    std::ifstream inFile(fileName.c_str(), std::ios::binary);
+    inFile.seekg(10);
+    inFile.read((char *)&offset, 4);
+    inFile.seekg(18);
+    inFile.read((char *)&w, 4);
+    inFile.read((char *)&h, 4);
+    int padding = (3 * w) % 4 ? 4 - (3 * w) % 4 : 0;
+
+    auto *tempStore = new unsigned char[(3 * w + padding) * h];
+    inFile.seekg(offset);
+    inFile.read((char *)tempStore, (3 * w + padding) * h);
+    inFile.close();
+
+    auto *outRGB = new unsigned char[3 * w * h];
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < 3 * w; i += 3) {
+            int tempStorePos = (3 * w + padding) * j + i;
+            int outRGBpos = 3 * w * j + i;
+            outRGB[outRGBpos] = tempStore[tempStorePos + 2];
+            outRGB[outRGBpos + 1] = tempStore[tempStorePos + 1];
+            outRGB[outRGBpos + 2] = tempStore[tempStorePos];
+        }
+
+    outRGBA->width = w;
+    outRGBA->height = h;
+    outRGBA->data = new unsigned char[4 * w * h];
+    for (int j = 0; j < 4 * w * h; j += 4) {
+        outRGBA->data[j] = outRGB[(j / 4) * 3];
+        outRGBA->data[j + 1] = outRGB[(j / 4) * 3 + 1];
+        outRGBA->data[j + 2] = outRGB[(j / 4) * 3 + 2];
+        outRGBA->data[j + 3] = 0xFF;
+    }
+    delete[] tempStore;
+    delete[] outRGB;
+    return outRGBA;
+}
+
+void freeImage(imageFile *image)
+{
+    if (!image) return;
+    delete[] image->data;
+    delete image;
+}
+
+/**
+ * Compare the mapped single pass BMP decoder at every SIMD level the CPU has against the original
+ * getBMP, pixel for pixel, and time them.
+ */
+bool benchmarkBMP()
+{
+    bool passed = true;
+    SIMDLevel levels[] = {SIMD_SCALAR, SIMD_SSSE3, SIMD_AVX2};
+    cout << "CPU SIMD level: " << simdLevelName(cpuSIMDLevel()) << endl;
+    cout << left << setw(34) << "image" << right << setw(11) << "size" << setw(14) << "original ms";
+    for (SIMDLevel level : levels) if (level <= cpuSIMDLevel()) cout << setw(12) << simdLevelName(level);
+    cout << setw(12) << "map only" << endl;
+
+    for (const char *image : bundledImages) {
+        imageFile *reference = getBMPReference(image);
+        double referenceTime = bestTime(5, [&] { freeImage(getBMPReference(image)); });
+        cout << left << setw(34) << image << right << setw(6) << reference->width << "x" << setw(4) << reference->height
+             << fixed << setprecision(3) << setw(14) << referenceTime;
+
+        for (SIMDLevel level : levels) {
+            if (level > cpuSIMDLevel()) continue;
+            setSIMDLevelLimit(level);
+            imageFile *decoded = getBMP(image);
+            bool same = decoded && decoded->width == reference->width && decoded->height == reference->height &&
+                        memcmp(decoded->data, reference->data, (size_t)4 * reference->width * reference->height) == 0;
+            passed = passed && same;
+            freeImage(decoded);
+            double time = bestTime(5, [&] { freeImage(getBMP(image)); });
+            cout << setw(12) << time << (same ? "" : " MISMATCH");
+        }
+        setSIMDLevelLimit(SIMD_AVX2);
+
+        // what the viewer does: map the file and let GL read the BGR rows
+        double mapTime = bestTime(5, [&] { bmpView view; mapBMP(image, view); });
+        cout << setw(12) << mapTime << endl;
+        freeImage(reference);
+    }
+    cout << defaultfloat << "decoded images " << (passed ? "match" : "DO NOT match") << " the original getBMP pixel for pixel" << endl;
+    return passed;
+}
+
+/**
+ * Build the mip chain of every bundled image at each SIMD level (checking they agree), encode it to BC1,
+ * and report the memory footprint, the encoder throughput and the BC1 error of level 0.
+ */
+bool benchmarkTexture()
+{
+    bool passed = true;
+    SIMDLevel levels[] = {SIMD_SCALAR, SIMD_SSSE3, SIMD_AVX2};
+    cout << left << setw(34) << "image" << right << setw(10) << "RGBA KB" << setw(10) << "mips KB" << setw(9) << "BC1 KB"
+         << setw(8) << "saved" << setw(11) << "mips ms" << setw(10) << "BC1 ms" << setw(10) << "BC1 MB/s" << setw(10) << "PSNR dB" << endl;
+    double totalRGBA = 0, totalBC1 = 0, totalEncodeBytes = 0, totalEncodeTime = 0;
+
+    for (const char *image : bundledImages) {
+        imageFile *rgba = getBMP(image);
+        ProcessedTexture reference, texture;
+        setSIMDLevelLimit(SIMD_SCALAR);
+        buildMipChain(rgba, reference);
+        for (SIMDLevel level : levels) {
+            if (level > cpuSIMDLevel()) continue;
+            setSIMDLevelLimit(level);
+            buildMipChain(rgba, texture);
+            if (texture.data != reference.data) {
+                cout << image << ": mip chain at " << simdLevelName(level) << " differs from the scalar one" << endl;
+                passed = false;
+            }
+        }
+        setSIMDLevelLimit(SIMD_AVX2);
+        double mipTime = bestTime(5, [&] { buildMipChain(rgba, texture); });
+
+        ProcessedTexture compressed;
+        double encodeTime = bestTime(3, [&] {
+            compressed = texture;
+            convertTexture(compressed, TEXTURE_BC1);
+        });
+
+        // error of the level 0 round trip through BC1
+        vector<unsigned char> decoded(texture.levels[0].size);
+        decodeBC1(compressed.data.data(), rgba->width, rgba->height, decoded.data());
+        double squaredError = 0;
+        for (size_t i = 0; i < decoded.size(); i++)
+            if (i % 4 != 3) squaredError += (decoded[i] - (int)rgba->data[i]) * (decoded[i] - (int)rgba->data[i]);
+        double meanSquaredError = squaredError / (3.0 * rgba->width * rgba->height);
+        double psnr = meanSquaredError > 0 ? 10 * log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+        double levelZeroBytes = (double)texture.levels[0].size;
+        totalRGBA += levelZeroBytes;
+        totalBC1 += compressed.data.size();
+        totalEncodeBytes += texture.data.size();
+        totalEncodeTime += encodeTime;
+        cout << left << setw(34) << image << right << fixed << setprecision(1) << setw(10) << levelZeroBytes / 1024
+             << setw(10) << texture.data.size() / 1024.0 << setw(9) << compressed.data.size() / 1024.0
+             << setw(7) << levelZeroBytes / compressed.data.size() << "x" << setprecision(3) << setw(11) << mipTime
+             << setw(10) << encodeTime << setprecision(1) << setw(10) << texture.data.size() / 1048576.0 / (encodeTime / 1000)
+             << setw(10) << psnr << endl;
+        delete[] rgba->data;
+        delete rgba;
+    }
+    cout << setprecision(1) << "all images: " << totalRGBA / 1024 << " KB as RGBA without mipmaps, "
+         << totalBC1 / 1024 << " KB as BC1 with mipmaps (" << totalRGBA / totalBC1 << "x smaller), BC1 encoder "
+         << totalEncodeBytes / 1048576.0 / (totalEncodeTime / 1000) << " MB/s of RGBA input" << endl;
+    cout << defaultfloat << "SIMD mip chains " << (passed ? "match" : "DO NOT match") << " the scalar ones" << endl;
+    return passed;
+}
+
+/**
+ * Simulate a scene that references more textures than the budget holds: every frame uses a few of
+ * "textures" synthetic textures of "size" KB, popular ones more often, through an AssetCache with a CPU
+ * budget of "budget" MB, trimming after each frame. Compared with loading every reference. Also checks
+ * that concurrent gets of one path load it once, that a load that throws is not cached, and that resize()
+ * updates the usage.
+ */
+bool benchmarkAssetCache()
+{
+    bool passed = true;
+    auto textureCount = (int)setting("textures", 256);
+    auto textureSize = (size_t)(setting("size", 1024) * 1024);
+    auto budget = (size_t)(setting("budget", 64) * 1048576.0);
+    auto frameCount = (int)setting("frames", 500);
+    const int perFrame = 16;
+
+    // the same references for both runs, skewed towards low texture numbers
+    vector<int> references;
+    mt19937 random(1);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int i = 0; i < frameCount * perFrame; i++) references.push_back((int)(textureCount * pow(uniform(random), 3.0)));
+
+    atomic<size_t> loads(0);
+    auto load = [&](int texture) {
+        loads++;
+        auto pixels = make_shared<vector<unsigned char>>(textureSize);
+        for (size_t i = 0; i < textureSize; i++) (*pixels)[i] = (unsigned char)(i * 31 + texture);
+        return pixels;
+    };
+
+    auto start = chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++) {
+        vector<shared_ptr<vector<unsigned char>>> used;
+        for (int i = 0; i < perFrame; i++) used.push_back(load(references[frame * perFrame + i]));
+    }
+    double uncachedTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    size_t uncachedLoads = loads;
+
+    loads = 0;
+    AssetCache cache(budget, 0);
+    size_t peakBytes = 0;
+    start = chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++) {
+        vector<AssetHandle<vector<unsigned char>>> used;
+        for (int i = 0; i < perFrame; i++) {
+            int texture = references[frame * perFrame + i];
+            used.push_back(cache.get<vector<unsigned char>>("texture" + to_string(texture), [&](size_t& cpuBytes, size_t&) {
+                cpuBytes = textureSize;
+                return load(texture);
+            }));
+        }
+        peakBytes = max(peakBytes, cache.stats().cpuBytes);
+        used.clear();
+        cache.trim();
+        if (cache.stats().cpuBytes > budget) passed = false;
+    }
+    double cachedTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    AssetCacheStats stats = cache.stats();
+    if (stats.misses != loads) passed = false;
+
+    cout << textureCount << " textures of " << textureSize / 1024 << " KB, " << frameCount << " frames of "
+         << perFrame << " references, budget " << budget / 1048576 << " MB" << endl;
+    cout << "  load every reference: " << uncachedLoads << " loads, " << fixed << setprecision(1) << uncachedTime << " ms" << endl;
+    cout << "  asset cache:          " << loads << " loads, " << cachedTime << " ms, " << stats.hits << " hits ("
+         << 100.0 * stats.hits / (stats.hits + stats.misses) << "%), " << stats.misses << " misses, " << stats.evictions
+         << " evictions, peak " << peakBytes / 1048576.0 << " MB, " << stats.cpuBytes / 1048576.0 << " MB resident after trim"
+         << defaultfloat << endl;
+
+    // 8 threads asking for one path at once load it once and share it
+    loads = 0;
+    AssetCache shared(budget, 0);
+    vector<thread> threads;
+    vector<AssetHandle<vector<unsigned char>>> handles(8);
+    for (int i = 0; i < 8; i++)
+        threads.emplace_back([&, i] {
+            handles[i] = shared.get<vector<unsigned char>>("texture0", [&](size_t& cpuBytes, size_t&) {
+                cpuBytes = textureSize;
+                return load(0);
+            });
+        });
+    for (thread& worker : threads) worker.join();
+    bool deduplicated = loads == 1 && all_of(handles.begin(), handles.end(), [&](const AssetHandle<vector<unsigned char>>& handle) {
+        return handle == handles[0];
+    });
+    passed = passed && deduplicated;
+    cout << "  8 concurrent gets of one path: " << loads << " load" << (deduplicated ? ", one shared asset" : ", NOT SHARED") << endl;
+
+    // a load that throws is not cached: the exception reaches the caller and the next get loads again
+    bool rethrown = false;
+    try {
+        shared.get<vector<unsigned char>>("broken", [](size_t&, size_t&) -> shared_ptr<vector<unsigned char>> {
+            throw runtime_error("cannot load");
+        });
+    }
+    catch (const runtime_error&) {
+        rethrown = true;
+    }
+    loads = 0;
+    bool reloaded = shared.get<vector<unsigned char>>("broken", [&](size_t& cpuBytes, size_t&) {
+        cpuBytes = textureSize;
+        return load(1);
+    }) && loads == 1;
+    passed = passed && rethrown && reloaded;
+    cout << "  load that throws: " << (rethrown ? "rethrown" : "NOT RETHROWN") << ", "
+         << (reloaded ? "loaded again by the next get" : "NOT LOADED AGAIN") << endl;
+
+    // an asset that grows after loading is counted at its new size, and one not cached is left alone
+    size_t before = shared.stats().cpuBytes;
+    shared.resize<vector<unsigned char>>("texture0", 3 * textureSize, textureSize);
+    shared.resize<vector<unsigned char>>("missing", textureSize, textureSize);
+    AssetCacheStats resized = shared.stats();
+    bool counted = resized.cpuBytes == before + 2 * textureSize && resized.gpuBytes == textureSize;
+    passed = passed && counted;
+    cout << "  resize: " << (counted ? "usage follows the new size" : "USAGE NOT UPDATED") << endl;
+    return passed;
+}
+/**
+ * Frame times while textures are streamed in: every "interval" frames a bundled image (RGBA8 mip chain, or BC1
+ * with format=bc1) starts uploading to a new texture, either synchronously at the start of the frame or
+ * through a TextureUploadQueue with "budget" MB per frame. Each frame draws "quads" textured quads and waits
+ * for the GL to finish, so upload work inside the driver is counted too. Also checks that the queue drops the
+ * uploads of a texture deleted while they are queued.
+ */
+bool benchmarkTextureUpload()
+{
+    const int width = 800, height = 800;
+    auto frameCount = (int)setting("frames", 300);
+    auto interval = (int)setting("interval", 10);
+    auto quadCount = (int)setting("quads", 200);
+    auto budget = (size_t)(setting("budget", 2) * 1048576.0);
+    TextureFormat format = settings["format"] == "bc1" ? TEXTURE_BC1 : TEXTURE_RGBA8;
+    createBenchmarkContext(width, height);
+
+    vector<shared_ptr<ProcessedTexture>> images;
+    for (const char *image : bundledImages) {
+        imageFile *rgba = getBMP(image);
+        if (!rgba) continue;
+        auto texture = make_shared<ProcessedTexture>();
+        buildMipChain(rgba, *texture);
+        convertTexture(*texture, format);
+        images.push_back(texture);
+        delete[] rgba->data;
+        delete rgba;
+    }
+    auto uploadsOf = [&](const ProcessedTexture& texture) {
+        vector<TextureUpload> uploads;
+        for (size_t i = 0; i < texture.levels.size(); i++) {
+            const TextureLevel& level = texture.levels[i];
+            bool compressed = texture.format == TEXTURE_BC1;
+            uploads.push_back({GL_TEXTURE_2D, (GLint)i, level.width, level.height,
+                               compressed ? (GLenum)GL_COMPRESSED_RGB_S3TC_DXT1_EXT : (GLenum)GL_RGBA,
+                               compressed ? (GLenum)0 : (GLenum)GL_RGBA, texture.data.data() + level.offset, level.size});
+        }
+        return uploads;
+    };
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glEnable(GL_TEXTURE_2D);
+
+    bool passed = true;
+    printFrameTimesHeader("uploads");
+    for (int streamed = 0; streamed < 2; streamed++) {
+        TextureUploadQueue queue;
+        if (streamed && !queue.create(16u << 20)) cout << "(no persistent mapping, the queue uploads synchronously)" << endl;
+        vector<GLuint> textures(frameCount / interval + 1);
+        glGenTextures((GLsizei)textures.size(), textures.data());
+        auto texturesOwner = make_shared<int>(0); // until the textures are deleted below
+        vector<bool> ready(textures.size(), false);
+        GLuint shown = 0; // newest ready texture
+        vector<double> frameTimes;
+        for (int frame = 0; frame < frameCount; frame++) {
+            auto start = chrono::steady_clock::now();
+            if (frame % interval == 0) {
+                int index = frame / interval;
+                const ProcessedTexture& image = *images[index % images.size()];
+                vector<TextureUpload> uploads = uploadsOf(image);
+                queue.enqueue(textures[index], texturesOwner, GL_TEXTURE_2D, uploads, images[index % images.size()],
+                              [&ready, index] { ready[index] = true; });
+                if (!streamed) queue.update(SIZE_MAX); // all levels now, from client memory
+            }
+            if (streamed) queue.update(budget);
+            for (size_t i = 0; i < ready.size(); i++)
+                if (ready[i]) shown = textures[i];
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            glBindTexture(GL_TEXTURE_2D, shown);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glBegin(GL_QUADS);
+            for (int i = 0; i < quadCount; i++) {
+                float x = (i % 20) / 20.0f, y = (i / 20 % 20) / 20.0f, size = 0.04f;
+                glTexCoord2f(0, 0); glVertex2f(x, y);
+                glTexCoord2f(4, 0); glVertex2f(x + size, y);
+                glTexCoord2f(4, 4); glVertex2f(x + size, y + size);
+                glTexCoord2f(0, 4); glVertex2f(x, y + size);
+            }
+            glEnd();
+            glFinish();
+            frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+
+        // a texture deleted before its levels are issued: they are dropped, and its name is not bound again
+        auto deleted = make_shared<GLuint>(0);
+        glGenTextures(1, deleted.get());
+        bool deletedReady = false;
+        queue.enqueue(*deleted, deleted, GL_TEXTURE_2D, uploadsOf(*images[0]), images[0], [&deletedReady] { deletedReady = true; });
+        glDeleteTextures(1, deleted.get());
+        deleted.reset();
+
+        while (!queue.idle()) queue.update(SIZE_MAX);
+        TextureUploadStats stats = queue.stats();
+        bool dropped = stats.texturesDropped == 1 && !deletedReady;
+        if (stats.texturesReady + stats.texturesDropped != stats.texturesQueued || !dropped || glGetError() != GL_NO_ERROR)
+            passed = false;
+        printFrameTimes(streamed ? "queue, " + to_string(budget / 1024) + " KB per frame" : "synchronous", frameTimes);
+        if (streamed)
+            cout << "  " << stats.texturesQueued << " textures, " << stats.bytesStaged / 1048576.0 << " MB through the ring, "
+                 << stats.bytesDirect / 1048576.0 << " MB direct, ring full in " << stats.framesRingFull << " frames" << endl;
+        cout << "  texture deleted while queued: " << (dropped ? "uploads dropped" : "UPLOADS NOT DROPPED") << endl;
+        queue.destroy();
+        glDeleteTextures((GLsizei)textures.size(), textures.data());
+    }
+    return passed;
+}
+
+/**
+ * Frame times and texture binds of a scene of "meshes" copies of the tiger (default 48), each textured with one
+ * of the bundled images that fit an atlas of "levels" levels: once with a bind per texture change, once with the
+ * images packed by buildTextureAtlas() and every copy's texture coordinates remapped into it, so the frame
+ * binds a single texture. Both frames are read back and compared.
+ */
+bool benchmarkTextureAtlas()
+{
+    const int width = 800, height = 800;
+    auto frameCount = (int)setting("frames", 300);
+    auto meshCount = (int)setting("meshes", 48);
+    auto levelCount = (int)setting("levels", 4);
+    TextureFormat format = settings["format"] == "rgba" ? TEXTURE_RGBA8 : TEXTURE_BC1;
+    createBenchmarkContext(width, height);
+
+    Mesh tiger;
+    if (!loadOBJFile("../models/Tiger.obj", tiger) || !tiger.hasTextureCoordinates()) return false;
+    ComputeBoundingBox(tiger);
+    vector<float> textureCoordinates(tiger.textureCoordinates, tiger.textureCoordinates + tiger.textureCoordinateCount * 2);
+
+    vector<ProcessedTexture> images;
+    int alignment = textureAtlasAlignment(format, levelCount);
+    for (const char *image : bundledImages) {
+        imageFile *rgba = getBMP(image);
+        if (!rgba) continue;
+        ProcessedTexture texture;
+        buildMipChain(rgba, texture);
+        convertTexture(texture, format);
+        if (rgba->width % alignment == 0 && rgba->height % alignment == 0) images.push_back(move(texture));
+        delete[] rgba->data;
+        delete rgba;
+    }
+    vector<const ProcessedTexture *> packed;
+    for (const ProcessedTexture& image : images) packed.push_back(&image);
+    TextureAtlas atlas;
+    auto atlasTime = bestTime(1, [&] { buildTextureAtlas(packed, levelCount, atlas); });
+    if (atlas.entries.size() != images.size()) return false;
+    vector<vector<float>> atlasCoordinates(images.size(), textureCoordinates);
+    for (size_t i = 0; i < images.size(); i++)
+        if (!remapTextureCoordinates(atlas, (int)i, atlasCoordinates[i].data(), tiger.textureCoordinateCount)) return false;
+    cout << images.size() << " textures packed into a " << atlas.texture.levels[0].width << "x" << atlas.texture.levels[0].height
+         << " atlas (" << atlas.texture.data.size() / 1024 << " KB) in " << atlasTime << " ms, "
+         << tiger.faceCount << " triangles per mesh" << endl;
+
+    auto upload = [](const ProcessedTexture& texture, int levels, GLint wrap) {
+        GLuint id;
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+        for (int i = 0; i < levels; i++) {
+            const TextureLevel& level = texture.levels[i];
+            if (texture.format == TEXTURE_BC1)
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0,
+                                       (GLsizei)level.size, texture.data.data() + level.offset);
+            else
+                glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             texture.data.data() + level.offset);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return id;
+    };
+    vector<GLuint> textures;
+    for (const ProcessedTexture& image : images) textures.push_back(upload(image, (int)image.levels.size(), GL_REPEAT));
+    GLuint atlasTexture = upload(atlas.texture, levelCount, GL_CLAMP_TO_EDGE);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(60.0, 1.0, 1.0, 200.0);
+    glMatrixMode(GL_MODELVIEW);
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, tiger.positions);
+
+    bool passed = true;
+    vector<unsigned char> pixels[2];
+    printFrameTimesHeader("binds per frame");
+    for (int useAtlas = 0; useAtlas < 2; useAtlas++) {
+        vector<double> frameTimes;
+        size_t binds = 0;
+        for (int frame = 0; frame < frameCount; frame++) {
+            auto start = chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            binds = 0;
+            GLuint bound = 0;
+            for (int i = 0; i < meshCount; i++) {
+                size_t image = i % images.size();
+                GLuint texture = useAtlas ? atlasTexture : textures[image];
+                if (texture != bound) {
+                    glBindTexture(GL_TEXTURE_2D, texture);
+                    bound = texture;
+                    binds++;
+                }
+                glTexCoordPointer(2, GL_FLOAT, 0, useAtlas ? atlasCoordinates[image].data() : textureCoordinates.data());
+                glLoadIdentity();
+                glTranslatef(((i % 8) - 3.5f) * 6.0f, ((i / 8 % 6) - 2.5f) * 6.0f, -45.0f);
+                glScalef(5.0f / tiger.diagonalLength, 5.0f / tiger.diagonalLength, 5.0f / tiger.diagonalLength);
+                glDrawElements(GL_TRIANGLES, (GLsizei)(tiger.faceCount * 3), GL_UNSIGNED_INT, tiger.faces);
+            }
+            glFinish();
+            frameTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        pixels[useAtlas] = readFrame(width, height);
+        printFrameTimes(to_string(binds) + (useAtlas ? " (atlas)" : " (texture each)"), frameTimes);
+    }
+    if (glGetError() != GL_NO_ERROR) passed = false;
+
+    // the atlas stops at levelCount levels, so distant copies may be sharper; count clearly different pixels
+    size_t different = countDifferentPixels(pixels[0], pixels[1], 32);
+    double differentShare = 100.0 * different / (width * height);
+    cout << "pixels differing between the frames: " << differentShare << "%" << endl;
+    if (differentShare > 2.0) passed = false;
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDeleteTextures((GLsizei)textures.size(), textures.data());
+    glDeleteTextures(1, &atlasTexture);
+    return passed;
+}
+
+} // namespace
+
+vector<Benchmark> textureBenchmarks()
+{
+    return {
+        {"bmp", benchmarkBMP, false},
+        {"texture", benchmarkTexture, false},
+        {"assetcache", benchmarkAssetCache, false},
+        {"upload", benchmarkTextureUpload, true},
+        {"atlas", benchmarkTextureAtlas, true},
+    };
+}
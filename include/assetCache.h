@@ -0,0 +1,137 @@
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <cstddef>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <utility>
+
+/**
+ * Reference counted handle to a cached asset. The asset stays loaded while any handle to it exists.
+ */
+template <typename T>
+using AssetHandle = std::shared_ptr<T>;
+
+/**
+ * Counters and byte usage of an AssetCache.
+ */
+struct AssetCacheStats
+{
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t assets = 0;
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+    size_t cpuBudget = 0;
+    size_t gpuBudget = 0;
+};
+
+/**
+ * Assets keyed by path and type, loaded once and shared through AssetHandles. Each asset reports the
+ * CPU and GPU memory it uses; trim() evicts the least recently used assets that have no handle left
+ * until both budgets are met. Assets that are still referenced are never evicted, so usage may exceed
+ * the budget while they are in use.
+ *
+ * get() may be called from any thread; a second get() of an asset that is still loading waits for the
+ * first. Assets are destroyed by trim() or by the thread releasing their last handle, so assets owning
+ * GL objects must only be trimmed on the GL thread.
+ */
+class AssetCache
+{
+public:
+    AssetCache(size_t cpuBudget, size_t gpuBudget) : cpuBudget(cpuBudget), gpuBudget(gpuBudget) {}
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    /**
+     * Get the asset of type T for a path, loading it on a miss.
+     * @param load Called as load(cpuBytes, gpuBytes) on a miss, returns a std::shared_ptr<T> or nullptr on
+     *             failure and sets the bytes the asset uses. Failed loads are not cached. An exception it throws
+     *             is rethrown here and by the get()s waiting for the load, and the next get() loads again.
+     * @return The asset, or nullptr if it failed to load.
+     */
+    template <typename T, typename Load>
+    AssetHandle<T> get(const std::string& path, Load load)
+    {
+        Key key(std::type_index(typeid(T)), path);
+        std::promise<std::shared_ptr<void>> promise;
+        std::shared_future<std::shared_ptr<void>> asset;
+        if (lookup(key, promise, asset)) {
+            size_t cpuBytes = 0, gpuBytes = 0;
+            std::shared_ptr<void> loaded;
+            try {
+                loaded = std::shared_ptr<T>(load(cpuBytes, gpuBytes));
+            }
+            catch (...) {
+                promise.set_exception(std::current_exception());
+                finish(key, false, 0, 0);
+                throw;
+            }
+            promise.set_value(loaded);
+            bool succeeded = loaded != nullptr;
+            loaded.reset();
+            finish(key, succeeded, cpuBytes, gpuBytes);
+        }
+        return std::static_pointer_cast<T>(asset.get());
+    }
+
+    /**
+     * Update the bytes a loaded asset of type T uses, after it grows or shrinks (e.g. data made or freed on first use).
+     * Does nothing if the asset is not cached or still loading.
+     */
+    template <typename T>
+    void resize(const std::string& path, size_t cpuBytes, size_t gpuBytes)
+    {
+        resize(Key(std::type_index(typeid(T)), path), cpuBytes, gpuBytes);
+    }
+
+    /**
+     * Evict least recently used unreferenced assets until CPU and GPU usage are within budget.
+     * @return Number of assets evicted.
+     */
+    size_t trim();
+
+    /**
+     * Evict every unreferenced asset.
+     */
+    void clear();
+
+    void setBudget(size_t cpuBytes, size_t gpuBytes);
+
+    AssetCacheStats stats() const;
+
+private:
+    typedef std::pair<std::type_index, std::string> Key;
+
+    struct Entry
+    {
+        std::shared_future<std::shared_ptr<void>> asset;
+        bool loaded = false;
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+        std::list<Key>::iterator recent; // position in recentlyUsed
+    };
+
+    // Find a key, or add it for loading. Returns true if the caller must load the asset and fulfil the promise.
+    bool lookup(const Key& key, std::promise<std::shared_ptr<void>>& promise,
+                std::shared_future<std::shared_ptr<void>>& asset);
+    // Record the size of a loaded asset, or drop the entry of a failed load.
+    void finish(const Key& key, bool loaded, size_t cpuBytes, size_t gpuBytes);
+    void resize(const Key& key, size_t cpuBytes, size_t gpuBytes);
+    size_t evict(bool all);
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+    std::list<Key> recentlyUsed; // most recently used first
+    size_t cpuBudget, gpuBudget;
+    size_t cpuBytes = 0, gpuBytes = 0;
+    size_t hits = 0, misses = 0, evictions = 0;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// x86 SIMD kernels are compiled with per-function target attributes and picked at run time,
+// so the whole program does not need to be built for a newer instruction set.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+// for kernels that must round exactly like the scalar code: without FMA a multiply and an add are never fused
+#define TARGET_AVX2_NOFMA __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_SSE41
+#define TARGET_AVX2
+#define TARGET_AVX2_NOFMA
+#endif
+
+/**
+ * SIMD instruction set levels, each one implying the ones before it.
+ */
+enum SIMDLevel { SIMD_SCALAR = 0, SIMD_SSSE3 = 1, SIMD_SSE41 = 2, SIMD_AVX2 = 3 };
+
+/**
+ * Highest level supported by the CPU and the operating system, detected with CPUID once.
+ */
+SIMDLevel cpuSIMDLevel();
+
+/**
+ * Level the kernels should use: cpuSIMDLevel() capped by setSIMDLevelLimit().
+ */
+SIMDLevel activeSIMDLevel();
+
+/**
+ * Cap the level used by the kernels, e.g. SIMD_SCALAR to compare against the scalar code.
+ */
+void setSIMDLevelLimit(SIMDLevel limit);
+
+const char *simdLevelName(SIMDLevel level);
+
+#endif
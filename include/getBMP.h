@@ -1,6 +1,10 @@
 #ifndef GETBMP_H
 #define GETBMP_H
 
+#include <string>
+
+#include "mappedFile.h"
+
 struct imageFile
 {
 	int width;
@@ -8,6 +12,37 @@ struct imageFile
 	unsigned char *data;
 };
 
+/**
+ * Pixels of an uncompressed 24-bit BMP file, read in place from a memory mapping.
+ * Rows are stored bottom row first in BGR order, each padded to a multiple of 4 bytes, which is what
+ * glTexImage2D expects for GL_BGR data with GL_UNPACK_ALIGNMENT 4.
+ */
+struct bmpView
+{
+	int width = 0;
+	int height = 0;
+	int rowSize = 0; // bytes per row including padding
+	const unsigned char *data = nullptr; // first pixel of the bottom row
+	MappedFile file;
+};
+
+/**
+ * Map a BMP file and locate its pixel data without copying it.
+ * @return false if the file cannot be opened or is not an uncompressed, bottom-up 24-bit BMP.
+ */
+bool mapBMP(const std::string& fileName, bmpView& view);
+
+/**
+ * Convert the BGR pixels of a mapped BMP into tightly packed RGBA (alpha 0xFF) in one pass,
+ * using SSSE3 or AVX2 byte shuffles where the CPU has them.
+ * @param out Caller provided storage for width * height * 4 bytes.
+ */
+void convertBGRToRGBA(const bmpView& view, unsigned char *out);
+
+/**
+ * Read an uncompressed 24-bit BMP file into a 32-bit RGBA image (alpha values all being set to 1).
+ * @return The image, to be released with delete[] image->data and delete image; nullptr if the file is not a supported BMP.
+ */
 imageFile *getBMP(const std::string& fileName);
 
 #endif
@@ -0,0 +1,52 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only or copy-on-write memory mapping of a whole file.
+ * The file content is available through data() and size() until close() is called or the object is destroyed.
+ * An empty file opens successfully with data() == nullptr and size() == 0.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& fileName) { open(fileName); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Map a file into memory, closing any previously mapped file first.
+     * @param fileName The name of the file to map.
+     * @param copyOnWrite Map the file so that it can be written through writableData(): the pages written are
+     *        copied for this process, and the file itself never changes.
+     * @return true if the file was opened and mapped.
+     */
+    bool open(const std::string& fileName, bool copyOnWrite = false);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char *data() const { return begin; }
+    size_t size() const { return length; }
+
+    /**
+     * The content of a file mapped copy-on-write, nullptr if it is mapped read-only.
+     */
+    char *writableData() const { return writable ? (char *)begin : nullptr; }
+
+private:
+    const char *begin = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool writable = false;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <memory>
+
+class MappedFile;
+
+/**
+ * Attributes derived from a mesh's geometry, allocated only when computed, see Mesh::allocateAttribute().
+ */
+enum MeshAttribute
+{
+    MESH_FACE_NORMALS = 1,
+    MESH_VERTEX_NORMALS = 2,
+    MESH_FACE_AREAS = 4,
+    MESH_ALL_ATTRIBUTES = 7
+};
+
+/**
+ * A processed model. Its geometry streams live in one arena allocation, each stream starting at a
+ * 64 byte aligned offset, so loading a model costs one allocation:
+ *
+ *   positions           {x0, y0, z0, x1, y1, z1, ... }, vertexCount vertices
+ *   textureCoordinates  {u0, v0, u1, v1, ... }, textureCoordinateCount pairs, indexed like the vertices
+ *   faces               {f0v0, f0v1, f0v2, f1v0, ... }, faceCount triangles of 0-based vertex indices
+ *
+ * The attributes derived from them are allocated separately (64 byte aligned too) when they are computed and
+ * may be released again, their pointers are null while they are absent:
+ *
+ *   faceNormals         {x0, y0, z0, ... }, one unit normal per face, used in flat shading
+ *   vertexNormals       {x0, y0, z0, ... }, one unit normal per vertex, used in smooth shading
+ *   faceAreas           {area0, area1, ... }, one per face, the weights of the vertex normals
+ *
+ * See requireFaceNormals() and requireVertexNormals() in meshProcessing.h for computing them on first use.
+ * Each stream keeps its components together so it can be handed to the GL as a vertex array.
+ * A mesh read from a mesh cache borrows the cache file's mapping instead of an arena, see adoptMapping().
+ * A Mesh can be moved but not copied; the pointers stay valid until it is reallocated or destroyed, or the
+ * attribute is released.
+ */
+struct Mesh
+{
+    size_t vertexCount = 0;
+    size_t textureCoordinateCount = 0;
+    size_t faceCount = 0;
+    float center[3] = {0.0f, 0.0f, 0.0f}; // bounding box center before centring
+    float diagonalLength = 0.0f;
+
+    float *positions = nullptr;
+    float *textureCoordinates = nullptr;
+    int *faces = nullptr;
+    float *faceNormals = nullptr;
+    float *vertexNormals = nullptr;
+    float *faceAreas = nullptr;
+
+    Mesh();
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    ~Mesh();
+
+    /**
+     * Replace the arena with one holding the geometry streams for the given counts, and release every attribute.
+     * The contents are undefined.
+     * faceCount may be lowered afterwards (e.g. when malformed faces are dropped) without reallocating.
+     */
+    void allocate(size_t vertices, size_t textureCoordinatePairs, size_t triangles);
+
+    /**
+     * Replace the arena with a file mapped copy-on-write (see MappedFile::open()), and release every attribute. The
+     * caller then sets the counts and points the streams, and any attributes the file holds, into the mapping;
+     * writing to them copies the pages written and never changes the file. Attributes in the mapping are counted
+     * in arenaBytes(), and releasing them frees nothing until the mesh is reallocated or destroyed.
+     * @return The start of the mapping.
+     */
+    char *adoptMapping(std::unique_ptr<MappedFile> file);
+
+    /**
+     * Allocate an attribute for the current counts if it is absent, and set its pointer. The contents of a newly
+     * allocated attribute are undefined.
+     * @param attribute A single attribute.
+     */
+    float *allocateAttribute(MeshAttribute attribute);
+
+    /**
+     * Free the attributes of a mask and null their pointers.
+     */
+    void releaseAttributes(unsigned int attributes);
+
+    /**
+     * @return The mask of the attributes allocated.
+     */
+    unsigned int attributes() const;
+
+    bool hasTextureCoordinates() const { return textureCoordinateCount != 0; }
+
+    /**
+     * Bytes of the geometry arena, including alignment padding, or of the adopted mapping.
+     */
+    size_t arenaBytes() const { return arenaSize; }
+
+    /**
+     * Bytes of the allocated attributes, including alignment padding.
+     */
+    size_t attributeBytes() const;
+
+private:
+    std::unique_ptr<unsigned char[]> arena;
+    std::unique_ptr<MappedFile> mapping; // instead of the arena, see adoptMapping()
+    size_t arenaSize = 0;
+    std::unique_ptr<unsigned char[]> attributeBlocks[3]; // face normals, vertex normals, face areas
+    size_t attributeSizes[3] = {0, 0, 0};
+
+    float *&attributePointer(int index);
+};
+
+#endif
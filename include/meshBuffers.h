@@ -0,0 +1,86 @@
+#ifndef MESHBUFFERS_H
+#define MESHBUFFERS_H
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mesh.h"
+
+/**
+ * A mesh uploaded to the GL once and drawn with glDrawElements: an interleaved vertex buffer
+ *
+ *   {x, y, z, nx, ny, nz, u, v}  per vertex, without {u, v} if the mesh has no texture coordinates
+ *
+ * and an index buffer (16 bit if the vertices allow it), bound in a vertex array object to the fixed function
+ * arrays (glVertexPointer() and friends), so that drawing is lit and textured as in immediate mode.
+ *
+ * Smooth shaded meshes are uploaded with their vertex normals. Flat shaded ones get a provoking vertex per face:
+ * each face is rotated to end on a vertex that carries its face normal, a copy of one of its vertices if every
+ * one already provokes another face, and glShadeModel(GL_FLAT) lights the whole face with it. Faces keep their
+ * order, so a range of faces (e.g. of the meshlets left after culling) is a range of the index buffer.
+ *
+ * All calls must be made on the GL thread, and destroy() must be called while the context exists.
+ */
+class MeshBuffers
+{
+public:
+    MeshBuffers() = default;
+    MeshBuffers(const MeshBuffers&) = delete;
+    MeshBuffers& operator=(const MeshBuffers&) = delete;
+
+    /**
+     * Upload a mesh with the normals of its shading, which are computed if the mesh does not have them (and are
+     * left to the caller to release). Replaces what was uploaded before.
+     * @return false if the context has no vertex array objects (OpenGL 3.0).
+     */
+    bool create(Mesh& mesh, bool flatShaded);
+
+    /**
+     * Delete the buffers and the vertex array.
+     */
+    void destroy();
+
+    bool created() const { return vertexArray != 0; }
+    bool flatShaded() const { return flat; }
+    bool textured() const { return withTextureCoordinates; }
+
+    /**
+     * Vertices uploaded: the mesh's, plus the copies made for provoking vertices when flat shaded.
+     */
+    size_t vertexCount() const { return vertices; }
+
+    /**
+     * Bytes of the vertex and index buffers.
+     */
+    size_t bytes() const { return bufferBytes; }
+
+    /**
+     * Draw ranges of faces with one glDrawElements() or glMultiDrawElements() call. Leaves the vertex array and the
+     * shade model as they were set before, so set glShadeModel() for the shading the buffers were made for.
+     * @param faceRanges {first face, face count} pairs.
+     */
+    void draw(const std::vector<std::pair<size_t, size_t>>& faceRanges);
+
+    /**
+     * Draw every face instanceCount times with glDrawElementsInstanced(), for a vertex shader reading the fixed
+     * function arrays (gl_Vertex, gl_Normal, gl_MultiTexCoord0).
+     * @param bindInstances Called with the vertex array bound, to point generic attributes (other than 0) at per
+     *        instance data; they stay in the vertex array, where the fixed function pipeline ignores them.
+     */
+    void drawInstanced(size_t instanceCount, const std::function<void()>& bindInstances);
+
+private:
+    GLuint vertexArray = 0, vertexBuffer = 0, indexBuffer = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexSize = 4;
+    size_t vertices = 0, indexCount = 0, bufferBytes = 0;
+    bool flat = false, withTextureCoordinates = false;
+    std::vector<GLsizei> counts; // scratch for glMultiDrawElements()
+    std::vector<const void *> offsets;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <string>
+
+#include "mesh.h"
+
+/**
+ * Binary cache of a processed model, so that a model only has to be parsed, welded and centred once. A cache file stores the streams of a Mesh (centred vertices, texture coordinates, faces, and
+ * those of face normals, vertex normals and face areas that were computed) with its bounding box center and
+ * diagonal length, and is keyed by the size, modification time and content hash of the OBJ file it was made from.
+ *
+ * Layout (native byte order): a MeshCacheHeader followed by the arrays, each starting at a 64 byte
+ * aligned offset recorded in the header, as the streams of a Mesh do. Absent attributes are stored as empty arrays.
+ */
+#define MESH_CACHE_VERSION 6
+
+/**
+ * Cache file name for a model, e.g. "../models/Bunny.obj" is cached as "Bunny.obj.meshcache" in the working directory.
+ */
+std::string meshCacheFileName(const std::string& sourceFileName);
+
+/**
+ * Check whether a cache file exists and is up to date with its source file, without reading the arrays.
+ */
+bool isMeshCacheCurrent(const std::string& cacheFileName, const std::string& sourceFileName);
+
+/**
+ * Read a model from its cache file if the cache is up to date with the source file. Nothing is copied: the mesh
+ * adopts the file mapped copy-on-write (see Mesh::adoptMapping()), its streams and the attributes that are cached
+ * pointing into it, and the pages of the file are read as they are used.
+ * A source whose modification time changed is hashed and still accepted if its content is the same.
+ * @return false on a cache miss (missing, outdated, different version or damaged cache), the mesh is untouched then.
+ */
+bool readMeshCache(const std::string& cacheFileName, const std::string& sourceFileName, Mesh& mesh);
+
+/**
+ * Write a processed model to its cache file. The file is written under a temporary name and then
+ * renamed, so a reader never sees a half written cache.
+ * @return false if the source or cache file cannot be accessed.
+ */
+bool writeMeshCache(const std::string& cacheFileName, const std::string& sourceFileName, const Mesh& mesh);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef MESHEMISSION_H
+#define MESHEMISSION_H
+
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/**
+ * The loop that sends a mesh's triangles corner by corner, as glBegin(GL_TRIANGLES) takes them, compiled for each
+ * combination of shading, texture coordinates and index type so that it has no branches per triangle or vertex.
+ * emitMeshTriangles() picks the specialization once per mesh.
+ *
+ * The loop reads the indices; a sink holds the pointers to the attributes and receives, for each face:
+ *
+ *   faceNormal(face)            flat shading, once before the corners of the face
+ *   vertexNormal(vertex)        smooth shading, for each corner
+ *   textureCoordinate(vertex)   if the mesh is textured, for each corner
+ *   vertex(vertex)              for each corner, last
+ *
+ * A sink defines all four (those a specialization does not call are compiled out).
+ */
+template <bool FlatShaded, bool Textured, typename Index, typename Sink>
+inline void emitTriangles(const Index *faces, const std::vector<std::pair<size_t, size_t>>& faceRanges, Sink& sink)
+{
+    Sink local = sink; // a copy whose members can stay in registers
+    for (const auto& range : faceRanges) {
+        const Index *corners = faces + range.first * 3, *end = faces + (range.first + range.second) * 3;
+        for (size_t face = range.first; corners != end; face++, corners += 3) {
+            if (FlatShaded) local.faceNormal(face);
+            for (int corner = 0; corner < 3; corner++) {
+                size_t vertex = corners[corner];
+                if (!FlatShaded) local.vertexNormal(vertex);
+                if (Textured) local.textureCoordinate(vertex);
+                local.vertex(vertex);
+            }
+        }
+    }
+    sink = local;
+}
+
+/**
+ * Send ranges of faces to a sink with the specialization of emitTriangles() for the shading and texture.
+ * @param faceRanges {first face, face count} pairs.
+ */
+template <typename Index, typename Sink>
+void emitMeshTriangles(bool flatShaded, bool textured, const Index *faces,
+                       const std::vector<std::pair<size_t, size_t>>& faceRanges, Sink& sink)
+{
+    if (flatShaded) {
+        if (textured) emitTriangles<true, true>(faces, faceRanges, sink);
+        else emitTriangles<true, false>(faces, faceRanges, sink);
+    }
+    else {
+        if (textured) emitTriangles<false, true>(faces, faceRanges, sink);
+        else emitTriangles<false, false>(faces, faceRanges, sink);
+    }
+}
+
+/**
+ * A sink that writes the corners of float attributes into an interleaved vertex stream without indices, in the
+ * layout of glInterleavedArrays(GL_T2F_N3F_V3F) (or GL_N3F_V3F if the mesh is not textured):
+ *
+ *   {u, v, nx, ny, nz, x, y, z}  per corner, each attribute written as it is received
+ *
+ * The stream must have room for 8 (or 6) floats per corner; out is left past the last corner written.
+ */
+struct VertexStreamSink
+{
+    const float *positions;
+    const float *normals; // face normals in flat shading, vertex normals in smooth shading
+    const float *textureCoordinates;
+    float *out;
+    const float *normal = nullptr; // of the corner being written
+
+    void faceNormal(size_t face) { normal = normals + face * 3; }
+    void vertexNormal(size_t vertex) { normal = normals + vertex * 3; }
+    void textureCoordinate(size_t vertex)
+    {
+        std::memcpy(out, textureCoordinates + vertex * 2, 2 * sizeof(float));
+        out += 2;
+    }
+    void vertex(size_t vertex)
+    {
+        std::memcpy(out, normal, 3 * sizeof(float));
+        std::memcpy(out + 3, positions + vertex * 3, 3 * sizeof(float));
+        out += 6;
+    }
+};
+
+#endif
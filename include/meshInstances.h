@@ -0,0 +1,132 @@
+#ifndef MESHINSTANCES_H
+#define MESHINSTANCES_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mesh.h"
+#include "meshBuffers.h"
+#include "meshLod.h"
+#include "meshlet.h"
+
+/**
+ * One copy of a mesh in the scene, 5 vec4 attributes of the instance buffer: its model transform (column-major, as
+ * glMultMatrixf() takes it; a rotation, a uniform scale and a translation), its color (the material's ambient and
+ * diffuse color) and its shading, 1 for flat and 0 for smooth.
+ */
+struct MeshInstance
+{
+    float transform[16];
+    float color[3];
+    float flatShaded;
+};
+
+/**
+ * How scatterInstances() makes copies of a model: set up as drawMesh() draws it, then turned about the vertical.
+ */
+struct ScatteredModel
+{
+    float scale; // units of the scene per unit of the mesh
+    float rotation[3]; // degrees about x, y and z, applied in drawMesh()'s order
+    float height; // of the mesh's origin above the ground
+    float color[3];
+    bool flatShaded;
+};
+
+/**
+ * The transform drawMesh() draws a mesh with: translate, then scale, then rotate by angles (degrees) about x, y and z.
+ */
+void setInstanceTransform(const float *translate, float scale, const float *angles, float *transform);
+
+/**
+ * Make a stress scene: count copies of the models at random spots of a square field centred on the origin, each
+ * turned about the vertical by a random angle and its color darkened by up to a third.
+ * @param instancesOf Receives the instances of each model.
+ */
+void scatterInstances(const std::vector<ScatteredModel>& models, size_t count, float fieldSize, unsigned int seed,
+                      std::vector<std::vector<MeshInstance>>& instancesOf);
+
+/**
+ * Sort the instances of a mesh into the levels of detail selectMeshLod() picks for them (without hysteresis, which
+ * would need a level per instance), leaving out those whose bounding sphere is outside the view.
+ * @param radius Radius of the mesh's bounding sphere around its origin, in its units.
+ * @param view The view in the coordinates of the instance transforms, see meshletViewFromMatrices().
+ * @param levels Receives the instances of level 0 (the full mesh), 1 (lods[0]), ...
+ * @return Number of instances kept.
+ */
+size_t sortInstancesByLod(const std::vector<MeshInstance>& instances, const std::vector<MeshLod>& lods, float radius,
+                          const MeshletView& view, float fieldOfView, int height, float threshold,
+                          std::vector<std::vector<MeshInstance>>& levels);
+
+/**
+ * Draws the instances of a mesh with one glDrawElementsInstanced() from its MeshBuffers, the instances streamed
+ * into a buffer each draw. A GLSL program transforms them and lights every fragment with the fixed function
+ * equations, from the GL state the scene sets: GL_LIGHT0 (without a spot cone), the light model's ambient color
+ * and two-sided lighting with a local viewer, and the material's specular color and shininess. Flat shaded
+ * instances are lit with the normal of the face, from the derivatives of the position, so the buffers are
+ * made smooth shaded. Textured meshes are modulated by the texture bound to unit 0 if GL_TEXTURE_2D is enabled.
+ * All calls must be made on the GL thread, and destroy() must be called while the context exists.
+ */
+class InstancedMeshRenderer
+{
+public:
+    InstancedMeshRenderer() = default;
+    InstancedMeshRenderer(const InstancedMeshRenderer&) = delete;
+    InstancedMeshRenderer& operator=(const InstancedMeshRenderer&) = delete;
+
+    /**
+     * Compile the program and make the instance buffer.
+     * @return false if the context has no instanced arrays (OpenGL 3.3) or the program does not build, whose log
+     *         is printed.
+     */
+    bool create();
+
+    void destroy();
+
+    bool created() const { return program != 0; }
+
+    /**
+     * Draw instances of a mesh, uploaded with buffers.create(mesh, false).
+     */
+    void draw(MeshBuffers& buffers, const std::vector<MeshInstance>& instances);
+
+private:
+    GLuint program = 0, instanceBuffer = 0;
+    GLint texturedLocation = -1;
+};
+
+/**
+ * Draws instances without shaders or instancing: batches of instances are transformed on the CPU into one stream
+ * of {u, v, r, g, b, nx, ny, nz, x, y, z} corners (without {u, v} if the mesh is not textured), written by the
+ * loops of meshEmission.h, and each batch is drawn with one glDrawArrays() from client arrays, lit by the fixed
+ * function pipeline with GL_COLOR_MATERIAL. Flat shaded instances get the face normal at every corner.
+ */
+class InstanceBatcher
+{
+public:
+    /**
+     * @param batchCorners Corners of a batch, or of one instance if it has more.
+     */
+    explicit InstanceBatcher(size_t batchCorners = 3 * 65536) : batchCorners(batchCorners) {}
+
+    /**
+     * Draw instances of a mesh, computing the normals they are shaded with if the mesh does not have them.
+     * Enables GL_NORMALIZE, which the scaled normals need.
+     */
+    void draw(Mesh& mesh, const std::vector<MeshInstance>& instances);
+
+    size_t batchesDrawn() const { return batches; }
+
+private:
+    size_t batchCorners;
+    size_t batches = 0;
+    std::vector<float> stream;
+    std::vector<std::pair<size_t, size_t>> allFaces;
+
+    void flush(size_t corners);
+};
+
+#endif
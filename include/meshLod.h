@@ -0,0 +1,65 @@
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include <vector>
+
+#include "mesh.h"
+
+// Levels of detail of a model, the full mesh included, and the fewest faces buildMeshLods() simplifies a level to.
+#define MESH_MAX_LODS 8
+#define MESH_LOD_MIN_FACES 64
+
+// A coarser level is only selected once its error is within this fraction of the threshold, so that a model near a
+// switching distance does not pop back and forth between two levels.
+#define MESH_LOD_HYSTERESIS 0.75f
+
+/**
+ * A simplified copy of a mesh and its geometric error: how far (in the mesh's units) its surface may stray from the
+ * full mesh.
+ */
+struct MeshLod
+{
+    Mesh mesh;
+    float error = 0.0f;
+};
+
+/**
+ * Simplify a mesh to about targetFaceCount faces by edge collapses in the order of their quadric error (Garland and
+ * Heckbert), the quadrics of each vertex being the area weighted planes of its faces plus, for the edges of open
+ * borders and texture seams, planes through the edge perpendicular to its face.
+ * Each collapse moves a vertex onto a neighbour, so the simplified mesh keeps a subset of the vertices with their
+ * texture coordinates. Vertices that share a position across a texture seam collapse together, along the seam only,
+ * so the texture stays continuous; border vertices only collapse along the border. Collapses that would flip a
+ * face are skipped. Independent collapses are made in passes, each over the edges sorted by error.
+ * The simplified mesh has positions, texture coordinates and faces; its vertices are in the order the faces first
+ * use them, and it keeps the center and diagonalLength of the mesh.
+ * @return The largest error of a collapse, as a distance in the mesh's units (the root of the mean squared distance
+ *         to the planes of the merged quadric). Fewer faces than asked for may be left if no collapse is possible.
+ */
+float simplifyMesh(const Mesh& mesh, size_t targetFaceCount, Mesh& simplified);
+
+/**
+ * Build the chain of levels of detail of a mesh, each simplified from the previous one to half its faces and
+ * reordered for the vertex cache, until a level would have fewer than MESH_LOD_MIN_FACES faces, stops shrinking or
+ * MESH_MAX_LODS levels are reached. The error of a level adds up the errors of the steps that lead to it, so it
+ * bounds the distance to the full mesh.
+ * @param lods Receives levels 1, 2, ...; the full mesh is level 0.
+ */
+void buildMeshLods(const Mesh& mesh, std::vector<MeshLod>& lods);
+
+/**
+ * Pixels on screen per unit of a mesh drawn scaled by scale, at distance (in units of the scene) from the camera,
+ * with a perspective projection of fieldOfView degrees vertically onto a viewport height pixels high.
+ */
+float lodPixelsPerUnit(float scale, float distance, float fieldOfView, int height);
+
+/**
+ * Select the coarsest level whose error is at most threshold pixels on screen, with MESH_LOD_HYSTERESIS applied
+ * to levels coarser than the current one.
+ * @param pixelsPerUnit Pixels on screen per unit of the mesh, at the nearest point of the mesh.
+ * @param current The level selected last time, 0 for the full mesh.
+ * @return 0 for the full mesh, level i for lods[i - 1].
+ */
+int selectMeshLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float threshold, int current);
+
+#endif
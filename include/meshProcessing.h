@@ -0,0 +1,183 @@
+#ifndef MESHPROCESSING_H
+#define MESHPROCESSING_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mesh.h"
+
+/**
+ * Load a model file, picking the importer from the file extension: binary PLY for ".ply", OBJ otherwise.
+ * @param threadCount Number of parsing threads for OBJ files, see loadOBJFile().
+ * @return false if the file cannot be opened or read.
+ */
+bool loadModelFile(const std::string& fileName, std::vector<float>& vertices, std::vector<float>& textureCoordinates,
+                   std::vector<int>& faces, unsigned int threadCount = 0);
+
+/**
+ * Load a model file into a mesh, with the same importer choice as loadModelFile(). OBJ files are parsed straight
+ * into the mesh arena; PLY files are read and then copied into it. Only positions, texture coordinates and faces
+ * are filled.
+ * @param streamBudget If not 0, an OBJ file larger than this many bytes is parsed by streamOBJFile() within this
+ *        memory budget instead, and its arrays are copied into the arena from the backing files.
+ * @return false if the file cannot be opened or read, the mesh is left unchanged in that case.
+ */
+bool loadMesh(const std::string& fileName, Mesh& mesh, unsigned int threadCount = 0, size_t streamBudget = 0);
+
+/**
+ * Vertices and faces removed by weldMesh().
+ */
+struct WeldStatistics
+{
+    size_t removedVertices = 0;
+    size_t removedFaces = 0;
+};
+
+/**
+ * Merge the vertices of a freshly loaded mesh that lie within tolerance of each other, e.g. the copies exporters
+ * write for split normals, and drop the faces that become degenerate (two corners on one vertex) or have no area,
+ * whose normals would be NaN. Vertices that have texture coordinates are only merged if those match within
+ * tolerance too, so texture seams stay split. Vertices left without faces are dropped; the order of the others
+ * and of the faces is kept.
+ * Nearby vertices are found through a spatial hash grid of tolerance sized cells, so the pass takes expected linear
+ * time. The search runs on threadCount threads (0 for one per core) and its result does not depend on them.
+ * A mesh that changes is reallocated, which releases its attributes.
+ * @param tolerance Merge distance as a fraction of the bounding box diagonal, and in texture coordinate units.
+ */
+WeldStatistics weldMesh(Mesh& mesh, float tolerance = 1e-6f, unsigned int threadCount = 0);
+
+/**
+ * How well a triangle order reuses the post-transform vertex cache, see analyzeVertexCache().
+ */
+struct VertexCacheStatistics
+{
+    double acmr = 0.0; // average cache miss ratio: vertices transformed per triangle, 3 at worst
+    double atvr = 0.0; // average transformed vertex ratio: vertices transformed per vertex, 1 at best
+};
+
+/**
+ * Simulate drawing a mesh indexed through a FIFO post-transform cache of cacheSize vertices.
+ */
+VertexCacheStatistics analyzeVertexCache(const Mesh& mesh, int cacheSize = 16);
+
+/**
+ * Reorder the faces of a mesh for post-transform vertex cache reuse with Tom Forsyth's linear-speed algorithm:
+ * faces are emitted greedily by a score that favours vertices recently used (in a simulated 32 entry LRU cache)
+ * and vertices with few faces left. Each face keeps its corners and winding, so the set of triangles is unchanged.
+ * Face attributes the mesh has are reordered with the faces.
+ */
+void optimizeVertexCache(Mesh& mesh);
+
+/**
+ * Reorder the faces within each range for the vertex cache as optimizeVertexCache(Mesh&) does for a whole mesh.
+ * Faces do not leave their range, so ranges such as meshlets keep the same set of triangles.
+ * @param faceRanges {first face, face count} pairs.
+ */
+void optimizeVertexCache(Mesh& mesh, const std::vector<std::pair<size_t, size_t>>& faceRanges);
+
+/**
+ * Reorder the faces of a mesh and the face attributes it has: face order[i] becomes face i.
+ * @param order A permutation of the faces.
+ */
+void reorderFaces(Mesh& mesh, const std::vector<int>& order);
+
+/**
+ * Renumber the vertices of a mesh in the order the faces first use them, so that drawing reads the vertex streams
+ * nearly sequentially. Vertices no face uses go last; vertices with texture coordinates stay ahead of those
+ * without. Vertex attributes the mesh has are reordered with the vertices.
+ */
+void optimizeVertexFetch(Mesh& mesh);
+
+/**
+ * Copy the geometry of a mesh (its streams, center and diagonal length) into a new arena, e.g. to edit a mesh that is
+ * shared. The attributes are left out, to be computed again when needed.
+ */
+void copyMeshGeometry(const Mesh& mesh, Mesh& copy);
+
+/**
+ * Compute the bounding box of a mesh and move the mesh so that the box is centred at the origin.
+ * Sets center (the box center before centring) and diagonalLength. Uses SSE4.1 or AVX2 when the CPU has them.
+ */
+void ComputeBoundingBox(Mesh& mesh);
+
+/**
+ * Compute the face normal and the area weight of each face, 4 (SSE4.1) or 8 (AVX2) faces at a time when
+ * the CPU has them. The results do not depend on the instruction set. Both attributes are allocated if absent.
+ */
+void ComputeFaceNormals(Mesh& mesh);
+
+/**
+ * Compute the vertex normal of each vertex. Vertex normal is calculated with weighted averaging of
+ * face normals whose face contains that vertex, weighted by face area. The faces of each vertex are
+ * gathered into compressed sparse rows by a counting sort, and the normals are computed on threadCount
+ * threads over vertex ranges. The result does not depend on the thread count.
+ * The face normals and areas must be computed first, see ComputeFaceNormals().
+ * @param threadCount 0 picks one thread per core, at most one per 65536 vertices.
+ */
+void ComputeVertexNormals(Mesh& mesh, unsigned int threadCount = 0);
+
+/**
+ * The face normals of a mesh, computed the first time they are needed and kept until the mesh releases them.
+ */
+const float *requireFaceNormals(Mesh& mesh);
+
+/**
+ * The vertex normals of a mesh, computed the first time they are needed and kept until the mesh releases them.
+ * Face normals and areas that are computed only for them are released again afterwards.
+ */
+const float *requireVertexNormals(Mesh& mesh, unsigned int threadCount = 0);
+
+/**
+ * Edits the positions of a mesh in place, e.g. for a scripted deformation, and keeps what is derived from them up to
+ * date incrementally: the face normals and areas of the faces around the edited vertices, the vertex normals of
+ * those faces' vertices (the one-ring neighbourhood) and the bounding box. An update costs in proportion to the
+ * edited vertices, not to the mesh, and gives the same normals as recomputing them all.
+ * Only the normals the mesh has are updated; while it has any, its face areas are kept too. The mesh is not
+ * re-centred, its center and diagonalLength keep describing it as loaded.
+ * The faces of the mesh must not change while an editor is alive.
+ */
+class MeshEditor
+{
+public:
+    explicit MeshEditor(Mesh& mesh);
+    ~MeshEditor();
+    MeshEditor(const MeshEditor&) = delete;
+    MeshEditor& operator=(const MeshEditor&) = delete;
+
+    /**
+     * @return The positions of vertices first to first + count - 1 for writing, marked as edited.
+     */
+    float *editPositions(size_t first, size_t count);
+
+    /**
+     * Mark vertices whose positions were written directly as edited.
+     */
+    void markEdited(size_t first, size_t count);
+
+    /**
+     * Bring the normals and the bounding box up to date with the edited vertices.
+     */
+    void update();
+
+    /**
+     * The bounding box as of the last update, or the construction.
+     */
+    void bounds(float *minimum, float *maximum) const;
+
+private:
+    Mesh& mesh;
+    std::vector<int> firstFace, vertexFaces; // the faces of each vertex in compressed sparse rows, in face order
+    std::vector<std::pair<size_t, size_t>> editedRanges; // first vertex and count
+    std::vector<unsigned int> faceStamps, vertexStamps, blockStamps; // == stamp when already updated this time
+    unsigned int stamp = 0;
+    std::vector<int> editedFaces;
+    size_t blockCount;
+    std::vector<float> blockBounds; // a segment tree of the bounds of blocks of vertices, 6 floats per node
+    unsigned int addedAttributes = 0; // attributes allocated by the editor, released by it
+
+    void updateBlock(size_t block);
+    void keepFaceAttributes();
+};
+
+#endif
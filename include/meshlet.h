@@ -0,0 +1,75 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <utility>
+#include <vector>
+
+#include "mesh.h"
+
+// Limits of buildMeshlets(), small enough that a cluster's triangles mostly face the same way.
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_FACES 124
+
+/**
+ * A cluster of consecutive faces of a mesh, with the bounds to cull it as a whole.
+ */
+struct Meshlet
+{
+    unsigned int firstFace;
+    unsigned int faceCount;
+    unsigned int vertexCount; // distinct vertices of the faces
+    float center[3]; // bounding sphere
+    float radius;
+    float coneAxis[3]; // unit average of the face normals
+    float coneCutoff; // sine of the largest angle between a face normal and the axis, 1 if the normals spread 90 degrees or more
+};
+
+/**
+ * A camera in a mesh's own coordinates: its position and the planes of its view frustum, normalized so that a
+ * point (x, y, z) is inside where a x + b y + c z + d >= 0 for each plane {a, b, c, d}.
+ * backFacesCulled is set when faces facing away from the camera are not drawn (GL_CULL_FACE); only then may
+ * meshlets be culled by their normal cones. Meshes drawn double-sided are culled against the frustum alone.
+ */
+struct MeshletView
+{
+    float camera[3];
+    float planes[6][4];
+    bool backFacesCulled = false;
+};
+
+/**
+ * Split a mesh into meshlets of up to MESHLET_MAX_VERTICES distinct vertices and MESHLET_MAX_FACES faces, each grown
+ * over neighbouring faces of similar normals, and reorder the faces so that each meshlet is a range of them, in
+ * Forsyth's order within the range.
+ * The face normals are computed for it if the mesh does not have them, and released again.
+ */
+void buildMeshlets(Mesh& mesh, std::vector<Meshlet>& meshlets);
+
+/**
+ * The view of a mesh drawn with the given matrices, in OpenGL's column-major order (as glGetFloatv() returns
+ * GL_MODELVIEW_MATRIX and GL_PROJECTION_MATRIX). Only their product matters, so the camera may be set in either
+ * (the viewer sets it in the projection matrix); the projection must be a perspective one.
+ */
+void meshletViewFromMatrices(const float *modelview, const float *projection, MeshletView& view);
+
+/**
+ * Whether any face of a meshlet may be seen: false if its bounding sphere is outside a frustum plane or, when the
+ * view culls back faces, its normal cone faces away from the camera from every point of the sphere. Conservative,
+ * so a face it rejects is never drawn.
+ */
+bool isMeshletVisible(const Meshlet& meshlet, const MeshletView& view);
+
+/**
+ * Cull meshlets and merge the faces of those that remain into ranges of consecutive faces.
+ * @param ranges Receives {first face, face count} pairs.
+ * @return Number of faces in the ranges.
+ */
+size_t cullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletView& view, std::vector<std::pair<size_t, size_t>>& ranges);
+
+/**
+ * Count the faces of a range that are really seen: not wholly outside a frustum plane, and facing the camera when the
+ * view culls back faces.
+ */
+size_t countVisibleFaces(const Mesh& mesh, size_t firstFace, size_t faceCount, const MeshletView& view);
+
+#endif
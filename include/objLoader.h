@@ -0,0 +1,92 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <string>
+#include <vector>
+
+#include "mappedFile.h"
+#include "mesh.h"
+
+/**
+ * Parse OBJ text held in memory into flat vertex, texture coordinate and triangle arrays.
+ * The text is scanned in place; a first counting pass sizes the output arrays so that the
+ * second pass writes straight into them without reallocation.
+ *
+ * Only "v", "vt" and "f" records are read, everything else (including "#" comments) is skipped.
+ * Faces with more than 3 vertices are fan triangulated about their first vertex, and only the
+ * vertex index of each "v/vt/vn" face entry is kept. Negative indices count back from the latest vertex.
+ * @param begin First character of the OBJ text.
+ * @param end One past the last character of the OBJ text.
+ * @param vertices Receives {x0, y0, z0, x1, y1, z1, ... }.
+ * @param textureCoordinates Receives {u0, v0, u1, v1, ... }.
+ * @param faces Receives {f0v0, f0v1, f0v2, f1v0, ... } with 0-based vertex indices.
+ */
+void parseOBJ(const char *begin, const char *end, std::vector<float>& vertices,
+              std::vector<float>& textureCoordinates, std::vector<int>& faces);
+
+/**
+ * Same as parseOBJ(), but the text is split at line boundaries into one chunk per thread.
+ * Every chunk is counted and parsed on its own thread, and prefix sums of the chunk counts place
+ * each chunk's records into the output arrays. The result is identical to parseOBJ().
+ * @param threadCount Number of chunks and threads, 0 or 1 parses serially.
+ */
+void parseOBJParallel(const char *begin, const char *end, unsigned int threadCount, std::vector<float>& vertices,
+                      std::vector<float>& textureCoordinates, std::vector<int>& faces);
+
+/**
+ * Memory map an OBJ file and parse it with parseOBJParallel().
+ * @param fileName The name of OBJ file to load.
+ * @param threadCount Number of parsing threads, 0 picks one thread per MB of text, at most one per core.
+ * @return false if the file cannot be opened, the output arrays are left empty in that case.
+ */
+bool loadOBJFile(const std::string& fileName, std::vector<float>& vertices,
+                 std::vector<float>& textureCoordinates, std::vector<int>& faces, unsigned int threadCount = 0);
+
+/**
+ * Same as the loadOBJFile() above, but parses straight into the arena of a Mesh: its positions,
+ * texture coordinates and faces are filled, the other streams are allocated but not computed.
+ * @return false if the file cannot be opened, the mesh is left unchanged in that case.
+ */
+bool loadOBJFile(const std::string& fileName, Mesh& mesh, unsigned int threadCount = 0);
+
+/**
+ * A model loaded by streamOBJFile(). Its arrays live in temporary backing files that are memory mapped
+ * read-only once streaming is done, in the same layouts as the loadOBJFile() arrays:
+ * vertices {x0, y0, z0, ... } as float, textureCoordinates {u0, v0, ... } as float, faces {f0v0, f0v1, f0v2, ... }
+ * as int and faceNormals {x0, y0, z0, ... } as float. Vertices are not centred, subtract center to centre them.
+ * The backing files are deleted when the object is destroyed.
+ */
+struct StreamedMesh
+{
+    size_t vertexCount = 0;
+    size_t textureCoordinateCount = 0;
+    size_t triangleCount = 0;
+    float minimum[3] = {0.0f, 0.0f, 0.0f}; // bounding box
+    float maximum[3] = {0.0f, 0.0f, 0.0f};
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float diagonalLength = 0.0f;
+
+    MappedFile vertices, textureCoordinates, faces, faceNormals;
+    std::vector<std::string> backingFileNames;
+
+    StreamedMesh() = default;
+    StreamedMesh(const StreamedMesh&) = delete;
+    StreamedMesh& operator=(const StreamedMesh&) = delete;
+    ~StreamedMesh();
+};
+
+/**
+ * Load an OBJ file of any size with bounded memory use. The file is read in fixed-size windows and the
+ * geometry is appended to temporary backing files instead of growing arrays. The bounding box and the face
+ * normals are computed while streaming, vertex positions needed for the normals are read back through a
+ * fixed-size block cache. Parsing rules are the same as parseOBJ().
+ * @param memoryBudget Bytes of memory the process may use while loading (at least 1 MB is used). About half goes to
+ * the loader's windows, buffers and caches, whatever the file size; the rest is headroom for the parser's state and the
+ * memory the process already uses. The backing files are mapped at the end but only count once their pages are read.
+ * @param temporaryDirectory Where to create the backing files.
+ * @return false if the file cannot be read, a backing file cannot be written, or a line is longer than the read window.
+ */
+bool streamOBJFile(const std::string& fileName, size_t memoryBudget, StreamedMesh& mesh,
+                   const std::string& temporaryDirectory = ".");
+
+#endif
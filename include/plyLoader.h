@@ -0,0 +1,28 @@
+#ifndef PLYLOADER_H
+#define PLYLOADER_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Load a binary little-endian PLY file into the same flat arrays as loadOBJFile().
+ * The "vertex" element must have float x, y and z properties; optional texture coordinate properties
+ * (u/v, s/t or texture_u/texture_v) fill textureCoordinates. The "face" element must have a
+ * vertex_indices (or vertex_index) list, polygons are fan triangulated like OBJ faces.
+ * When the vertex element is exactly float x, y, z (and the face element is exactly a list of 3
+ * 32 bit indices) the blocks are copied straight from the mapped file instead of being read property by property.
+ * @return false if the file cannot be opened, is not a supported PLY file, ends before the counts of its header or
+ *         has a face index outside its vertices; the arrays are left empty then.
+ */
+bool loadPLYFile(const std::string& fileName, std::vector<float>& vertices,
+                 std::vector<float>& textureCoordinates, std::vector<int>& faces);
+
+/**
+ * Write flat mesh arrays as a binary little-endian PLY file: float x, y, z (and float u, v when there
+ * is one texture coordinate per vertex) per vertex, and a uchar count / int index list per face.
+ * @return false if the file cannot be written.
+ */
+bool writePLYFile(const std::string& fileName, const std::vector<float>& vertices,
+                  const std::vector<float>& textureCoordinates, const std::vector<int>& faces);
+
+#endif
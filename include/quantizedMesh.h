@@ -0,0 +1,91 @@
+#ifndef QUANTIZEDMESH_H
+#define QUANTIZEDMESH_H
+
+#include <cmath>
+#include <vector>
+
+#include "mesh.h"
+
+/**
+ * A compact copy of a Mesh for drawing, about a third of its size:
+ *
+ *   positions           {x0, y0, z0, ... }, signed 16 bit, position = positionOffset + positionScale * quantized
+ *   textureCoordinates  {u0, v0, ... }, unsigned 16 bit over the range of each coordinate, see decodeTextureCoordinate()
+ *   faceNormals         {u0, v0, ... }, signed 16 bit octahedral, see decodeOctahedral(), empty if the mesh had none
+ *   vertexNormals       {u0, v0, ... }, the same
+ *   shortFaces / faces  vertex indices, 16 bit if the vertices allow it (then faces is empty), else 32 bit
+ *
+ * The position scale is the same for all axes, so positions can be decoded by the modelview matrix
+ * (glTranslatef(positionOffset), glScalef(positionScale)) with GL_NORMALIZE keeping the normals right.
+ */
+struct QuantizedMesh
+{
+    size_t vertexCount = 0;
+    size_t textureCoordinateCount = 0;
+    size_t faceCount = 0;
+    float positionOffset[3] = {0.0f, 0.0f, 0.0f}; // center of the bounding box
+    float positionScale = 0.0f; // half the longest side of the bounding box / 32767, the size of a quantization step
+    float textureCoordinateOffset[2] = {0.0f, 0.0f};
+    float textureCoordinateScale[2] = {0.0f, 0.0f};
+
+    std::vector<short> positions;
+    std::vector<unsigned short> textureCoordinates;
+    std::vector<short> faceNormals;
+    std::vector<short> vertexNormals;
+    std::vector<unsigned short> shortFaces;
+    std::vector<unsigned int> faces;
+
+    /**
+     * @return The vertex of a corner, faces being {f0v0, f0v1, f0v2, f1v0, ... }.
+     */
+    unsigned int vertex(size_t corner) const { return shortFaces.empty() ? faces[corner] : shortFaces[corner]; }
+
+    void decodePosition(size_t vertex, float *position) const
+    {
+        for (int axis = 0; axis < 3; axis++)
+            position[axis] = positionOffset[axis] + positionScale * positions[vertex * 3 + axis];
+    }
+
+    void decodeTextureCoordinate(size_t vertex, float *textureCoordinate) const
+    {
+        for (int axis = 0; axis < 2; axis++)
+            textureCoordinate[axis] = textureCoordinateOffset[axis] + textureCoordinateScale[axis] * textureCoordinates[vertex * 2 + axis];
+    }
+
+    /**
+     * Bytes of the arrays.
+     */
+    size_t bytes() const;
+};
+
+/**
+ * Decode an octahedral normal. The result is not normalized (its length is between 1/sqrt(3) and 1),
+ * which GL_NORMALIZE takes care of; normalize it for anything else.
+ */
+inline void decodeOctahedral(const short *encoded, float *normal)
+{
+    float x = encoded[0] * (1.0f / 32767.0f), y = encoded[1] * (1.0f / 32767.0f), z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+    }
+    normal[0] = x;
+    normal[1] = y;
+    normal[2] = z;
+}
+
+/**
+ * Encode a unit normal octahedrally into two signed 16 bit values, choosing of the four nearest codes the one that
+ * decodes closest to it. A zero normal encodes as (0, 0, 1).
+ */
+void encodeOctahedral(const float *normal, short *encoded);
+
+/**
+ * Quantize a mesh's geometry and the normals it has (face areas are left out). Positions are quantized relative to
+ * their bounding box and texture coordinates relative to their range, each to the code nearest once decoded: within
+ * half a step, plus the rounding of the float decoding.
+ */
+void quantizeMesh(const Mesh& mesh, QuantizedMesh& quantized);
+
+#endif
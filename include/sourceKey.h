@@ -0,0 +1,30 @@
+#ifndef SOURCEKEY_H
+#define SOURCEKEY_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Identifies the content of a source asset file, stored in the header of every cache or baked file
+ * made from it so that outdated files can be detected.
+ */
+struct SourceKey
+{
+    uint64_t size;
+    int64_t modificationTime;
+    uint64_t hash; // 64 bit FNV-1a of the file content
+};
+
+/**
+ * Compute the key of a source file, including its content hash.
+ * @return false if the file cannot be read.
+ */
+bool makeSourceKey(const std::string& fileName, SourceKey& key);
+
+/**
+ * Check whether a source file still has the recorded key. The content is hashed only when the size
+ * matches but the modification time does not (e.g. after a fresh checkout).
+ */
+bool sourceKeyMatches(const SourceKey& key, const std::string& fileName);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <vector>
+
+#include "textureProcessing.h"
+
+/**
+ * Where a texture was placed in an atlas, in level 0 texels. The rectangle is surrounded by a gutter of
+ * its own edge texels, so filtering near the edge never reads a neighbour.
+ */
+struct AtlasEntry
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+/**
+ * Several textures packed into one, so everything drawn with them needs a single bind.
+ */
+struct TextureAtlas
+{
+    ProcessedTexture texture;
+    std::vector<AtlasEntry> entries; // in the order of the packed textures
+};
+
+/**
+ * Pack processed textures of the same format into a padded atlas, level by level, without decoding or
+ * re-encoding their pixels (only the BC1 gutter blocks are encoded). The atlas keeps levelCount levels; the
+ * gutter is wide enough that no level mixes neighbouring textures, which needs every texture's size to be a
+ * multiple of textureAtlasAlignment() and to have at least levelCount levels.
+ * @return false if a texture does not qualify.
+ */
+bool buildTextureAtlas(const std::vector<const ProcessedTexture *>& textures, int levelCount, TextureAtlas& atlas);
+
+/**
+ * Texel alignment (and gutter width) of atlas entries for a format and level count.
+ */
+int textureAtlasAlignment(TextureFormat format, int levelCount);
+
+/**
+ * Map a texture coordinate of a packed texture into the atlas.
+ */
+void atlasTextureCoordinate(const TextureAtlas& atlas, int entry, float u, float v, float& atlasU, float& atlasV);
+
+/**
+ * Rewrite a mesh's {u0, v0, u1, v1, ...} texture coordinates into the atlas. Coordinates that repeat the
+ * texture are shifted by whole tiles first, which works when they all fall into one tile.
+ * @param count Number of {u, v} pairs.
+ * @return false, leaving the coordinates unchanged, if they span more than one tile.
+ */
+bool remapTextureCoordinates(const TextureAtlas& atlas, int entry, float *textureCoordinates, size_t count);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+
+#include "textureProcessing.h"
+
+/**
+ * Baked texture files: a processed texture with its mip chain, RGBA8 or BC1, ready for glTexImage2D or
+ * glCompressedTexImage2D and keyed by the source image like the mesh cache (see sourceKey.h).
+ * Written by the bakeAssets tool and by the viewer, read by the viewer in place of getBMP().
+ *
+ * Layout (native byte order): a header, a table of levels (width, height, offset and size of each),
+ * then the pixels of all levels, level 0 first and bottom row first, at a 16 byte aligned offset.
+ */
+#define TEXTURE_CACHE_VERSION 2
+
+/**
+ * Baked file name for an image, e.g. "../textures/grass.bmp" is baked as "grass.bmp.texcache".
+ */
+std::string textureCacheFileName(const std::string& sourceFileName);
+
+/**
+ * Check whether a baked texture exists in the given format and is up to date with its source image,
+ * without reading the pixels.
+ */
+bool isTextureCacheCurrent(const std::string& cacheFileName, const std::string& sourceFileName, TextureFormat format);
+
+/**
+ * Read a baked texture if it is up to date with its source image.
+ * @return false on a cache miss.
+ */
+bool readTextureCache(const std::string& cacheFileName, const std::string& sourceFileName, ProcessedTexture& texture);
+
+/**
+ * Write a processed texture as a baked texture of its source image.
+ * @return false if the source or baked file cannot be accessed.
+ */
+bool writeTextureCache(const std::string& cacheFileName, const std::string& sourceFileName, const ProcessedTexture& texture);
+
+#endif
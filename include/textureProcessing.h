@@ -0,0 +1,64 @@
+#ifndef TEXTUREPROCESSING_H
+#define TEXTUREPROCESSING_H
+
+#include <cstddef>
+#include <vector>
+
+#include "getBMP.h"
+
+/**
+ * Pixel formats of a processed texture. BC1 (DXT1) stores each 4x4 block in 8 bytes: two RGB565
+ * end points and 2 bit indices into the 4 colours between them, 1/8 of the RGBA size.
+ */
+enum TextureFormat { TEXTURE_RGBA8 = 0, TEXTURE_BC1 = 1 };
+
+/**
+ * One mip level, its pixels at data.data() + offset.
+ */
+struct TextureLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * A texture with its full mip chain, level 0 first, all levels in one buffer.
+ */
+struct ProcessedTexture
+{
+    TextureFormat format = TEXTURE_RGBA8;
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+/**
+ * Bytes used by a level of the given size and format.
+ */
+size_t textureLevelSize(TextureFormat format, int width, int height);
+
+/**
+ * Build the full mip chain of an RGBA image down to 1x1 with a 2x2 box filter. A level is half the size
+ * of the one before, rounded down, and odd sized levels drop their last row or column.
+ * @param texture Receives RGBA8 levels, level 0 a copy of the image.
+ */
+void buildMipChain(const imageFile *image, ProcessedTexture& texture);
+
+/**
+ * Encode RGBA pixels to BC1, ignoring alpha. Blocks on the right and bottom edge repeat their last pixel.
+ * @param out Receives textureLevelSize(TEXTURE_BC1, width, height) bytes.
+ */
+void encodeBC1(const unsigned char *rgba, int width, int height, unsigned char *out);
+
+/**
+ * Decode BC1 blocks to RGBA pixels, for drivers without S3TC and for measuring the encoder error.
+ */
+void decodeBC1(const unsigned char *blocks, int width, int height, unsigned char *rgba);
+
+/**
+ * Convert every level of a texture to the given format, in place: RGBA8 is encoded to BC1, BC1 decoded to RGBA8.
+ */
+void convertTexture(ProcessedTexture& texture, TextureFormat format);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef TEXTUREUPLOADQUEUE_H
+#define TEXTUREUPLOADQUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * One level (or cube map face level) of a texture to upload.
+ */
+struct TextureUpload
+{
+    GLenum target; // GL_TEXTURE_2D or a GL_TEXTURE_CUBE_MAP_POSITIVE_X + face
+    GLint level;
+    GLsizei width;
+    GLsizei height;
+    GLenum internalFormat; // e.g. GL_RGBA or GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    GLenum format; // e.g. GL_RGBA or GL_BGR, 0 for compressed pixels
+    const unsigned char *pixels; // rows 4 byte aligned
+    size_t size;
+};
+
+/**
+ * Counters of a TextureUploadQueue.
+ */
+struct TextureUploadStats
+{
+    size_t texturesQueued = 0;
+    size_t texturesReady = 0;
+    size_t texturesDropped = 0; // their owner was gone before all their levels were issued
+    size_t bytesStaged = 0; // copied through the ring
+    size_t bytesDirect = 0; // uploaded from client memory, too large for the ring or without ARB_buffer_storage
+    size_t framesRingFull = 0; // updates that stopped early to wait for a fence
+};
+
+/**
+ * Streams texture uploads through a ring of persistently mapped pixel buffer memory, so the GL thread
+ * only copies pixels into the ring and never waits for a transfer. update() runs once per frame: it recycles
+ * ring space whose fence has signalled, then stages queued levels up to a byte budget, issues their
+ * glTexImage2D or glCompressedTexImage2D from the buffer, and fences them. A texture is ready, and its
+ * callback runs, once the fence after its last level signals.
+ *
+ * Without ARB_buffer_storage and ARB_sync, levels are uploaded synchronously from client memory inside
+ * update() (still under the byte budget). All calls must be made on the GL thread, and destroy() must be
+ * called while the context exists. update() leaves GL_PIXEL_UNPACK_BUFFER unbound but changes the texture bindings.
+ */
+class TextureUploadQueue
+{
+public:
+    TextureUploadQueue() = default;
+    TextureUploadQueue(const TextureUploadQueue&) = delete;
+    TextureUploadQueue& operator=(const TextureUploadQueue&) = delete;
+
+    /**
+     * Create the ring buffer. Needs a current GL context.
+     * @return false if the context cannot map buffers persistently and uploads will be synchronous.
+     */
+    bool create(size_t ringBytes);
+
+    /**
+     * Wait for all fences and delete the ring buffer. Queued uploads are dropped.
+     */
+    void destroy();
+
+    /**
+     * Queue the levels of a texture.
+     * @param texture The texture object.
+     * @param owner What deletes the texture object when it is destroyed. Once it is gone, the levels not issued yet
+     *        are dropped and onReady is not called, so a deleted texture name is never bound.
+     * @param bindTarget GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP, what the texture is bound to.
+     * @param pixels Kept until every level is staged; owns the memory the uploads point at.
+     * @param onReady Called from update() once the texture can be sampled.
+     */
+    void enqueue(GLuint texture, std::weak_ptr<const void> owner, GLenum bindTarget, std::vector<TextureUpload> uploads,
+                 std::shared_ptr<const void> pixels, std::function<void()> onReady);
+
+    /**
+     * Recycle finished ring space, run ready callbacks, then stage and issue queued levels until
+     * byteBudget bytes have been issued this call (at least one level is issued if it fits the ring).
+     */
+    void update(size_t byteBudget);
+
+    /**
+     * Whether nothing is queued or waiting for a fence.
+     */
+    bool idle() const { return pending.empty() && inFlight.empty(); }
+
+    TextureUploadStats stats() const { return counters; }
+
+private:
+    struct Job
+    {
+        GLuint texture;
+        std::weak_ptr<const void> owner;
+        GLenum bindTarget;
+        std::vector<TextureUpload> uploads;
+        size_t next = 0; // first level not issued yet
+        std::shared_ptr<const void> pixels;
+        std::function<void()> onReady;
+    };
+
+    struct Batch
+    {
+        GLsync fence = nullptr;
+        size_t bytes = 0; // ring bytes to release when the fence signals, including any skipped ring end
+        std::vector<std::function<void()>> ready;
+    };
+
+    // Reserve size bytes of the ring, or return false if they are still in flight.
+    bool allocate(size_t size, size_t& offset, Batch& batch);
+    void retire(bool wait);
+    void issue(const Job& job, const TextureUpload& upload, const void *source);
+
+    GLuint buffer = 0;
+    unsigned char *mapped = nullptr;
+    size_t ringSize = 0, head = 0, used = 0;
+    std::deque<Job> pending;
+    std::deque<Batch> inFlight;
+    TextureUploadStats counters;
+};
+
+#endif
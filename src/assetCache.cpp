@@ -0,0 +1,108 @@
+// Reference counted asset cache with LRU eviction, see assetCache.h.
+
+#include <vector>
+
+#include "../include/assetCache.h"
+
+bool AssetCache::lookup(const Key& key, std::promise<std::shared_ptr<void>>& promise,
+                        std::shared_future<std::shared_ptr<void>>& asset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(key);
+    if (found != entries.end()) {
+        hits++;
+        recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->second.recent);
+        asset = found->second.asset;
+        return false;
+    }
+    misses++;
+    Entry& entry = entries[key];
+    entry.asset = promise.get_future().share();
+    recentlyUsed.push_front(key);
+    entry.recent = recentlyUsed.begin();
+    asset = entry.asset;
+    return true;
+}
+
+void AssetCache::finish(const Key& key, bool loaded, size_t cpuBytes, size_t gpuBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(key);
+    Entry& entry = found->second;
+    if (!loaded) {
+        recentlyUsed.erase(entry.recent);
+        entries.erase(found);
+        return;
+    }
+    entry.loaded = true;
+    entry.cpuBytes = cpuBytes;
+    entry.gpuBytes = gpuBytes;
+    this->cpuBytes += cpuBytes;
+    this->gpuBytes += gpuBytes;
+}
+
+void AssetCache::resize(const Key& key, size_t cpuBytes, size_t gpuBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(key);
+    if (found == entries.end() || !found->second.loaded) return;
+    Entry& entry = found->second;
+    this->cpuBytes = this->cpuBytes - entry.cpuBytes + cpuBytes;
+    this->gpuBytes = this->gpuBytes - entry.gpuBytes + gpuBytes;
+    entry.cpuBytes = cpuBytes;
+    entry.gpuBytes = gpuBytes;
+}
+
+size_t AssetCache::evict(bool all)
+{
+    std::vector<std::shared_future<std::shared_ptr<void>>> evicted; // destroyed after unlocking
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto key = recentlyUsed.end(); key != recentlyUsed.begin() && (all || cpuBytes > cpuBudget || gpuBytes > gpuBudget);) {
+            --key;
+            auto found = entries.find(*key);
+            Entry& entry = found->second;
+            // the entry holds one reference, any more are handles in use
+            if (!entry.loaded || entry.asset.get().use_count() > 1) continue;
+            cpuBytes -= entry.cpuBytes;
+            gpuBytes -= entry.gpuBytes;
+            evicted.push_back(entry.asset);
+            entries.erase(found);
+            key = recentlyUsed.erase(key);
+            evictions++;
+        }
+    }
+    return evicted.size();
+}
+
+size_t AssetCache::trim()
+{
+    return evict(false);
+}
+
+void AssetCache::clear()
+{
+    evict(true);
+}
+
+void AssetCache::setBudget(size_t cpuBytes, size_t gpuBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cpuBudget = cpuBytes;
+    gpuBudget = gpuBytes;
+}
+
+AssetCacheStats AssetCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    AssetCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.assets = entries.size();
+    stats.cpuBytes = cpuBytes;
+    stats.gpuBytes = gpuBytes;
+    stats.cpuBudget = cpuBudget;
+    stats.gpuBudget = gpuBudget;
+    return stats;
+}
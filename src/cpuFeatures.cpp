@@ -0,0 +1,96 @@
+// CPUID based detection of the SIMD instruction sets used by the kernels.
+
+#include <atomic>
+
+#include "../include/cpuFeatures.h"
+
+#ifdef CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+std::atomic<int> simdLevelLimit(SIMD_AVX2);
+
+#ifdef CPU_X86
+void cpuid(int leaf, int subleaf, unsigned int *registers)
+{
+#ifdef _MSC_VER
+    __cpuidex((int *)registers, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Extended control register 0, tells whether the OS saves the AVX registers.
+unsigned long long xgetbv0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((unsigned long long)high << 32) | low;
+#endif
+}
+#endif
+
+SIMDLevel detectSIMDLevel()
+{
+#ifdef CPU_X86
+    unsigned int registers[4];
+    cpuid(0, 0, registers);
+    unsigned int maximumLeaf = registers[0];
+
+    cpuid(1, 0, registers);
+    bool ssse3 = (registers[2] >> 9) & 1;
+    bool sse41 = (registers[2] >> 19) & 1;
+    bool osxsave = (registers[2] >> 27) & 1;
+    bool avx = (registers[2] >> 28) & 1;
+    bool fma = (registers[2] >> 12) & 1;
+    bool avx2 = false;
+    if (maximumLeaf >= 7) {
+        cpuid(7, 0, registers);
+        avx2 = (registers[1] >> 5) & 1;
+    }
+    bool osSavesAVX = osxsave && (xgetbv0() & 6) == 6;
+
+    if (avx && avx2 && fma && osSavesAVX && sse41 && ssse3) return SIMD_AVX2;
+    if (sse41 && ssse3) return SIMD_SSE41;
+    if (ssse3) return SIMD_SSSE3;
+#endif
+    return SIMD_SCALAR;
+}
+
+} // namespace
+
+SIMDLevel cpuSIMDLevel()
+{
+    static const SIMDLevel level = detectSIMDLevel();
+    return level;
+}
+
+SIMDLevel activeSIMDLevel()
+{
+    int limit = simdLevelLimit;
+    return cpuSIMDLevel() < limit ? cpuSIMDLevel() : (SIMDLevel)limit;
+}
+
+void setSIMDLevelLimit(SIMDLevel limit)
+{
+    simdLevelLimit = limit;
+}
+
+const char *simdLevelName(SIMDLevel level)
+{
+    switch (level) {
+        case SIMD_SSSE3: return "SSSE3";
+        case SIMD_SSE41: return "SSE4.1";
+        case SIMD_AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
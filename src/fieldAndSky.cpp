@@ -1,15 +1,33 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <deque>
+#include <future>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <map>
-#include <sstream>
 
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 
+#include "../include/assetCache.h"
 #include "../include/getBMP.h"
+#include "../include/objLoader.h"
+#include "../include/mesh.h"
+#include "../include/meshProcessing.h"
+#include "../include/meshCache.h"
+#include "../include/meshBuffers.h"
+#include "../include/meshEmission.h"
+#include "../include/meshInstances.h"
+#include "../include/meshLod.h"
+#include "../include/meshlet.h"
+#include "../include/quantizedMesh.h"
+#include "../include/textureAtlas.h"
+#include "../include/textureCache.h"
+#include "../include/textureProcessing.h"
+#include "../include/textureUploadQueue.h"
 
 #define ID_LIGHT_OFF 0
 #define ID_LIGHT_ON 1
@@ -20,14 +38,22 @@
 #define ID_LIGHT_TURN_DIM 6
 #define ID_QUIT 7
 
-#define MODEL_NUMBERS 5
-
 #define OBJ_BUNNY 0
 #define OBJ_CAT 1
 #define OBJ_DOG 2
 #define OBJ_DUCK 3
 #define OBJ_TIGER 4
 
+#define IMAGE_NUMBERS 8
+
+#define IMAGE_TIGER 0
+#define IMAGE_GRASS 1
+#define IMAGE_CUBE 2 // six faces, IMAGE_CUBE to IMAGE_CUBE + 5
+
+#define ATLAS_TIGER 0 // atlas entries, in the order loadTextureAtlas() packs them
+#define ATLAS_GRASS 1
+#define ATLAS_LEVELS 4 // mip levels kept in the atlas, the gutter doubles with each
+
 using namespace std;
 
 // Function declaration.
@@ -41,9 +67,35 @@ map<unsigned char, bool> keyState;
 // Globals.
 static float PI = 3.1415926;
 static int windowWidth = 800, windowHeight = 800;
-static unsigned int texture[1]; // Array of texture indices.
-static unsigned int textureCube; // Skybox.
-static unsigned int textureTiger; // texture for tiger.
+
+/**
+ * A GL texture object, deleted with its last handle.
+ */
+struct textureObject
+{
+    GLuint id = 0;
+    bool ready = false; // all levels uploaded, set by the upload queue
+    ~textureObject() { glDeleteTextures(1, &id); }
+};
+
+// Texture uploads are streamed through a pixel buffer ring, at most uploadBudget bytes per frame,
+// unless "--sync-upload" uploads them synchronously in setup().
+static TextureUploadQueue uploadQueue;
+static bool streamTextures = true;
+static size_t uploadRingSize = 16u << 20, uploadBudget = 4u << 20;
+
+// Textures and other assets, shared by path. "--cpu-budget MB" and "--gpu-budget MB" set how much
+// unreferenced assets may keep before the least recently used are evicted.
+static AssetCache assetCache(256u << 20, 512u << 20);
+static AssetHandle<textureObject> textureGrass; // grass field.
+static AssetHandle<textureObject> textureCube; // Skybox.
+static AssetHandle<textureObject> textureTiger; // texture for tiger.
+
+// The 2D textures packed into one atlas, so the textured meshes and the ground are drawn with a single bind.
+// "--no-atlas" binds each texture of its own instead.
+static bool useTextureAtlas = true;
+static AssetHandle<textureObject> textureAtlas;
+static TextureAtlas atlasLayout; // entries and level sizes, the pixels are uploaded and dropped
 static float cameraX = 0.0f, cameraY = 10.0f, cameraZ = 15.0f; // Camera position.
 static float lookatX = 0.0f, lookatY = 10.0f, lookatZ = 0.0f; // Camera look at position.
 static float upX = 0.0f, upY = 1.0f, upZ = 0.0f; // Camera upward vector.
@@ -54,6 +106,11 @@ static bool enableLight = true;
 static float moveSpeed = 0.1f;
 static float fov = 70.0f;
 static int controlModel = 0; // showing which model is in control
+static bool serialAssetLoading = false; // "--serial-load" loads assets one after another, for timing comparison
+static bool useMeshCache = true; // "--no-mesh-cache" always parses and processes the OBJ files
+static size_t streamBudget = 0; // "--stream-budget MB" parses larger OBJ files with streamOBJFile() within it
+static bool processTextures = true; // "--raw-textures" uploads level 0 of the BMP files only, without mipmaps
+static bool compressTextures = true; // "--no-texture-compression" keeps mipmapped textures in RGBA8 instead of BC1
 
 // global lighting
 static float lightAmb[] = { 0.0, 0.0, 0.0, 1.0 };
@@ -74,486 +131,534 @@ static float rDog[] = {0.0, 0.0, 0.0};
 static float rDuck[] = {0.0, 0.0, 0.0};
 static float rTiger[] = {0.0, 0.0, 0.0};
 
-// Vectors used in model processing.
 /**
- * Vectors of vertices of different objects, in this structure:
- * {x0, y0, z0, x1, y1, z1, ... , xN, yN, zN, ... }, { ... }, {...}
- * ^object1                                          ^object2 ^object3 and so on
- *
- * e.g. {x2,y2,z2} is the coordinate of point 2 (the third point), written in code like this:
- *      verticesOf[thisObj][2*3], verticesOf[thisObj][2*3 + 1], verticesOf[thisObj][2*3 + 2]
- *                          ^                         ^                             ^
- *                               these are treated as the index of certain point
+ * Model files, added to the scene in this order so that their indices are OBJ_BUNNY to OBJ_TIGER.
  */
-static vector<vector<float>> verticesOf;
+static const char *modelFileNames[] = {
+    "../models/Bunny.obj", "../models/Cat.obj", "../models/Dog.obj", "../models/Duck.obj", "../models/Tiger.obj"
+};
 
 /**
- * The texture coordinate of different objects.
- * {x0, y0, x1, y1, ... }, { ... }, { ... }
- *
- * e.g. {x1, y1} is the texture coordinate of vertex 1
- *      textureCoordinateOf[thisObj][1*2], textureCoordinateOf[thisObj][1*2 + 1]
+ * A model of the scene, shared through the asset cache by file name: its mesh and the levels of detail of the mesh
+ * (see meshLod.h), built at load time. Each mesh keeps its vertices, texture coordinates and faces in one arena, and
+ * the normals its draw path needs in attribute blocks, see mesh.h. e.g. {x2,y2,z2}, the coordinate of point 2 (the
+ * third point), is
+ *      mesh.positions[2*3], mesh.positions[2*3 + 1], mesh.positions[2*3 + 2] of models[thisObj].asset->mesh
  */
-static vector<vector<float>> textureCoordinateOf;
+struct sceneModel
+{
+    Mesh mesh;
+    vector<MeshLod> lods;
+    bool fromMeshCache = false;
+};
 
 /**
- * Vectors of triangle-only faces of different objects, in this structure:
- * {f0v0, f0v1, f0v2, f1v0, f1v1, f1v2, ... }, { ... }, ...
- * ^object1                                    ^object2 and so on
- *
- * f for face, v for vertex, each face has and only has 3 vertices
- * e.g. f1v1 is the second point of the second face. In code:
- *       int vertexIndex = facesOf[thisObj][1*3 + 1];
- *                                          ^     ^
- *                                          face  vertex
+ * A model of the scene as the viewer draws it: the handle to its cached model, and what is made from it on the
+ * draws, per level of detail (0 for the full mesh, then the levels of sceneModel::lods). What is made is counted
+ * with the cached model, see updateModelBytes().
  */
-static vector<vector<int>> facesOf;
+struct sceneEntry
+{
+    string fileName;
+    string assetName; // asset is cached under: the file name, or the name of its copy in atlas space
+    AssetHandle<sceneModel> asset;
+    int lodLevel = 0; // drawn last frame
+    QuantizedMesh quantized[MESH_MAX_LODS]; // "--quantize-meshes"
+    vector<Meshlet> meshlets[MESH_MAX_LODS];
+    MeshBuffers buffers[MESH_MAX_LODS];
+    MeshBuffers instanceBuffers[MESH_MAX_LODS]; // of the scattered copies, always smooth shaded
+    size_t cpuBytes = 0, gpuBytes = 0; // last reported to the asset cache
+};
 
 /**
- * Stores the normal coordinate for each face (face normals) of different objects.
- * Used in flat shading.
- * {x0, y0, z0, x1, y1, z1, ... , xN, yN, zN, ... }, { ... }, ...
- * e.g. {x0,y0,z0} is the normal vector coordinate of face 0.
+ * The models of the scene, looked up by index. addModel() appends them, and they never move, so an index or a
+ * reference to an entry stays valid as models are added.
  */
-static vector<vector<float>> faceNormalsOf;
+static deque<sceneEntry> models;
+
+// drawMesh() draws the coarsest level of detail whose error covers at most lodThreshold pixels. "--no-lod" always
+// draws the full meshes, "--lod-pixels N" sets the threshold.
+static bool useLods = true;
+static float lodThreshold = 1.0f;
+
+// "--quantize-meshes" draws compact copies of the meshes instead (see quantizedMesh.h), made on their first draw.
+static bool quantizeMeshes = false;
+
+// Meshlets of the meshes, built on their first draw; drawMesh() submits only those the camera may see: those in the
+// view frustum, whichever way they face while GL_CULL_FACE is off and faces are drawn double-sided.
+// "--no-meshlet-culling" submits every face, "--cull-stats" prints the triangles submitted and seen each frame.
+static bool useMeshletCulling = true;
+static bool printCullStatistics = false;
+static vector<pair<size_t, size_t>> faceRanges; // {first face, face count} of the mesh being drawn
+static size_t facesTotal = 0, facesSubmitted = 0, facesSeen = 0; // this frame
+
+// Vertex and index buffers of the meshes (see meshBuffers.h), uploaded on their first draw; "--immediate-mode" draws
+// with glBegin()/glEnd() instead, as does a context without vertex array objects. Quantized meshes are always drawn
+// in immediate mode.
+static bool useMeshBuffers = true;
+
+// "--instances N" scatters N more copies of the models over the field (see meshInstances.h), drawn with one
+// glDrawElementsInstanced() per model and level of detail, or in batches transformed on the CPU with
+// "--no-instancing" or a context that cannot instance. They are drawn from the float meshes with "--quantize-meshes".
+static size_t instanceCount = 0;
+static bool useInstancing = true;
+static vector<vector<MeshInstance>> instancesOf, instanceLevels;
+static InstancedMeshRenderer instancedRenderer;
+static InstanceBatcher instanceBatcher;
+static size_t instancesDrawn = 0; // this frame
 
+// Implementation
 /**
- * Stores the normal coordinate for each vertex (vertex normals) of different objects.
- * Used in smooth shading.
- * {x0, y0, z0, x1, y1, z1, ... , xN, yN, zN, ... }, { ... }, ...
- * e.g. {x0,y0,z0} is the normal vector coordinate of vertex 0.
+ * Load a model file (OBJ or PLY), weld its duplicate vertices and centre it. Normals are computed by drawMesh() when
+ * it first needs them.
+ * The processed model is kept in a mesh cache file, and read back from it while the OBJ file is unchanged.
+ * @param fileName The name of model file to load.
+ * @param mesh Receives the model, left empty if it cannot be loaded.
+ * @return true if the model was read from its mesh cache.
  */
-static vector<vector<float>> vertexNormalsOf;
+bool loadOBJAndProcess(const std::string& fileName, Mesh& mesh)
+{
+    string cacheFileName = meshCacheFileName(fileName);
+    if (useMeshCache && readMeshCache(cacheFileName, fileName, mesh)) return true;
+
+    if (!loadMesh(fileName, mesh, 0, streamBudget)) {
+        cout << "Cannot load " << fileName << endl;
+        return false;
+    }
+    WeldStatistics welded = weldMesh(mesh);
+    if (welded.removedVertices || welded.removedFaces)
+        cout << fileName << ": welded away " << welded.removedVertices << " vertices and " << welded.removedFaces
+             << " degenerate faces" << endl;
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    ComputeBoundingBox(mesh);
+
+    if (useMeshCache && !writeMeshCache(cacheFileName, fileName, mesh))
+        cout << "Cannot write mesh cache " << cacheFileName << endl;
+    return false;
+}
 
 /**
- * Stores the volume of each face, for different objects.
- * Used for calculating vertex normals.
- * {volume0, volume1, volume2, ... }, { ... }, ...
- * e.g. volume0 is the volume of face 0. In code:
- *      float volume = faceVolumesOf[thisObj][0];
+ * Memory of a model's meshes: the arenas and normals of the mesh and its levels of detail.
  */
-static vector<vector<float>> faceVolumesOf;
+size_t modelBytes(const sceneModel& model)
+{
+    size_t bytes = model.mesh.arenaBytes() + model.mesh.attributeBytes();
+    for (const MeshLod& lod : model.lods) bytes += lod.mesh.arenaBytes() + lod.mesh.attributeBytes();
+    return bytes;
+}
 
 /**
- * Bounding box center coordinates for each objects.
- * {x0, y0, z0, x1, y1, z1, ... }
- * e.g. {x0,y0,z0} is the center coordinate for object 0. In code:
- *      centerOf[0*3], centerOf[0*3 + 1], centerOf[0*3 + 2]
+ * Load a model and build its levels of detail, for the asset cache. A model that cannot be loaded has an empty mesh.
+ * @param fileName The name of model file to load.
+ * @param cpuBytes Receives the memory of the mesh and its levels of detail as loaded; updateModelBytes() follows
+ *        what is computed, made and released as the model is drawn.
  */
-static vector<float> centerOf;
+shared_ptr<sceneModel> loadModel(const std::string& fileName, size_t& cpuBytes)
+{
+    auto model = make_shared<sceneModel>();
+    model->fromMeshCache = loadOBJAndProcess(fileName, model->mesh);
+    if (useLods) buildMeshLods(model->mesh, model->lods);
+    cpuBytes = modelBytes(*model);
+    return model;
+}
 
 /**
- * Diagonal length of bounding box of each objects.
- * {length0, length1, length2, ... }
+ * Report a model's memory to the asset cache after its draws: its meshes with the normals they hold now, and the
+ * quantized copies, meshlets and buffers made from them. Only a change is reported.
  */
-static vector<float> diagonalLengthOf;
-// Vector section end
+void updateModelBytes(sceneEntry& model)
+{
+    size_t cpuBytes = modelBytes(*model.asset), gpuBytes = 0;
+    for (int level = 0; level < MESH_MAX_LODS; level++) {
+        cpuBytes += model.quantized[level].bytes() + model.meshlets[level].capacity() * sizeof(Meshlet);
+        gpuBytes += model.buffers[level].bytes() + model.instanceBuffers[level].bytes();
+    }
+    if (cpuBytes == model.cpuBytes && gpuBytes == model.gpuBytes) return;
+    assetCache.resize<sceneModel>(model.assetName, cpuBytes, gpuBytes);
+    model.cpuBytes = cpuBytes;
+    model.gpuBytes = gpuBytes;
+}
 
-// Implementation
 /**
- * Compute the bounding box for a specified object.
- * @param thisObj Indicating which object is being processed.
+ * Add a model file to the scene, or find the index it already has. Its model is loaded by setup().
+ * @return The index of the model.
  */
-void ComputeBoundingBox(int thisObj)
+int addModel(const std::string& fileName)
 {
-    float minX,maxX, minY,maxY, minZ,maxZ;
-    // read value from vertices vector
-    for (int i = 0; i < verticesOf[thisObj].size(); i += 3) // massive bug fix in this "for"!
-    {
-        if (i == 0) {
-            minX = maxX = verticesOf[thisObj][i];
-            minY = maxY = verticesOf[thisObj][i + 1];
-            minZ = maxZ = verticesOf[thisObj][i + 2];
-        }
-        else {
-            if (verticesOf[thisObj][i] > maxX) maxX = verticesOf[thisObj][i];
-            if (verticesOf[thisObj][i] < minX) minX = verticesOf[thisObj][i];
-            if (verticesOf[thisObj][i + 1] > maxY) maxY = verticesOf[thisObj][i + 1];
-            if (verticesOf[thisObj][i + 1] < minY) minY = verticesOf[thisObj][i + 1];
-            if (verticesOf[thisObj][i + 2] > maxZ) maxZ = verticesOf[thisObj][i + 2];
-            if (verticesOf[thisObj][i + 2] < minZ) minZ = verticesOf[thisObj][i + 2];
+    for (size_t i = 0; i < models.size(); i++)
+        if (models[i].fileName == fileName) return (int)i;
+    models.emplace_back();
+    models.back().fileName = fileName;
+    models.back().assetName = fileName;
+    return (int)models.size() - 1;
+}
+
+/**
+ * Image files used as textures, opened by loadImage() on the loader threads and uploaded by loadTextures().
+ * The six cube map faces are in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order.
+ */
+static const char *imageFileNames[IMAGE_NUMBERS] = {
+    "../models/TigerTexture.bmp",
+    "../textures/grass.bmp",
+    "../textures/IceRiver/posx.bmp",
+    "../textures/IceRiver/negx.bmp",
+    "../textures/IceRiver/posy.bmp",
+    "../textures/IceRiver/negy.bmp",
+    "../textures/IceRiver/posz.bmp",
+    "../textures/IceRiver/negz.bmp",
+};
+
+/**
+ * An image ready for upload: a processed texture with mipmaps, or BGR pixels mapped straight from the BMP file.
+ */
+struct textureImage
+{
+    ProcessedTexture texture;
+    bmpView bgr;
+};
+
+/**
+ * Read an image's processed texture from the texture cache (made by the viewer or the bakeAssets tool) if it is
+ * up to date, otherwise decode the BMP file, build the mip chain, encode it to BC1 and write the texture cache.
+ * With "--raw-textures" the BMP file is only mapped.
+ * @param fileName The name of BMP file to load.
+ * @param cpuBytes Receives the memory the image uses.
+ * @return The image, or nullptr if it cannot be loaded.
+ */
+shared_ptr<textureImage> loadImage(const std::string& fileName, size_t& cpuBytes)
+{
+    auto image = make_shared<textureImage>();
+    if (!processTextures) {
+        if (!mapBMP(fileName, image->bgr)) {
+            cout << "Cannot load " << fileName << endl;
+            return nullptr;
         }
+        cpuBytes = image->bgr.file.size();
+        return image;
     }
-    centerOf[thisObj * 3]     = (minX + maxX) / 2;
-    centerOf[thisObj * 3 + 1] = (minY + maxY) / 2;
-    centerOf[thisObj * 3 + 2] = (minZ + maxZ) / 2;
-
-    diagonalLengthOf[thisObj] = (float)sqrt(pow(maxX - minX, 2.0) + pow(maxY - minY, 2.0) + pow(maxZ - minZ, 2.0));
 
-    // center all the vertices
-    for (int i = 0; i < verticesOf[thisObj].size(); i += 3) {
-        verticesOf[thisObj][i]   -= centerOf[thisObj*3];
-        verticesOf[thisObj][i+1] -= centerOf[thisObj*3 + 1];
-        verticesOf[thisObj][i+2] -= centerOf[thisObj*3 + 2];
+    TextureFormat format = compressTextures ? TEXTURE_BC1 : TEXTURE_RGBA8;
+    string cacheFileName = textureCacheFileName(fileName);
+    if (!readTextureCache(cacheFileName, fileName, image->texture) || image->texture.format != format) {
+        imageFile *rgba = getBMP(fileName);
+        if (!rgba) {
+            cout << "Cannot load " << fileName << endl;
+            return nullptr;
+        }
+        buildMipChain(rgba, image->texture);
+        delete[] rgba->data;
+        delete rgba;
+        convertTexture(image->texture, format);
+        if (!writeTextureCache(cacheFileName, fileName, image->texture))
+            cout << "Cannot write texture cache " << cacheFileName << endl;
     }
+    cpuBytes = image->texture.data.size();
+    return image;
 }
 
 /**
- * Compute the face normal of each face.
- * @param thisObj Indicating which object is being processed.
+ * Add the uploads of an image with all its mip levels. BC1 textures are decoded first if the driver has no
+ * S3TC support. BMP rows are uploaded as they are in the file.
+ * @param target The texture target, e.g. GL_TEXTURE_2D or a cube map face.
+ * @param owners Receives what keeps the pixels alive.
+ * @return Bytes of texture memory used.
  */
-void ComputeFaceNormals(int thisObj)
+size_t addImageUploads(GLenum target, const AssetHandle<textureImage>& image, vector<TextureUpload>& uploads,
+                       vector<shared_ptr<const void>>& owners)
 {
-    float firstPoint[3] = { 0.0, 0.0, 0.0 };
-    float secondPoint[3] = { 0.0, 0.0, 0.0 };
-    float thirdPoint[3] = { 0.0, 0.0, 0.0 };
-
-    float firstVector[3] = { 0.0,0.0,0.0 };
-    float secondVector[3] = { 0.0,0.0,0.0 };
-
-    // float tempCenterX, tempCenterY, tempCenterZ;
-    float tempNormalX, tempNormalY, tempNormalZ;
+    owners.push_back(image);
+    if (image->bgr.data) {
+        uploads.push_back({target, 0, image->bgr.width, image->bgr.height, GL_RGBA, GL_BGR, image->bgr.data,
+                           (size_t)image->bgr.rowSize * image->bgr.height});
+        return textureLevelSize(TEXTURE_RGBA8, image->bgr.width, image->bgr.height);
+    }
 
-    for (int i = 0; i < facesOf[thisObj].size(); i += 3)
-    {
-        // get the x,y,z of first, second and third point of the face
-        firstPoint[0]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3];
-        firstPoint[1]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3 + 1];
-        firstPoint[2]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3 + 2];
-        secondPoint[0] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3];
-        secondPoint[1] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3 + 1];
-        secondPoint[2] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3 + 2];
-        thirdPoint[0]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3];
-        thirdPoint[1]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3 + 1];
-        thirdPoint[2]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3 + 2];
-        // FYI:                             ^This is a vertex index^
-
-        // calculate 2 vectors from three ordered points
-        firstVector[0] = secondPoint[0] - firstPoint[0];
-        firstVector[1] = secondPoint[1] - firstPoint[1];
-        firstVector[2] = secondPoint[2] - firstPoint[2];
-        secondVector[0] = thirdPoint[0] - secondPoint[0];
-        secondVector[1] = thirdPoint[1] - secondPoint[1];
-        secondVector[2] = thirdPoint[2] - secondPoint[2];
-
-        // compute normal
-        tempNormalX = firstVector[1] * secondVector[2] - firstVector[2] * secondVector[1];
-        tempNormalY = firstVector[2] * secondVector[0] - firstVector[0] * secondVector[2];
-        tempNormalZ = firstVector[0] * secondVector[1] - firstVector[1] * secondVector[0];
-
-        double tempNormalLength = sqrt(pow(tempNormalX,2) + pow(tempNormalY,2) + pow(tempNormalZ,2));
-        // normalize
-        faceNormalsOf[thisObj].push_back((float)(tempNormalX / tempNormalLength));
-        faceNormalsOf[thisObj].push_back((float)(tempNormalY / tempNormalLength));
-        faceNormalsOf[thisObj].push_back((float)(tempNormalZ / tempNormalLength));
+    const ProcessedTexture *texture = &image->texture;
+    if (texture->format == TEXTURE_BC1 && !GLEW_EXT_texture_compression_s3tc) {
+        auto decoded = make_shared<ProcessedTexture>(image->texture);
+        convertTexture(*decoded, TEXTURE_RGBA8);
+        owners.push_back(decoded);
+        texture = decoded.get();
+    }
+    for (size_t i = 0; i < texture->levels.size(); i++) {
+        const TextureLevel& level = texture->levels[i];
+        bool compressed = texture->format == TEXTURE_BC1;
+        uploads.push_back({target, (GLint)i, level.width, level.height,
+                           compressed ? (GLenum)GL_COMPRESSED_RGB_S3TC_DXT1_EXT : (GLenum)GL_RGBA,
+                           compressed ? (GLenum)0 : (GLenum)GL_RGBA, texture->data.data() + level.offset, level.size});
     }
+    return texture->data.size();
 }
 
 /**
- * Compute the vertex normal of each vertex. Vertex normal is calculated with weighted averaging of
- * face normals whose face contains that vertex.
- * @param thisObj Indicating which object is being processed.
+ * Get the texture object of an image from the asset cache and bind it. On a miss the images are queued
+ * for upload and the texture becomes ready a few frames later, or at once with "--sync-upload".
+ * Must run on the GL thread.
+ * @param target GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP for six images in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order.
+ * @param fileName The image file, or the first cube map face, the texture is cached under.
+ * @param images The loaded images, one or six.
  */
-void ComputeVertexNormals(int thisObj)
+AssetHandle<textureObject> getTexture(GLenum target, const char *fileName, const AssetHandle<textureImage> *images)
 {
-    unsigned int vertexCount = verticesOf[thisObj].size() / 3;
-
-    float firstPoint[3] = { 0.0, 0.0, 0.0 };
-    float secondPoint[3] = { 0.0, 0.0, 0.0 };
-    float thirdPoint[3] = { 0.0, 0.0, 0.0 };
-
-    /**
-    * Stores the information of all faces each vertex is in, for current object only.
-    * Structure:
-    * {v0f0, v0f1, v0f2, ... }, {v1f0, v1f1, ... }, { ... }, ...
-    *   ^vertex0                  ^vertex1
-    * In code example:
-    *      vertexToFace[vertex0][face0]
-    */
-    vector<vector<int>> vertexToFace(vertexCount);
-
-    for (int i = 0; i < facesOf[thisObj].size(); i += 3) {
-        // get the x,y,z of first, second and third point of the face
-        firstPoint[0]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3];
-        firstPoint[1]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3 + 1];
-        firstPoint[2]  = verticesOf[thisObj][facesOf[thisObj][  i  ] * 3 + 2];
-        secondPoint[0] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3];
-        secondPoint[1] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3 + 1];
-        secondPoint[2] = verticesOf[thisObj][facesOf[thisObj][i + 1] * 3 + 2];
-        thirdPoint[0]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3];
-        thirdPoint[1]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3 + 1];
-        thirdPoint[2]  = verticesOf[thisObj][facesOf[thisObj][i + 2] * 3 + 2];
-
-        // compute face volume for each face
-        float temp1P = (secondPoint[1] - firstPoint[1]) * (thirdPoint[2] - firstPoint[2]);
-        float temp2P = (secondPoint[2] - firstPoint[2]) * (thirdPoint[0] - firstPoint[0]);
-        float temp3P = (secondPoint[0] - firstPoint[0]) * (thirdPoint[1] - firstPoint[1]);
-        float temp1N = (secondPoint[1] - firstPoint[1]) * (thirdPoint[0] - firstPoint[0]);
-        float temp2N = (secondPoint[0] - firstPoint[0]) * (thirdPoint[2] - firstPoint[2]);
-        float temp3N = (secondPoint[2] - firstPoint[2]) * (thirdPoint[1] - firstPoint[1]);
-        float tempFaceVolume = (float)0.5 * abs(temp1P + temp2P + temp3P - temp1N - temp2N - temp3N);
-        faceVolumesOf[thisObj].push_back(tempFaceVolume);
-
-        // register face information for its vertices
-        vertexToFace[facesOf[thisObj][  i  ]].push_back(i / 3);
-        vertexToFace[facesOf[thisObj][i + 1]].push_back(i / 3);
-        vertexToFace[facesOf[thisObj][i + 2]].push_back(i / 3);
-        // FYI:      ^-----this vertex-----^ is in      ^ this face
-    }
-
+    AssetHandle<textureObject> texture = assetCache.get<textureObject>(fileName, [&](size_t&, size_t& gpuBytes) {
+        auto created = make_shared<textureObject>();
+        glGenTextures(1, &created->id);
+        vector<TextureUpload> uploads;
+        vector<shared_ptr<const void>> owners;
+        for (int face = 0; face < (target == GL_TEXTURE_CUBE_MAP ? 6 : 1); face++)
+            if (images[face])
+                gpuBytes += addImageUploads(target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target,
+                                            images[face], uploads, owners);
+        weak_ptr<textureObject> uploaded = created;
+        uploadQueue.enqueue(created->id, created, target, move(uploads), make_shared<vector<shared_ptr<const void>>>(move(owners)),
+                            [uploaded] {
+                                if (auto texture = uploaded.lock()) texture->ready = true;
+                            });
+        if (!streamTextures) uploadQueue.update(SIZE_MAX);
+        return created;
+    });
+    glBindTexture(target, texture->id);
+    return texture;
+}
 
-    for (int i = 0; i < vertexCount; i++) {
-        int j;
-        float resultNormalX = 0.0;
-        float resultNormalY = 0.0;
-        float resultNormalZ = 0.0;
-        vector<float> faceVolume;
-        vector<float> faceNormal;
-        float totalVolume = 0.0;
-
-        // get the face volumes for each face which contains vertex i
-        // get the normals too
-        for (j = 0; j < vertexToFace[i].size(); j++) {
-            faceVolume.push_back(faceVolumesOf[thisObj][vertexToFace[i][j]]);
-            faceNormal.push_back(faceNormalsOf[thisObj][vertexToFace[i][j] * 3]);
-            faceNormal.push_back(faceNormalsOf[thisObj][vertexToFace[i][j] * 3 + 1]);
-            faceNormal.push_back(faceNormalsOf[thisObj][vertexToFace[i][j] * 3 + 2]);
-        }
+/**
+ * Bind a texture if all its levels are uploaded, otherwise unbind so the surface is drawn untextured.
+ */
+void bindTexture(GLenum target, const AssetHandle<textureObject>& texture)
+{
+    glBindTexture(target, texture && texture->ready ? texture->id : 0);
+}
 
-        // compute the actual normal
-        for (j = 0; j < faceVolume.size(); j++) {
-            totalVolume += faceVolume[j];
-        }
-        for (j = 0; j < faceVolume.size(); j++) {
-            resultNormalX += (faceVolume[j] / totalVolume) * faceNormal[j * 3];
-            resultNormalY += (faceVolume[j] / totalVolume) * faceNormal[j * 3 + 1];
-            resultNormalZ += (faceVolume[j] / totalVolume) * faceNormal[j * 3 + 2];
-        }
-        auto resultNormalLength = (float)sqrt(pow(resultNormalX, 2) + pow(resultNormalY, 2) + pow(resultNormalZ, 2));
-        // normalize
-        vertexNormalsOf[thisObj].push_back(resultNormalX / resultNormalLength);
-        vertexNormalsOf[thisObj].push_back(resultNormalY / resultNormalLength);
-        vertexNormalsOf[thisObj].push_back(resultNormalZ / resultNormalLength);
+/**
+ * Pack the 2D images into an atlas, get it as one texture and draw the models that use them from copies with their
+ * texture coordinates moved into it. The copies are cached apart from the models, which keep their own texture
+ * coordinates for other users. Must run on the GL thread, after the models are loaded.
+ * @param images Loaded images, indexed by IMAGE_TIGER and IMAGE_GRASS.
+ * @return false, changing nothing, if the images cannot be packed (e.g. raw textures without mipmaps).
+ */
+bool loadTextureAtlas(const AssetHandle<textureImage> *images)
+{
+    const int packedImages[] = {IMAGE_TIGER, IMAGE_GRASS};
+    vector<const ProcessedTexture *> textures;
+    for (int image : packedImages) {
+        if (!images[image]) return false;
+        textures.push_back(&images[image]->texture);
     }
+    TextureAtlas atlas;
+    if (!buildTextureAtlas(textures, ATLAS_LEVELS, atlas)) return false;
+    sceneEntry& tiger = models[OBJ_TIGER];
+    string atlasName = tiger.fileName + " in texture atlas";
+    AssetHandle<sceneModel> remapped = assetCache.get<sceneModel>(atlasName, [&](size_t& cpuBytes, size_t&) {
+        const sceneModel& source = *tiger.asset;
+        auto model = make_shared<sceneModel>();
+        copyMeshGeometry(source.mesh, model->mesh);
+        if (!remapTextureCoordinates(atlas, ATLAS_TIGER, model->mesh.textureCoordinates, model->mesh.textureCoordinateCount))
+            return shared_ptr<sceneModel>();
+        // the levels of detail keep a subset of the coordinates, which fall into the same tile
+        for (const MeshLod& sourceLod : source.lods) {
+            model->lods.emplace_back();
+            MeshLod& lod = model->lods.back();
+            copyMeshGeometry(sourceLod.mesh, lod.mesh);
+            lod.error = sourceLod.error;
+            remapTextureCoordinates(atlas, ATLAS_TIGER, lod.mesh.textureCoordinates, lod.mesh.textureCoordinateCount);
+        }
+        model->fromMeshCache = source.fromMeshCache;
+        cpuBytes = modelBytes(*model);
+        return model;
+    });
+    if (!remapped) return false;
+    tiger.asset = remapped;
+    tiger.assetName = atlasName;
+
+    auto atlasImage = make_shared<textureImage>();
+    atlasImage->texture = move(atlas.texture);
+    atlasLayout.entries = move(atlas.entries);
+    atlasLayout.texture.format = atlasImage->texture.format;
+    atlasLayout.texture.levels = atlasImage->texture.levels;
+    AssetHandle<textureImage> atlasImages[] = {atlasImage};
+    textureAtlas = getTexture(GL_TEXTURE_2D, "texture atlas", atlasImages);
+    return true;
 }
 
 /**
- * Load an OBJ file into verticesOf[thisObj] and facesOf[thisObj] (and textureCoordinateOf[thisObj] if it has texture data).
- * @param fileName The name of OBJ file to load.
- * @param thisObj The object index.
+ * Get the texture objects, uploading the images that are not resident yet. Must run on the GL thread.
+ * @param images Loaded images, indexed by IMAGE_TIGER, IMAGE_GRASS and IMAGE_CUBE.
  */
-void loadOBJ(const std::string& fileName, int thisObj)
+void loadTextures(const AssetHandle<textureImage> *images)
 {
-    // clear the data before reading into it
-    verticesOf[thisObj].clear();
-    facesOf[thisObj].clear();
-    textureCoordinateOf[thisObj].clear();
-
-    std::string line;
-    int count, vertexIndex1, vertexIndex2, vertexIndex3;
-    float coordinateValue;
-    char currentCharacter, previousCharacter;
-
-    // Open the OBJ file.
-    std::ifstream inFile(fileName.c_str(), std::ifstream::in);
+    // Trilinear filtering over the mip chain, the nearest texel of level 0 for raw textures.
+    GLint minifyFilter = processTextures ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST;
+
+    if (useTextureAtlas && loadTextureAtlas(images)) {
+        // The gutters stand in for repeating, and the levels below ATLAS_LEVELS would mix the entries.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_LEVELS - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minifyFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    else {
+        useTextureAtlas = false;
+
+        // load tiger texture.
+        textureTiger = getTexture(GL_TEXTURE_2D, imageFileNames[IMAGE_TIGER], images + IMAGE_TIGER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minifyFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        // Bind grass image to texture object textureGrass.
+        textureGrass = getTexture(GL_TEXTURE_2D, imageFileNames[IMAGE_GRASS], images + IMAGE_GRASS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minifyFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
 
-    // Read successive lines.
-    while (getline(inFile, line))
-    {
-        // Line has vertex data.
-        if (line.substr(0, 2) == "v ")
-        {
-            // Initialize a string from the character after "v " to the end.
-            std::istringstream currentString(line.substr(2));
-
-            // Read x, y and z values. The (optional) w value is not read.
-            for (count = 1; count <= 3; count++)
-            {
-                currentString >> coordinateValue;
-                verticesOf[thisObj].push_back(coordinateValue);
-            }
-        }
+    // Bind the cube map texture and define its 6 component textures, code from skybox.cpp
+    textureCube = getTexture(GL_TEXTURE_CUBE_MAP, imageFileNames[IMAGE_CUBE], images + IMAGE_CUBE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, processTextures ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
 
-        // Line has face data.
-        else if (line.substr(0, 2) == "f ")
-        {
-            // Initialize a string from the character after "f " to the end.
-            std::istringstream currentString(line.substr(2));
-
-            // Strategy in the following to detect a vertex index within a face line is based on the
-            // fact that vertex indices are exactly those that follow a white space. Texture and
-            // normal indices are ignored.
-            // Moreover, from the third vertex of a face on output one triangle per vertex, that
-            // being the next triangle in a fan triangulation of the face about the first vertex.
-            previousCharacter = ' ';
-            count = 0;
-            while (currentString.get(currentCharacter))
-            {
-                // Stop processing line at comment.
-                if ((previousCharacter == '#') || (currentCharacter == '#')) break;
-
-                // Current character is the start of a vertex index.
-                if ((previousCharacter == ' ') && (currentCharacter != ' '))
-                {
-                    // Move the string cursor back to just before the vertex index.
-                    currentString.unget();
-
-                    // Read the first vertex index, decrement it so that the index range is from 0, increment vertex counter.
-                    if (count == 0)
-                    {
-                        currentString >> vertexIndex1;
-                        vertexIndex1--;
-                        count++;
-                    }
-
-                        // Read the second vertex index, decrement it, increment vertex counter.
-                    else if (count == 1)
-                    {
-                        currentString >> vertexIndex2;
-                        vertexIndex2--;
-                        count++;
-                    }
-
-                        // Read the third vertex index, decrement it, increment vertex counter AND output the first triangle.
-                    else if (count == 2)
-                    {
-                        currentString >> vertexIndex3;
-                        vertexIndex3--;
-                        count++;
-                        facesOf[thisObj].push_back(vertexIndex1);
-                        facesOf[thisObj].push_back(vertexIndex2);
-                        facesOf[thisObj].push_back(vertexIndex3);
-                    }
-
-                        // From the fourth vertex and on output the next triangle of the fan.
-                    else
-                    {
-                        vertexIndex2 = vertexIndex3;
-                        currentString >> vertexIndex3;
-                        vertexIndex3--;
-                        facesOf[thisObj].push_back(vertexIndex1);
-                        facesOf[thisObj].push_back(vertexIndex2);
-                        facesOf[thisObj].push_back(vertexIndex3);
-                    }
-
-                    // Begin the process of detecting the next vertex index just after the vertex index just read.
-                    currentString.get(previousCharacter);
-                }
-
-                    // Current character is not the start of a vertex index. Move ahead one character.
-                else previousCharacter = currentCharacter;
-            }
-        }
-        // line has texture coordinate data
-        else if (line.substr(0, 3) == "vt ") {
-            // Initialize a string from the character after "vt " to the end.
-            std::istringstream currentString(line.substr(3));
-
-            // Read x, y values.
-            for (count = 1; count <= 2; count++)
-            {
-                currentString >> coordinateValue;
-                textureCoordinateOf[thisObj].push_back(coordinateValue);
-            }
+/**
+ * Drop the texture handles and every cached asset while the GL context still exists.
+ */
+void releaseAssets()
+{
+    uploadQueue.destroy();
+    for (sceneEntry& model : models) {
+        for (int level = 0; level < MESH_MAX_LODS; level++) {
+            model.buffers[level].destroy();
+            model.instanceBuffers[level].destroy();
         }
-        // Nothing other than vertex and face data and texture coordinate is processed.
+        model.asset.reset();
     }
-
-    // Close the OBJ file.
-    inFile.close();
+    instancedRenderer.destroy();
+    textureGrass.reset();
+    textureAtlas.reset();
+    textureCube.reset();
+    textureTiger.reset();
+    assetCache.clear();
 }
 
 /**
- * Load an OBJ file and call calculation functions to process that OBJ.
- * @param fileName The name of OBJ file to load.
- * @param thisObj The object index.
+ * Print the asset cache counters and memory use.
  */
-void loadOBJAndProcess(const std::string& fileName, int thisObj)
+void printAssetCacheStats()
 {
-    loadOBJ(fileName, thisObj);
-    ComputeBoundingBox(thisObj);
-    ComputeFaceNormals(thisObj);
-    ComputeVertexNormals(thisObj);
+    AssetCacheStats stats = assetCache.stats();
+    cout << "Asset cache: " << stats.assets << " assets, " << stats.hits << " hits, " << stats.misses << " misses, "
+         << stats.evictions << " evictions, CPU " << stats.cpuBytes / 1024 << " / " << stats.cpuBudget / 1024
+         << " KB, GPU " << stats.gpuBytes / 1024 << " / " << stats.gpuBudget / 1024 << " KB." << endl;
 }
 
-// Load external textures.
-void loadTextures()
+/**
+ * Run an asset loading job on a worker thread, or defer it to get() when loading serially.
+ * @param milliseconds Receives the time the job took.
+ */
+template <typename Job>
+future<void> loadAsset(Job job, double *milliseconds)
 {
-    // load tiger texture.
-    imageFile *tigerTexture;
-    tigerTexture = getBMP("../models/TigerTexture.bmp");
-    glBindTexture(GL_TEXTURE_2D, textureTiger);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tigerTexture->width, tigerTexture->height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, tigerTexture->data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Local storage for bmp image data.
-    imageFile *image[1];
-
-    // Load the images.
-    image[0] = getBMP("../textures/grass.bmp");
-
-    // Bind grass image to texture object texture[0].
-    glBindTexture(GL_TEXTURE_2D, texture[0]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image[0]->width, image[0]->height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, image[0]->data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // load skybox texture, code from skybox.cpp
-    // Local storage for bmp image data.
-    imageFile *imageCube[6];
-
-    // Load the six cube map images.
-    imageCube[0] = getBMP("../textures/IceRiver/posx.bmp");
-    imageCube[1] = getBMP("../textures/IceRiver/negx.bmp");
-    imageCube[2] = getBMP("../textures/IceRiver/posy.bmp");
-    imageCube[3] = getBMP("../textures/IceRiver/negy.bmp");
-    imageCube[4] = getBMP("../textures/IceRiver/posz.bmp");
-    imageCube[5] = getBMP("../textures/IceRiver/negz.bmp");
-
-    // Bind the cube map texture and define its 6 component textures.
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureCube);
-    for (int face = 0; face < 6; face++)
-    {
-        int target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
-        glTexImage2D(target, 0, GL_RGBA, imageCube[0]->width, imageCube[0]->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageCube[face]->data);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return async(serialAssetLoading ? launch::deferred : launch::async, [job, milliseconds] {
+        auto start = chrono::steady_clock::now();
+        job();
+        *milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    });
 }
 
 // Initialization routine.
 void setup()
 {
-    // initialize vectors
-    verticesOf.resize(MODEL_NUMBERS);
-    facesOf.resize(MODEL_NUMBERS);
-    // faceCentersOf.resize(MODEL_NUMBERS);
-    faceNormalsOf.resize(MODEL_NUMBERS);
-    vertexNormalsOf.resize(MODEL_NUMBERS);
-    faceVolumesOf.resize(MODEL_NUMBERS);
-    centerOf.resize(MODEL_NUMBERS * 3);
-    diagonalLengthOf.resize(MODEL_NUMBERS);
-    textureCoordinateOf.resize(MODEL_NUMBERS);
+    for (const char *fileName : modelFileNames) addModel(fileName);
+    int modelCount = (int)models.size();
 
     glClearColor(1.0, 1.0, 1.0, 0.0);
     glEnable(GL_DEPTH_TEST);
     // glEnable(GL_CULL_FACE);
     glEnable(GL_DEPTH_CLAMP);
 
-    // load obj models
-    loadOBJAndProcess("../models/Bunny.obj", OBJ_BUNNY);
-    loadOBJAndProcess("../models/Cat.obj", OBJ_CAT);
-    loadOBJAndProcess("../models/Dog.obj", OBJ_DOG);
-    loadOBJAndProcess("../models/Duck.obj", OBJ_DUCK);
-    loadOBJAndProcess("../models/Tiger.obj", OBJ_TIGER);
-
-    // Create texture ids.
-    glGenTextures(2, texture);
-    glGenTextures(1, &textureCube);
+    // Load obj models and decode images concurrently. Every job writes only to its own model index
+    // or image slot, so they need no locking. GL calls stay on this thread.
+    auto loadStart = chrono::steady_clock::now();
+    vector<double> assetTimes(modelCount + IMAGE_NUMBERS);
+    AssetHandle<textureImage> images[IMAGE_NUMBERS];
+    vector<future<void>> jobs;
+    for (int i = 0; i < modelCount; i++)
+        jobs.push_back(loadAsset([i] {
+            const string& fileName = models[i].fileName;
+            models[i].asset = assetCache.get<sceneModel>(fileName, [&fileName](size_t& cpuBytes, size_t&) {
+                return loadModel(fileName, cpuBytes);
+            });
+        }, &assetTimes[i]));
+    for (int i = 0; i < IMAGE_NUMBERS; i++)
+        jobs.push_back(loadAsset([i, &images] {
+            images[i] = assetCache.get<textureImage>(imageFileNames[i], [i](size_t& cpuBytes, size_t&) {
+                return loadImage(imageFileNames[i], cpuBytes);
+            });
+        }, &assetTimes[modelCount + i]));
+    for (future<void>& job : jobs) job.get();
+
+    // Upload external textures.
+    if (streamTextures && !uploadQueue.create(uploadRingSize))
+        cout << "Pixel buffer streaming not supported, textures are uploaded synchronously." << endl;
+    loadTextures(images);
+
+    if (instanceCount) {
+        // placed as drawScene() places the models: bunny, cat, dog, duck, tiger
+        const float sizes[] = {10.0f, 10.0f, 10.0f, 10.0f, 20.0f}, heights[] = {3.0f, 5.0f, 5.0f, 3.0f, 5.0f};
+        const float rotations[][3] = {{0.0f, 0.0f, 0.0f}, {-90.0f, 0.0f, 60.0f}, {-90.0f, 0.0f, 30.0f},
+                                      {-90.0f, 0.0f, 0.0f}, {-90.0f, 0.0f, 115.0f}};
+        const float colors[][3] = {{1.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f},
+                                   {1.0f, 1.0f, 1.0f}};
+        const bool flatShaded[] = {false, true, true, false, false};
+        vector<ScatteredModel> scattered;
+        for (int i = 0; i < modelCount; i++) {
+            ScatteredModel model = {sizes[i] / models[i].asset->mesh.diagonalLength, {rotations[i][0], rotations[i][1], rotations[i][2]},
+                                    heights[i], {colors[i][0], colors[i][1], colors[i][2]}, flatShaded[i]};
+            scattered.push_back(model);
+        }
+        scatterInstances(scattered, instanceCount, 200.0f, 1, instancesOf);
+        if (useInstancing && !instancedRenderer.create())
+            cout << "Instanced drawing not supported, the scattered copies are drawn in batches." << endl;
+    }
 
-    // Load external textures.
-    loadTextures();
+    double totalTime = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+    double slowestTime = 0.0, sumTime = 0.0;
+    for (double time : assetTimes) {
+        slowestTime = max(slowestTime, time);
+        sumTime += time;
+    }
+    cout << "Loaded " << modelCount << " models and " << IMAGE_NUMBERS << " images "
+         << (serialAssetLoading ? "serially" : "concurrently") << " in " << totalTime << " ms "
+         << "(slowest asset " << slowestTime << " ms, all assets one after another " << sumTime << " ms)." << endl;
+    for (int i = 0; i < modelCount; i++) {
+        cout << "    " << models[i].fileName << ": " << assetTimes[i] << " ms"
+             << (models[i].asset->fromMeshCache ? " (mesh cache)" : "");
+        if (!models[i].asset->lods.empty()) {
+            cout << ", levels of detail of";
+            for (const MeshLod& lod : models[i].asset->lods) cout << " " << lod.mesh.faceCount;
+            cout << " faces";
+        }
+        cout << endl;
+    }
+    for (int i = 0; i < IMAGE_NUMBERS; i++) {
+        if (!images[i] || images[i]->texture.levels.empty()) continue;
+        const ProcessedTexture& texture = images[i]->texture;
+        cout << "    " << imageFileNames[i] << ": " << assetTimes[modelCount + i] << " ms, "
+             << texture.data.size() / 1024 << " KB " << (texture.format == TEXTURE_BC1 ? "BC1" : "RGBA8")
+             << " with mipmaps (" << textureLevelSize(TEXTURE_RGBA8, texture.levels[0].width, texture.levels[0].height) / 1024
+             << " KB as RGBA without)" << endl;
+    }
 
+    // The uploaded images are no longer referenced and stay cached only as far as the budget allows.
+    for (AssetHandle<textureImage>& image : images) image.reset();
+    assetCache.trim();
+    printAssetCacheStats();
 
     // Turn on OpenGL texturing.
     glEnable(GL_TEXTURE_2D);
@@ -563,7 +668,89 @@ void setup()
 }
 
 /**
- * Draw certain model in the scene.
+ * Sinks of emitMeshTriangles() (see meshEmission.h) sending the corners of a mesh to glBegin(GL_TRIANGLES), the
+ * normals being those of the shading.
+ */
+struct ImmediateSink
+{
+    const float *positions, *normals, *textureCoordinates;
+
+    void faceNormal(size_t face) { glNormal3fv(normals + face * 3); }
+    void vertexNormal(size_t vertex) { glNormal3fv(normals + vertex * 3); }
+    void textureCoordinate(size_t vertex) { glTexCoord2fv(textureCoordinates + vertex * 2); }
+    void vertex(size_t vertex) { glVertex3fv(positions + vertex * 3); }
+};
+
+struct QuantizedImmediateSink
+{
+    const QuantizedMesh *mesh;
+    const short *positions, *normals;
+
+    void faceNormal(size_t face)
+    {
+        float normal[3];
+        decodeOctahedral(normals + face * 2, normal);
+        glNormal3fv(normal);
+    }
+    void vertexNormal(size_t vertex) { faceNormal(vertex); }
+    void textureCoordinate(size_t vertex)
+    {
+        float textureCoordinate[2];
+        mesh->decodeTextureCoordinate(vertex, textureCoordinate);
+        glTexCoord2fv(textureCoordinate);
+    }
+    void vertex(size_t vertex) { glVertex3sv(positions + vertex * 3); }
+};
+
+/**
+ * Draw the triangles of a mesh from its quantized copy, which is made with the normals of its shading on the first
+ * draw; the float mesh is shared through the asset cache and keeps its geometry, but not its normals. Positions are
+ * decoded by the modelview matrix, normals and texture coordinates as they are sent.
+ */
+void drawQuantizedTriangles(Mesh& mesh, QuantizedMesh& quantized, bool isFlatShaded)
+{
+    if (quantized.faceCount == 0 && mesh.faceCount) {
+        if (isFlatShaded) requireFaceNormals(mesh);
+        else requireVertexNormals(mesh);
+        quantizeMesh(mesh, quantized);
+        mesh.releaseAttributes(MESH_ALL_ATTRIBUTES);
+    }
+    QuantizedImmediateSink sink = {&quantized, quantized.positions.data(),
+                                   isFlatShaded ? quantized.faceNormals.data() : quantized.vertexNormals.data()};
+    bool hasTexture = quantized.textureCoordinateCount != 0;
+
+    glTranslatef(quantized.positionOffset[0], quantized.positionOffset[1], quantized.positionOffset[2]);
+    glScalef(quantized.positionScale, quantized.positionScale, quantized.positionScale);
+    glShadeModel(isFlatShaded ? GL_FLAT : GL_SMOOTH);
+    glBegin(GL_TRIANGLES);
+    if (quantized.shortFaces.empty()) emitMeshTriangles(isFlatShaded, hasTexture, quantized.faces.data(), faceRanges, sink);
+    else emitMeshTriangles(isFlatShaded, hasTexture, quantized.shortFaces.data(), faceRanges, sink);
+    glEnd();
+}
+
+/**
+ * Draw the triangles of a mesh from its vertex and index buffers, which are uploaded with the normals of its shading
+ * on the first draw; the float mesh then keeps its geometry (for meshlets and statistics) but not its normals.
+ * @return false if the buffers cannot be made: nothing is drawn, and immediate mode is used from then on.
+ */
+bool drawMeshBuffers(Mesh& mesh, MeshBuffers& buffers, bool isFlatShaded)
+{
+    if (!buffers.created() || buffers.flatShaded() != isFlatShaded) {
+        if (!buffers.create(mesh, isFlatShaded)) {
+            cout << "Vertex array objects are not supported, drawing in immediate mode." << endl;
+            useMeshBuffers = false;
+            return false;
+        }
+        mesh.releaseAttributes(MESH_ALL_ATTRIBUTES);
+    }
+    glShadeModel(isFlatShaded ? GL_FLAT : GL_SMOOTH);
+    buffers.draw(faceRanges);
+    return true;
+}
+
+/**
+ * Draw certain model in the scene, at the level of detail its distance allows. The normals of its shading are
+ * computed the first time it is drawn.
  * @param thisObj The object index.
  * @param isFlatShaded Is render style flat or smooth.
  * @param translate Parameters to move the object around.
@@ -578,12 +765,21 @@ void drawMesh(int thisObj, bool isFlatShaded, const float* translate, float scal
 
     glEnable(GL_NORMALIZE); // crucial operation when scaling model: re-normalize all normals
 
-    float s = scaleAll / diagonalLengthOf[thisObj];
+    sceneEntry& model = models[thisObj];
+    float s = scaleAll / model.asset->mesh.diagonalLength;
 
-    bool hasTexture = false;
-    if (!textureCoordinateOf[thisObj].empty()) {
-        hasTexture = true;
+    // the level of detail, from the size of the model's error on screen at the nearest point of its bounding sphere
+    int level = 0;
+    if (useLods) {
+        float dx = cameraX - translate[0], dy = cameraY - translate[1], dz = cameraZ - translate[2];
+        float distance = max(sqrtf(dx * dx + dy * dy + dz * dz) - scaleAll * 0.5f, 0.01f);
+        level = selectMeshLod(model.asset->lods, lodPixelsPerUnit(s, distance, fov, windowHeight), lodThreshold, model.lodLevel);
+        model.lodLevel = level;
     }
+    Mesh& mesh = level ? model.asset->lods[level - 1].mesh : model.asset->mesh;
+    QuantizedMesh& quantized = model.quantized[level];
+    vector<Meshlet>& meshlets = model.meshlets[level];
+    MeshBuffers& buffers = model.buffers[level];
 
     glScalef(s, s, s);
     glTranslatef(translate[0]/s, translate[1]/s, translate[2]/s); // move
@@ -602,63 +798,79 @@ void drawMesh(int thisObj, bool isFlatShaded, const float* translate, float scal
     glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, matSpec);
     glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, matShine);
 
+    // the faces of the meshlets left after culling against the view, or all of them
+    facesTotal += mesh.faceCount;
+    if (useMeshletCulling) {
+        if (meshlets.empty() && mesh.faceCount) buildMeshlets(mesh, meshlets);
+        float modelview[16], projection[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+        glGetFloatv(GL_PROJECTION_MATRIX, projection);
+        MeshletView view;
+        meshletViewFromMatrices(modelview, projection, view);
+        view.backFacesCulled = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+        facesSubmitted += cullMeshlets(meshlets, view, faceRanges);
+        if (printCullStatistics)
+            for (const auto& range : faceRanges) facesSeen += countVisibleFaces(mesh, range.first, range.second, view);
+    }
+    else {
+        faceRanges.assign(1, make_pair((size_t)0, mesh.faceCount));
+        facesSubmitted += mesh.faceCount;
+    }
+
     // draw the triangles
-    if (isFlatShaded) {
-        glShadeModel(GL_FLAT);
-        glBegin(GL_TRIANGLES);
-        for (int i = 0; i < facesOf[thisObj].size(); i += 3) {
-            glNormal3f(faceNormalsOf[thisObj][i],faceNormalsOf[thisObj][i+1],faceNormalsOf[thisObj][i+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i]*3+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i+1]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i+1]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i+1]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i+1]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i+1]*3+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i+2]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i+2]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i+2]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i+2]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i+2]*3+2]);
-        }
-        glEnd();
+    if (quantizeMeshes) drawQuantizedTriangles(mesh, quantized, isFlatShaded);
+    else if (useMeshBuffers && drawMeshBuffers(mesh, buffers, isFlatShaded)) {
+        // drawn from the buffers
     }
     else {
-        glShadeModel(GL_SMOOTH);
+        ImmediateSink sink = {mesh.positions, isFlatShaded ? requireFaceNormals(mesh) : requireVertexNormals(mesh),
+                              mesh.textureCoordinates};
+        glShadeModel(isFlatShaded ? GL_FLAT : GL_SMOOTH);
         glBegin(GL_TRIANGLES);
-        for (int i = 0; i < facesOf[thisObj].size(); i += 3) {
-            glNormal3f(vertexNormalsOf[thisObj][facesOf[thisObj][i]*3],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i]*3+1],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i]*3+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i]*3+2]);
-            glNormal3f(vertexNormalsOf[thisObj][facesOf[thisObj][i+1]*3],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i+1]*3+1],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i+1]*3+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i+1]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i+1]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i+1]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i+1]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i+1]*3+2]);
-            glNormal3f(vertexNormalsOf[thisObj][facesOf[thisObj][i+2]*3],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i+2]*3+1],
-                       vertexNormalsOf[thisObj][facesOf[thisObj][i+2]*3+2]);
-            if (hasTexture) glTexCoord2f(textureCoordinateOf[thisObj][facesOf[thisObj][i+2]*2],
-                                         textureCoordinateOf[thisObj][facesOf[thisObj][i+2]*2 + 1]);
-            glVertex3f(verticesOf[thisObj][facesOf[thisObj][i+2]*3],
-                       verticesOf[thisObj][facesOf[thisObj][i+2]*3+1],
-                       verticesOf[thisObj][facesOf[thisObj][i+2]*3+2]);
-        }
+        emitMeshTriangles(isFlatShaded, mesh.hasTextureCoordinates(), mesh.faces, faceRanges, sink);
         glEnd();
     }
 
     glPopMatrix();
+    updateModelBytes(model);
+}
+
+/**
+ * Draw the scattered copies of the models, each at the level of detail its distance allows; those outside the view
+ * are left out.
+ */
+void drawInstances()
+{
+    float modelview[16], projection[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    MeshletView view;
+    meshletViewFromMatrices(modelview, projection, view);
+
+    float matSpec[] = { 1.0, 1.0, 1.0, 1.0 };
+    float matShine[] = { 50.0 };
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, matSpec);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, matShine);
+
+    for (int thisObj = 0; thisObj < (int)instancesOf.size(); thisObj++) {
+        sceneEntry& model = models[thisObj];
+        instancesDrawn += sortInstancesByLod(instancesOf[thisObj], model.asset->lods, model.asset->mesh.diagonalLength * 0.5f,
+                                             view, fov, windowHeight, lodThreshold, instanceLevels);
+        for (int level = 0; level < (int)instanceLevels.size(); level++) {
+            const vector<MeshInstance>& instances = instanceLevels[level];
+            Mesh& mesh = level ? model.asset->lods[level - 1].mesh : model.asset->mesh;
+            facesTotal += instances.size() * mesh.faceCount;
+            facesSubmitted += instances.size() * mesh.faceCount;
+            if (instances.empty()) continue;
+            if (instancedRenderer.created()) {
+                MeshBuffers& buffers = model.instanceBuffers[level];
+                if (!buffers.created()) buffers.create(mesh, false);
+                instancedRenderer.draw(buffers, instances);
+            }
+            else instanceBatcher.draw(mesh, instances);
+        }
+        updateModelBytes(model);
+    }
 }
 
 /**
@@ -682,7 +894,7 @@ void drawSkybox() {
     glTranslatef(lookatX, lookatY, lookatZ);
     glRotatef(yaw/PI*180 + 180, 0.0, 1.0, 0.0);
     glRotatef(pitch/PI*180, 1.0, 0.0, 0.0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureCube);
+    bindTexture(GL_TEXTURE_CUBE_MAP, textureCube);
     glBegin(GL_POLYGON);
     // support (at most) 2:1 widescreen
     glTexCoord3f(-2.0, 1.0, 1.0); glVertex3f(-1000.0, -500.0, -500.0);
@@ -730,7 +942,11 @@ void enableLighting()
 // Drawing routine.
 void drawScene()
 {
+    // stream queued texture levels, textures become visible once their uploads have finished
+    uploadQueue.update(uploadBudget);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    facesTotal = facesSubmitted = facesSeen = instancesDrawn = 0;
 
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
     drawSkybox();
@@ -773,24 +989,61 @@ void drawScene()
     float translateTiger[] = {-5.0f+tTiger[0], 5.0f+tTiger[1], -10.0f+tTiger[2]};
     float rotateTiger[] = {-90.0f+rTiger[0], 0.0f+rTiger[1], 115.0f+rTiger[2]};
     float colorTiger[] = {1.0, 1.0, 1.0};
-    glBindTexture(GL_TEXTURE_2D, textureTiger);
+    // with the atlas this is the only bind for the textured meshes and the ground
+    bindTexture(GL_TEXTURE_2D, useTextureAtlas ? textureAtlas : textureTiger);
     drawMesh(OBJ_TIGER, false, translateTiger, 20, rotateTiger, colorTiger);
 
+    if (!instancesOf.empty()) drawInstances();
+
     // Specify how texture values combine with current surface color values.
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
-    // Map the grass texture onto a rectangle along the xz-plane.
-    glBindTexture(GL_TEXTURE_2D, texture[0]);
-    glBegin(GL_POLYGON);
-    glTexCoord2f(0.0, 0.0); glVertex3f(-100.0, 0.0, 100.0);
-    glTexCoord2f(8.0, 0.0); glVertex3f(100.0, 0.0, 100.0);
-    glTexCoord2f(8.0, 8.0); glVertex3f(100.0, 0.0, -100.0);
-    glTexCoord2f(0.0, 8.0); glVertex3f(-100.0, 0.0, -100.0);
-    glEnd();
+    // Map the grass texture onto a rectangle along the xz-plane, facing up rather than lit with whatever normal the
+    // last vertex of the tiger left behind.
+    glNormal3f(0.0, 1.0, 0.0);
+    if (useTextureAtlas) {
+        // The atlas cannot repeat the grass, so the rectangle is split into the 8x8 tiles it repeated over.
+        float u0, v0, u1, v1;
+        atlasTextureCoordinate(atlasLayout, ATLAS_GRASS, 0.0f, 0.0f, u0, v0);
+        atlasTextureCoordinate(atlasLayout, ATLAS_GRASS, 1.0f, 1.0f, u1, v1);
+        glBegin(GL_QUADS);
+        for (int i = 0; i < 8; i++)
+            for (int j = 0; j < 8; j++) {
+                float x = -100.0f + 25.0f * i, z = 100.0f - 25.0f * j;
+                glTexCoord2f(u0, v0); glVertex3f(x, 0.0, z);
+                glTexCoord2f(u1, v0); glVertex3f(x + 25.0f, 0.0, z);
+                glTexCoord2f(u1, v1); glVertex3f(x + 25.0f, 0.0, z - 25.0f);
+                glTexCoord2f(u0, v1); glVertex3f(x, 0.0, z - 25.0f);
+            }
+        glEnd();
+    }
+    else {
+        bindTexture(GL_TEXTURE_2D, textureGrass);
+        glBegin(GL_POLYGON);
+        glTexCoord2f(0.0, 0.0); glVertex3f(-100.0, 0.0, 100.0);
+        glTexCoord2f(8.0, 0.0); glVertex3f(100.0, 0.0, 100.0);
+        glTexCoord2f(8.0, 8.0); glVertex3f(100.0, 0.0, -100.0);
+        glTexCoord2f(0.0, 8.0); glVertex3f(-100.0, 0.0, -100.0);
+        glEnd();
+    }
 
     // smooth movement-per-frame with a keymap
     movement();
 
+    // evict assets released this frame if over budget
+    assetCache.trim();
+
+    if (printCullStatistics) {
+        cout << "triangles: " << facesSubmitted << " of " << facesTotal << " submitted";
+        cout << ", " << facesSeen << " seen";
+        if (useLods) {
+            cout << ", levels";
+            for (const sceneEntry& model : models) cout << " " << model.lodLevel;
+        }
+        if (!instancesOf.empty()) cout << ", " << instancesDrawn << " of " << instanceCount << " copies";
+        cout << endl;
+    }
+
     glutSwapBuffers();
 }
 
@@ -998,7 +1251,7 @@ void keyDown(unsigned char key, int x, int y)
 {
     switch (key)
     {
-        case 27: exit(0);
+        case 27: releaseAssets(); exit(0);
         case 'w':
         case 'W': keyState['w'] = true; break;
         case 'a':
@@ -1015,6 +1268,8 @@ void keyDown(unsigned char key, int x, int y)
         case '3': controlModel = 2; cout << "Now controlling: dog." << endl; break;
         case '4': controlModel = 3; cout << "Now controlling: duck." << endl; break;
         case '5': controlModel = 4; cout << "Now controlling: tiger." << endl; break;
+        case 'p':
+        case 'P': printAssetCacheStats(); break;
         case 'j': keyState['j'] = true; break;
         case 'J': keyState['J'] = true; break;
         case 'k': keyState['k'] = true; break;
@@ -1125,7 +1380,10 @@ void lightMenu(int id)
 // right click menu function
 void rightMenu(int id)
 {
-    if (id == ID_QUIT) exit(0);
+    if (id == ID_QUIT) {
+        releaseAssets();
+        exit(0);
+    }
 }
 
 // create right click menu
@@ -1159,12 +1417,36 @@ void printInteraction()
     std::cout << "Press w, a, s, d to move around, left click mouse to toggle see-around mode on & off." << std::endl;
     std::cout << "Press 1, 2, 3, 4, 5 to choose a model and use arrow keys to rotate them, use j, k, l, J, K, L (NOTE: USE RIGHT SHIFT or CAPSLOCK) to move them." << std::endl;
     std::cout << "Press c or left shift to move down, space to move up, right click to bring up the light menu." << std::endl;
+    std::cout << "Press p to print the asset cache counters." << std::endl;
     std::cout << "You can freely resize the window." << std::endl;
 }
 
 // Main routine.
 int main(int argc, char **argv)
 {
+    int cpuBudgetMB = 256, gpuBudgetMB = 512;
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--serial-load") serialAssetLoading = true;
+        if (string(argv[i]) == "--no-mesh-cache") useMeshCache = false;
+        if (string(argv[i]) == "--stream-budget" && i + 1 < argc) streamBudget = (size_t)(atof(argv[++i]) * 1048576.0);
+        if (string(argv[i]) == "--raw-textures") processTextures = false;
+        if (string(argv[i]) == "--no-texture-compression") compressTextures = false;
+        if (string(argv[i]) == "--sync-upload") streamTextures = false;
+        if (string(argv[i]) == "--no-atlas") useTextureAtlas = false;
+        if (string(argv[i]) == "--quantize-meshes") quantizeMeshes = true;
+        if (string(argv[i]) == "--immediate-mode") useMeshBuffers = false;
+        if (string(argv[i]) == "--instances" && i + 1 < argc) instanceCount = (size_t)atof(argv[++i]);
+        if (string(argv[i]) == "--no-instancing") useInstancing = false;
+        if (string(argv[i]) == "--no-meshlet-culling") useMeshletCulling = false;
+        if (string(argv[i]) == "--cull-stats") printCullStatistics = true;
+        if (string(argv[i]) == "--no-lod") useLods = false;
+        if (string(argv[i]) == "--lod-pixels" && i + 1 < argc) lodThreshold = (float)atof(argv[++i]);
+        if (string(argv[i]) == "--cpu-budget" && i + 1 < argc) cpuBudgetMB = atoi(argv[++i]);
+        else if (string(argv[i]) == "--gpu-budget" && i + 1 < argc) gpuBudgetMB = atoi(argv[++i]);
+    }
+    assetCache.setBudget((size_t)cpuBudgetMB << 20, (size_t)gpuBudgetMB << 20);
+
     printInteraction();
     glutInit(&argc, argv);
 
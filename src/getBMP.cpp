@@ -1,77 +1,139 @@
 // Routine to read an uncompressed 24-bit unindexed color RGB BMP file into a 
 // 32-bit color RGBA image file (alpha values all being set to 1).
+// The file is memory mapped and its pixels are converted in a single pass, straight into the output image.
 
-#include <fstream>
+#include <cstdint>
+#include <cstring>
 
+#include "../include/cpuFeatures.h"
 #include "../include/getBMP.h"
 
-imageFile *getBMP(const std::string& fileName)
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+int32_t readInt32(const char *p)
+{
+	int32_t value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+int16_t readInt16(const char *p)
+{
+	int16_t value;
+	memcpy(&value, p, 2);
+	return value;
+}
+
+// Convert count pixels, one at a time.
+void convertRowScalar(const unsigned char *in, unsigned char *out, int count)
 {
-	int offset, // No. of bytes to start of image data in input BMP file. 
-		w, // Width in pixels of input BMP file.
-		h; // Height in pixels of input BMP file.
-
-	// Initialize imageFile objects.
-	auto *tempStore = new imageFile; // Temporary storage.
-	auto *outRGB = new imageFile; // RGB output file.
-	auto *outRGBA = new imageFile; // RGBA output file.
-
-	// Initialize input stream.
-	std::ifstream inFile(fileName.c_str(), std::ios::binary);
-
-	// Get start point of image data in input BMP file.
-	inFile.seekg(10);
-	inFile.read((char *)&offset, 4);
-
-	// Get image width and height.
-	inFile.seekg(18);
-	inFile.read((char *)&w, 4);
-	inFile.read((char *)&h, 4);
-
-	// Determine the length of padding of the pixel rows 
-	// (each pixel row of a BMP file is 4-byte aligned by padding with zero bytes).
-	int padding = (3 * w) % 4 ? 4 - (3 * w) % 4 : 0;
-
-	// Allocate storage for temporary input file, read in image data from the BMP file, close input stream.
-	tempStore->data = new unsigned char[(3 * w + padding) * h];
-	inFile.seekg(offset);
-	inFile.read((char *)tempStore->data, (3 * w + padding) * h);
-	inFile.close();
-
-	// Set image width and height and allocate storage for image in output RGB file.
-	outRGB->width = w;
-	outRGB->height = h;
-	outRGB->data = new unsigned char[3 * w * h];
-
-	// Copy data from temporary input file to output RGB file adjusting for padding and performing BGR to RGB conversion.
-	int tempStorePos;
-	int outRGBpos;
-	for (int j = 0; j < h; j++)
-		for (int i = 0; i < 3 * w; i += 3)
-		{
-			tempStorePos = (3 * w + padding) * j + i;
-			outRGBpos = 3 * w * j + i;
-			outRGB->data[outRGBpos] = tempStore->data[tempStorePos + 2];
-			outRGB->data[outRGBpos + 1] = tempStore->data[tempStorePos + 1];
-			outRGB->data[outRGBpos + 2] = tempStore->data[tempStorePos];
-		}
-
-	// Set image width and height and allocate storage for image in output RGBA file.
-	outRGBA->width = w;
-	outRGBA->height = h;
-	outRGBA->data = new unsigned char[4 * w * h];
-
-	// Copy image data from output RGB file to output RGBA file, setting all A values to 1.
-	for (int j = 0; j < 4 * w * h; j += 4)
+	for (int i = 0; i < count; i++, in += 3, out += 4)
 	{
-		outRGBA->data[j] = outRGB->data[(j / 4) * 3];
-		outRGBA->data[j + 1] = outRGB->data[(j / 4) * 3 + 1];
-		outRGBA->data[j + 2] = outRGB->data[(j / 4) * 3 + 2];
-		outRGBA->data[j + 3] = 0xFF;
+		out[0] = in[2];
+		out[1] = in[1];
+		out[2] = in[0];
+		out[3] = 0xFF;
 	}
+}
+
+#ifdef CPU_X86
+/**
+ * Convert 4 pixels per step: one 16 byte load holds 4 BGR pixels (12 bytes) and a shuffle spreads
+ * them over 4 RGBA pixels. Reads 4 bytes past the last converted pixel, readable says how many bytes may be read.
+ * @return Number of pixels converted.
+ */
+TARGET_SSSE3 int convertRowSSSE3(const unsigned char *in, unsigned char *out, int count, size_t readable)
+{
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	int i = 0;
+	for (; i + 4 <= count && (size_t)i * 3 + 16 <= readable; i += 4)
+	{
+		__m128i bgr = _mm_loadu_si128((const __m128i *)(in + i * 3));
+		_mm_storeu_si128((__m128i *)(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha));
+	}
+	return i;
+}
+
+/**
+ * Same as convertRowSSSE3 with 8 pixels per step, the 2 halves of a 256 bit register holding 4 pixels each.
+ */
+TARGET_AVX2 int convertRowAVX2(const unsigned char *in, unsigned char *out, int count, size_t readable)
+{
+	const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+	                                         2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	int i = 0;
+	for (; i + 8 <= count && (size_t)i * 3 + 28 <= readable; i += 8)
+	{
+		__m128i low = _mm_loadu_si128((const __m128i *)(in + i * 3));
+		__m128i high = _mm_loadu_si128((const __m128i *)(in + i * 3 + 12));
+		__m256i bgr = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+		_mm256_storeu_si256((__m256i *)(out + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(bgr, shuffle), alpha));
+	}
+	return i;
+}
+#endif
+
+} // namespace
+
+bool mapBMP(const std::string& fileName, bmpView& view)
+{
+	if (!view.file.open(fileName) || view.file.size() < 54) return false;
+	const char *header = view.file.data();
+
+	int offset = readInt32(header + 10), // No. of bytes to start of image data in input BMP file.
+		w = readInt32(header + 18), // Width in pixels of input BMP file.
+		h = readInt32(header + 22); // Height in pixels of input BMP file.
+	int bitsPerPixel = readInt16(header + 28), compression = readInt32(header + 30);
+	if (header[0] != 'B' || header[1] != 'M' || bitsPerPixel != 24 || compression != 0 || w <= 0 || h <= 0)
+		return false;
+
+	// Each pixel row of a BMP file is 4-byte aligned by padding with zero bytes.
+	int rowSize = (3 * w + 3) / 4 * 4;
+	if (offset < 0 || (size_t)offset > view.file.size() || (view.file.size() - offset) / rowSize < (size_t)h)
+		return false;
+
+	view.width = w;
+	view.height = h;
+	view.rowSize = rowSize;
+	view.data = (const unsigned char *)header + offset;
+	return true;
+}
+
+void convertBGRToRGBA(const bmpView& view, unsigned char *out)
+{
+#ifdef CPU_X86
+	SIMDLevel level = activeSIMDLevel();
+	const unsigned char *end = (const unsigned char *)view.file.data() + view.file.size();
+#endif
+	for (int j = 0; j < view.height; j++)
+	{
+		const unsigned char *in = view.data + (size_t)view.rowSize * j;
+		unsigned char *outRow = out + (size_t)view.width * 4 * j;
+		int done = 0;
+#ifdef CPU_X86
+		// the vector loads may run into the row padding and the next row, as long as they stay inside the file
+		if (level >= SIMD_AVX2) done = convertRowAVX2(in, outRow, view.width, (size_t)(end - in));
+		if (level >= SIMD_SSSE3) done += convertRowSSSE3(in + done * 3, outRow + done * 4, view.width - done, (size_t)(end - in) - done * 3);
+#endif
+		convertRowScalar(in + done * 3, outRow + done * 4, view.width - done);
+	}
+}
+
+imageFile *getBMP(const std::string& fileName)
+{
+	bmpView view;
+	if (!mapBMP(fileName, view)) return nullptr;
 
-	// Release temporary storage and the output RGB file and return the RGBA version.
-	delete tempStore;
-	delete outRGB;
+	auto *outRGBA = new imageFile;
+	outRGBA->width = view.width;
+	outRGBA->height = view.height;
+	outRGBA->data = new unsigned char[(size_t)4 * view.width * view.height];
+	convertBGRToRGBA(view, outRGBA->data);
 	return outRGBA;
 }
@@ -0,0 +1,91 @@
+// Portable read-only and copy-on-write file mapping, CreateFileMapping on Windows and mmap everywhere else.
+
+#include "../include/mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& fileName, bool copyOnWrite)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    length = (size_t)fileSize.QuadPart;
+    opened = true;
+    if (length == 0) return true; // a zero sized file cannot be mapped, but it is not an error
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+    begin = (const char *)MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (begin == nullptr) {
+        close();
+        return false;
+    }
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0) {
+        ::close(file);
+        return false;
+    }
+    length = (size_t)fileStat.st_size;
+    opened = true;
+    if (length == 0) {
+        ::close(file);
+        return true; // a zero sized file cannot be mapped, but it is not an error
+    }
+
+    void *mapped = mmap(nullptr, length, PROT_READ | (copyOnWrite ? PROT_WRITE : 0), MAP_PRIVATE, file, 0);
+    ::close(file); // the mapping keeps its own reference to the file
+    if (mapped == MAP_FAILED) {
+        length = 0;
+        opened = false;
+        return false;
+    }
+    if (!copyOnWrite) madvise(mapped, length, MADV_SEQUENTIAL); // a writable mapping is kept and used at random
+    begin = (const char *)mapped;
+#endif
+    writable = copyOnWrite;
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (begin) UnmapViewOfFile(begin);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (begin) munmap((void *)begin, length);
+#endif
+    begin = nullptr;
+    length = 0;
+    opened = false;
+    writable = false;
+}
@@ -0,0 +1,128 @@
+// Arena allocated meshes, see mesh.h.
+
+#include <cstdint>
+#include <utility>
+
+#include "../include/mappedFile.h"
+#include "../include/mesh.h"
+
+namespace {
+
+const size_t streamAlignment = 64;
+
+size_t alignUp(size_t offset)
+{
+    return (offset + streamAlignment - 1) / streamAlignment * streamAlignment;
+}
+
+} // namespace
+
+Mesh::Mesh() = default;
+
+Mesh::~Mesh() = default;
+
+Mesh::Mesh(Mesh&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this == &other) return *this;
+    vertexCount = other.vertexCount;
+    textureCoordinateCount = other.textureCoordinateCount;
+    faceCount = other.faceCount;
+    for (int i = 0; i < 3; i++) center[i] = other.center[i];
+    diagonalLength = other.diagonalLength;
+    positions = other.positions;
+    textureCoordinates = other.textureCoordinates;
+    faces = other.faces;
+    faceNormals = other.faceNormals;
+    vertexNormals = other.vertexNormals;
+    faceAreas = other.faceAreas;
+    arena = std::move(other.arena);
+    mapping = std::move(other.mapping);
+    arenaSize = other.arenaSize;
+    for (int i = 0; i < 3; i++) {
+        attributeBlocks[i] = std::move(other.attributeBlocks[i]);
+        attributeSizes[i] = other.attributeSizes[i];
+        other.attributeSizes[i] = 0;
+    }
+    other.vertexCount = other.textureCoordinateCount = other.faceCount = other.arenaSize = 0;
+    other.positions = other.textureCoordinates = other.faceNormals = other.vertexNormals = other.faceAreas = nullptr;
+    other.faces = nullptr;
+    return *this;
+}
+
+void Mesh::allocate(size_t vertices, size_t textureCoordinatePairs, size_t triangles)
+{
+    releaseAttributes(MESH_ALL_ATTRIBUTES);
+
+    // offsets of the streams from an aligned base, in the order listed in mesh.h
+    size_t sizes[3] = {vertices * 3 * sizeof(float), textureCoordinatePairs * 2 * sizeof(float), triangles * 3 * sizeof(int)};
+    size_t offsets[3], total = 0;
+    for (int i = 0; i < 3; i++) {
+        offsets[i] = total;
+        total = alignUp(total + sizes[i]);
+    }
+
+    arenaSize = total + streamAlignment - 1;
+    mapping.reset();
+    arena.reset(new unsigned char[arenaSize]);
+    auto base = (unsigned char *)alignUp((size_t)(uintptr_t)arena.get());
+    positions = (float *)(base + offsets[0]);
+    textureCoordinates = (float *)(base + offsets[1]);
+    faces = (int *)(base + offsets[2]);
+    vertexCount = vertices;
+    textureCoordinateCount = textureCoordinatePairs;
+    faceCount = triangles;
+}
+
+char *Mesh::adoptMapping(std::unique_ptr<MappedFile> file)
+{
+    releaseAttributes(MESH_ALL_ATTRIBUTES);
+    arena.reset();
+    mapping = std::move(file);
+    arenaSize = mapping->size();
+    positions = textureCoordinates = nullptr;
+    faces = nullptr;
+    vertexCount = textureCoordinateCount = faceCount = 0;
+    return mapping->writableData();
+}
+
+float *&Mesh::attributePointer(int index)
+{
+    return index == 0 ? faceNormals : index == 1 ? vertexNormals : faceAreas;
+}
+
+float *Mesh::allocateAttribute(MeshAttribute attribute)
+{
+    int index = attribute == MESH_FACE_NORMALS ? 0 : attribute == MESH_VERTEX_NORMALS ? 1 : 2;
+    float *&pointer = attributePointer(index);
+    if (pointer) return pointer;
+    size_t floats = index == 0 ? faceCount * 3 : index == 1 ? vertexCount * 3 : faceCount;
+    attributeSizes[index] = floats * sizeof(float) + streamAlignment - 1;
+    attributeBlocks[index].reset(new unsigned char[attributeSizes[index]]);
+    pointer = (float *)alignUp((size_t)(uintptr_t)attributeBlocks[index].get());
+    return pointer;
+}
+
+void Mesh::releaseAttributes(unsigned int attributes)
+{
+    for (int i = 0; i < 3; i++)
+        if (attributes & (1u << i)) {
+            attributeBlocks[i].reset();
+            attributeSizes[i] = 0;
+            attributePointer(i) = nullptr;
+        }
+}
+
+unsigned int Mesh::attributes() const
+{
+    return (faceNormals ? MESH_FACE_NORMALS : 0) | (vertexNormals ? MESH_VERTEX_NORMALS : 0) | (faceAreas ? MESH_FACE_AREAS : 0);
+}
+
+size_t Mesh::attributeBytes() const
+{
+    return attributeSizes[0] + attributeSizes[1] + attributeSizes[2];
+}
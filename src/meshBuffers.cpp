@@ -0,0 +1,178 @@
+// Meshes in vertex and index buffers, see meshBuffers.h.
+
+#include <cstring>
+
+#include "../include/meshBuffers.h"
+#include "../include/meshProcessing.h"
+
+using namespace std;
+
+namespace {
+
+// Copy the indices to the width of the index buffer.
+template <typename Index>
+void copyIndices(const vector<unsigned int>& indices, vector<unsigned char>& bytes)
+{
+    bytes.resize(indices.size() * sizeof(Index));
+    auto *out = (Index *)bytes.data();
+    for (size_t i = 0; i < indices.size(); i++) out[i] = (Index)indices[i];
+}
+
+// Interleave the vertices of the buffer, specialized on the shading and texture like the loops of meshEmission.h.
+// source holds the mesh vertex of each buffer vertex, provokedFace the face whose normal it carries in flat shading.
+template <bool FlatShaded, bool Textured>
+void interleaveVertices(const Mesh& mesh, const float *normals, const vector<unsigned int>& source,
+                        const vector<int>& provokedFace, float *out)
+{
+    const float *positions = mesh.positions, *textureCoordinates = mesh.textureCoordinates;
+    size_t textureCoordinateCount = mesh.textureCoordinateCount;
+    for (size_t i = 0; i < source.size(); i++, out += Textured ? 8 : 6) {
+        size_t vertex = source[i];
+        memcpy(out, positions + vertex * 3, 3 * sizeof(float));
+        // a vertex that provokes no face in flat shading is never lit, its normal is left zero
+        if (!FlatShaded) memcpy(out + 3, normals + vertex * 3, 3 * sizeof(float));
+        else if (provokedFace[i] >= 0) memcpy(out + 3, normals + (size_t)provokedFace[i] * 3, 3 * sizeof(float));
+        else out[3] = out[4] = out[5] = 0.0f;
+        if (Textured) {
+            out[6] = vertex < textureCoordinateCount ? textureCoordinates[vertex * 2] : 0.0f;
+            out[7] = vertex < textureCoordinateCount ? textureCoordinates[vertex * 2 + 1] : 0.0f;
+        }
+    }
+}
+
+} // namespace
+
+bool MeshBuffers::create(Mesh& mesh, bool flatShaded)
+{
+    destroy();
+    if (!GLEW_VERSION_3_0) return false;
+
+    const float *normals = flatShaded ? requireFaceNormals(mesh) : requireVertexNormals(mesh);
+    const int *faces = mesh.faces;
+    bool hasTexture = mesh.hasTextureCoordinates();
+    size_t components = hasTexture ? 8 : 6;
+
+    // the vertices of the buffer: the mesh's own, then the copies made to provoke a face in flat shading
+    vector<unsigned int> source(mesh.vertexCount), indices(faces, faces + mesh.faceCount * 3);
+    for (size_t i = 0; i < source.size(); i++) source[i] = (unsigned int)i;
+    vector<int> provokedFace;
+    if (flatShaded) {
+        // each face ends on a vertex that provokes no other face, its winding kept by rotating its corners
+        provokedFace.assign(mesh.vertexCount, -1);
+        for (size_t face = 0; face < mesh.faceCount; face++) {
+            unsigned int *corners = indices.data() + face * 3;
+            int provoking = -1;
+            for (int corner = 2; corner >= 0 && provoking < 0; corner--)
+                if (provokedFace[corners[corner]] < 0) provoking = corner;
+            if (provoking < 0) {
+                provoking = 2;
+                source.push_back(source[corners[2]]);
+                provokedFace.push_back(-1);
+                corners[2] = (unsigned int)(source.size() - 1);
+            }
+            if (provoking == 0) {
+                unsigned int first = corners[0];
+                corners[0] = corners[1];
+                corners[1] = corners[2];
+                corners[2] = first;
+            }
+            else if (provoking == 1) {
+                unsigned int last = corners[2];
+                corners[2] = corners[1];
+                corners[1] = corners[0];
+                corners[0] = last;
+            }
+            provokedFace[corners[2]] = (int)face;
+        }
+    }
+
+    vector<float> vertexData(source.size() * components);
+    if (flatShaded) {
+        if (hasTexture) interleaveVertices<true, true>(mesh, normals, source, provokedFace, vertexData.data());
+        else interleaveVertices<true, false>(mesh, normals, source, provokedFace, vertexData.data());
+    }
+    else {
+        if (hasTexture) interleaveVertices<false, true>(mesh, normals, source, provokedFace, vertexData.data());
+        else interleaveVertices<false, false>(mesh, normals, source, provokedFace, vertexData.data());
+    }
+
+    vector<unsigned char> indexData;
+    if (source.size() <= 65536) {
+        indexType = GL_UNSIGNED_SHORT;
+        indexSize = 2;
+        copyIndices<GLushort>(indices, indexData);
+    }
+    else {
+        indexType = GL_UNSIGNED_INT;
+        indexSize = 4;
+        copyIndices<GLuint>(indices, indexData);
+    }
+
+    // the vertex array records the fixed function arrays and the index buffer
+    GLsizei stride = (GLsizei)(components * sizeof(float));
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexData.size() * sizeof(float)), vertexData.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexData.size(), indexData.data(), GL_STATIC_DRAW);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, (const void *)0);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, stride, (const void *)(3 * sizeof(float)));
+    if (hasTexture) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, (const void *)(6 * sizeof(float)));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    vertices = source.size();
+    indexCount = indices.size();
+    bufferBytes = vertexData.size() * sizeof(float) + indexData.size();
+    flat = flatShaded;
+    withTextureCoordinates = hasTexture;
+    return true;
+}
+
+void MeshBuffers::destroy()
+{
+    if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+    if (vertexBuffer) glDeleteBuffers(1, &vertexBuffer);
+    if (indexBuffer) glDeleteBuffers(1, &indexBuffer);
+    vertexArray = vertexBuffer = indexBuffer = 0;
+    vertices = indexCount = bufferBytes = 0;
+    flat = withTextureCoordinates = false;
+}
+
+void MeshBuffers::draw(const vector<pair<size_t, size_t>>& faceRanges)
+{
+    if (!vertexArray || faceRanges.empty()) return;
+    glBindVertexArray(vertexArray);
+    if (faceRanges.size() == 1) {
+        glDrawElements(GL_TRIANGLES, (GLsizei)(faceRanges[0].second * 3), indexType,
+                       (const void *)(faceRanges[0].first * 3 * indexSize));
+    }
+    else {
+        counts.resize(faceRanges.size());
+        offsets.resize(faceRanges.size());
+        for (size_t i = 0; i < faceRanges.size(); i++) {
+            counts[i] = (GLsizei)(faceRanges[i].second * 3);
+            offsets[i] = (const void *)(faceRanges[i].first * 3 * indexSize);
+        }
+        glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, offsets.data(), (GLsizei)faceRanges.size());
+    }
+    glBindVertexArray(0);
+}
+
+void MeshBuffers::drawInstanced(size_t instanceCount, const function<void()>& bindInstances)
+{
+    if (!vertexArray || instanceCount == 0) return;
+    glBindVertexArray(vertexArray);
+    bindInstances();
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indexCount, indexType, nullptr, (GLsizei)instanceCount);
+    glBindVertexArray(0);
+}
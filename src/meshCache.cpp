@@ -0,0 +1,154 @@
+// Binary cache files of processed models, see meshCache.h for the format.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "../include/mappedFile.h"
+#include "../include/meshCache.h"
+#include "../include/sourceKey.h"
+
+namespace {
+
+const char meshCacheMagic[8] = {'O', 'G', 'A', 'M', 'E', 'S', 'H', '\0'};
+
+// One array stored in a cache file.
+struct MeshCacheArray
+{
+    uint64_t offset; // from the start of the file, 64 byte aligned like the streams of a Mesh
+    uint64_t count; // number of elements (floats or ints)
+};
+
+enum {
+    ARRAY_VERTICES, ARRAY_FACES, ARRAY_TEXTURE_COORDINATES, ARRAY_FACE_NORMALS, ARRAY_VERTEX_NORMALS, ARRAY_FACE_AREAS,
+    ARRAY_NUMBERS
+};
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // 0x01020304 written natively, a cache from a machine of other endianness is rejected
+    SourceKey source;
+    float center[3];
+    float diagonalLength;
+    MeshCacheArray arrays[ARRAY_NUMBERS];
+};
+
+// Check that an array of count elements of 4 bytes lies within the file.
+bool checkArray(const MappedFile& file, const MeshCacheArray& array, uint64_t count)
+{
+    return array.offset % 64 == 0 && array.offset <= file.size() && array.count == count &&
+           array.count <= (file.size() - array.offset) / 4;
+}
+
+// Map a cache file and check that it is a valid cache of the source file.
+bool openMeshCache(const std::string& cacheFileName, const std::string& sourceFileName,
+                   MappedFile& file, MeshCacheHeader& header, bool copyOnWrite = false)
+{
+    if (!file.open(cacheFileName, copyOnWrite) || file.size() < sizeof(MeshCacheHeader)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    return memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) == 0 && header.version == MESH_CACHE_VERSION &&
+           header.byteOrder == 0x01020304u && sourceKeyMatches(header.source, sourceFileName);
+}
+
+} // namespace
+
+std::string meshCacheFileName(const std::string& sourceFileName)
+{
+    size_t slash = sourceFileName.find_last_of("/\\");
+    return (slash == std::string::npos ? sourceFileName : sourceFileName.substr(slash + 1)) + ".meshcache";
+}
+
+bool isMeshCacheCurrent(const std::string& cacheFileName, const std::string& sourceFileName)
+{
+    MappedFile file;
+    MeshCacheHeader header;
+    return openMeshCache(cacheFileName, sourceFileName, file, header);
+}
+
+bool readMeshCache(const std::string& cacheFileName, const std::string& sourceFileName, Mesh& mesh)
+{
+    std::unique_ptr<MappedFile> mapping(new MappedFile);
+    MappedFile& file = *mapping;
+    MeshCacheHeader header;
+    if (!openMeshCache(cacheFileName, sourceFileName, file, header, true)) return false;
+
+    // the vertex and face counts follow from the positions and faces, every other array must match them;
+    // attributes that were not computed when the cache was written are stored empty
+    const MeshCacheArray *arrays = header.arrays;
+    uint64_t vertexCount = arrays[ARRAY_VERTICES].count / 3, faceCount = arrays[ARRAY_FACES].count / 3;
+    uint64_t textureCoordinateCount = arrays[ARRAY_TEXTURE_COORDINATES].count / 2;
+    uint64_t counts[ARRAY_NUMBERS] = {
+        vertexCount * 3, faceCount * 3, textureCoordinateCount * 2, faceCount * 3, vertexCount * 3, faceCount
+    };
+    for (int i = 0; i < ARRAY_NUMBERS; i++) {
+        if (i >= ARRAY_FACE_NORMALS && arrays[i].count == 0) counts[i] = 0;
+        if (!checkArray(file, arrays[i], counts[i])) return false;
+    }
+
+    // the mesh borrows the arrays where they lie in the mapping, and the pages it writes to are copied
+    Mesh loaded;
+    char *base = loaded.adoptMapping(std::move(mapping));
+    loaded.vertexCount = (size_t)vertexCount;
+    loaded.textureCoordinateCount = (size_t)textureCoordinateCount;
+    loaded.faceCount = (size_t)faceCount;
+    loaded.positions = (float *)(base + arrays[ARRAY_VERTICES].offset);
+    loaded.faces = (int *)(base + arrays[ARRAY_FACES].offset);
+    loaded.textureCoordinates = (float *)(base + arrays[ARRAY_TEXTURE_COORDINATES].offset);
+    float **attributes[3] = {&loaded.faceNormals, &loaded.vertexNormals, &loaded.faceAreas};
+    for (int i = ARRAY_FACE_NORMALS; i < ARRAY_NUMBERS; i++)
+        if (counts[i]) *attributes[i - ARRAY_FACE_NORMALS] = (float *)(base + arrays[i].offset);
+    memcpy(loaded.center, header.center, sizeof(header.center));
+    loaded.diagonalLength = header.diagonalLength;
+    mesh = std::move(loaded);
+    return true;
+}
+
+bool writeMeshCache(const std::string& cacheFileName, const std::string& sourceFileName, const Mesh& mesh)
+{
+    MeshCacheHeader header = {};
+    memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version = MESH_CACHE_VERSION;
+    header.byteOrder = 0x01020304u;
+    if (!makeSourceKey(sourceFileName, header.source)) return false;
+    memcpy(header.center, mesh.center, sizeof(header.center));
+    header.diagonalLength = mesh.diagonalLength;
+
+    const void *arrayData[ARRAY_NUMBERS] = {
+        mesh.positions, mesh.faces, mesh.textureCoordinates, mesh.faceNormals, mesh.vertexNormals, mesh.faceAreas
+    };
+    size_t arrayCounts[ARRAY_NUMBERS] = {
+        mesh.vertexCount * 3, mesh.faceCount * 3, mesh.textureCoordinateCount * 2, mesh.faceNormals ? mesh.faceCount * 3 : 0,
+        mesh.vertexNormals ? mesh.vertexCount * 3 : 0, mesh.faceAreas ? mesh.faceCount : 0
+    };
+    uint64_t offset = (sizeof(header) + 63) / 64 * 64;
+    for (int i = 0; i < ARRAY_NUMBERS; i++) {
+        header.arrays[i].offset = offset;
+        header.arrays[i].count = arrayCounts[i];
+        offset = (offset + arrayCounts[i] * 4 + 63) / 64 * 64; // floats and ints are both 4 bytes
+    }
+
+    std::string temporaryFileName = cacheFileName + ".tmp";
+    FILE *file = fopen(temporaryFileName.c_str(), "wb");
+    if (!file) return false;
+    const char padding[64] = {};
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t position = sizeof(header);
+    for (int i = 0; i < ARRAY_NUMBERS && written; i++) {
+        auto paddingSize = (size_t)(header.arrays[i].offset - position);
+        written = fwrite(padding, 1, paddingSize, file) == paddingSize &&
+                  fwrite(arrayData[i], 4, arrayCounts[i], file) == arrayCounts[i];
+        position = header.arrays[i].offset + arrayCounts[i] * 4;
+    }
+    written = fclose(file) == 0 && written;
+
+    remove(cacheFileName.c_str()); // rename does not replace an existing file on Windows
+    if (!written || rename(temporaryFileName.c_str(), cacheFileName.c_str()) != 0) {
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
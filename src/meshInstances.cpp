@@ -0,0 +1,343 @@
+// Instanced drawing of meshes and its CPU fallback, see meshInstances.h.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "../include/meshEmission.h"
+#include "../include/meshInstances.h"
+#include "../include/meshProcessing.h"
+
+using namespace std;
+
+namespace {
+
+const float degrees = 3.14159265f / 180.0f;
+
+// out = a * b, column-major 4x4 matrices.
+void multiply(const float *a, const float *b, float *out)
+{
+    float product[16];
+    for (int column = 0; column < 4; column++)
+        for (int row = 0; row < 4; row++) {
+            product[column * 4 + row] = 0.0f;
+            for (int k = 0; k < 4; k++) product[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+        }
+    memcpy(out, product, sizeof(product));
+}
+
+// The matrix of glRotatef(angle, ...) about axis 0, 1 or 2.
+void rotation(float angle, int axis, float *out)
+{
+    float c = cosf(angle * degrees), s = sinf(angle * degrees);
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    for (int i = 0; i < 16; i++) out[i] = i % 5 == 0 ? 1.0f : 0.0f;
+    out[u * 4 + u] = c;
+    out[u * 4 + v] = s;
+    out[v * 4 + u] = -s;
+    out[v * 4 + v] = c;
+}
+
+// Transforms the vertices in model space and lights each fragment like the fixed function pipeline, see
+// InstancedMeshRenderer. The instance attributes are bound to locations 1 to 5, 0 being gl_Vertex.
+const char *vertexShaderSource = R"(#version 150 compatibility
+in vec4 instanceColumn0;
+in vec4 instanceColumn1;
+in vec4 instanceColumn2;
+in vec4 instanceColumn3;
+in vec4 instanceColor; // rgb, then 1 for flat shading
+out vec3 eyePosition;
+out vec3 eyeNormal;
+out vec2 textureCoordinate;
+out vec4 color;
+
+void main()
+{
+    mat4 model = gl_ModelViewMatrix * mat4(instanceColumn0, instanceColumn1, instanceColumn2, instanceColumn3);
+    vec4 position = model * gl_Vertex;
+    eyePosition = position.xyz / position.w;
+    eyeNormal = mat3(model) * gl_Normal;
+    textureCoordinate = gl_MultiTexCoord0.st;
+    color = instanceColor;
+    gl_Position = gl_ProjectionMatrix * position;
+}
+)";
+
+const char *fragmentShaderSource = R"(#version 150 compatibility
+uniform bool textured;
+uniform sampler2D image;
+in vec3 eyePosition;
+in vec3 eyeNormal;
+in vec2 textureCoordinate;
+in vec4 color;
+
+void main()
+{
+    // the face normal points out of the mesh like the vertex normals; two-sided lighting lights the back of a face
+    // with the reversed normal
+    vec3 normal = eyeNormal;
+    if (color.a > 0.5) {
+        vec3 faceNormal = cross(dFdx(eyePosition), dFdy(eyePosition));
+        normal = dot(faceNormal, eyeNormal) < 0.0 ? -faceNormal : faceNormal;
+    }
+    normal = normalize(gl_FrontFacing ? normal : -normal);
+    vec3 toViewer = normalize(-eyePosition); // a local viewer at the origin of eye coordinates
+
+    vec4 lightPosition = gl_LightSource[0].position;
+    vec3 toLight = lightPosition.xyz - eyePosition * lightPosition.w;
+    float distance = length(toLight), attenuation = 1.0;
+    if (distance > 0.0) toLight /= distance;
+    if (lightPosition.w != 0.0)
+        attenuation = 1.0 / (gl_LightSource[0].constantAttenuation + gl_LightSource[0].linearAttenuation * distance +
+                             gl_LightSource[0].quadraticAttenuation * distance * distance);
+    float diffuse = max(dot(normal, toLight), 0.0);
+    float specular = diffuse > 0.0 ? pow(max(dot(normal, normalize(toLight + toViewer)), 0.0), gl_FrontMaterial.shininess) : 0.0;
+
+    vec3 primary = gl_FrontMaterial.emission.rgb + color.rgb * gl_LightModel.ambient.rgb +
+                   attenuation * color.rgb * (gl_LightSource[0].ambient.rgb + diffuse * gl_LightSource[0].diffuse.rgb);
+    vec3 secondary = attenuation * specular * gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb;
+    vec4 texel = textured ? texture(image, textureCoordinate) : vec4(1.0);
+    gl_FragColor = vec4(clamp(primary, 0.0, 1.0) * texel.rgb + secondary, texel.a);
+}
+)";
+
+// Compile a shader, printing its log if it fails. Returns 0 then.
+GLuint compileShader(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024] = "";
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        cerr << "Instancing shader does not compile: " << log << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// A sink of emitMeshTriangles() writing the corners of an instance, transformed, into the stream of a batch.
+struct InstanceStreamSink
+{
+    const float *positions, *normals, *textureCoordinates;
+    const MeshInstance *instance;
+    float *out;
+    float normal[3];
+
+    void transformNormal(const float *n)
+    {
+        const float *m = instance->transform;
+        for (int row = 0; row < 3; row++) normal[row] = m[row] * n[0] + m[4 + row] * n[1] + m[8 + row] * n[2];
+    }
+    void faceNormal(size_t face) { transformNormal(normals + face * 3); }
+    void vertexNormal(size_t vertex) { transformNormal(normals + vertex * 3); }
+    void textureCoordinate(size_t vertex)
+    {
+        out[0] = textureCoordinates[vertex * 2];
+        out[1] = textureCoordinates[vertex * 2 + 1];
+        out += 2;
+    }
+    void vertex(size_t vertex)
+    {
+        const float *m = instance->transform, *p = positions + vertex * 3;
+        memcpy(out, instance->color, 3 * sizeof(float));
+        memcpy(out + 3, normal, 3 * sizeof(float));
+        for (int row = 0; row < 3; row++) out[6 + row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+        out += 9;
+    }
+};
+
+} // namespace
+
+void setInstanceTransform(const float *translate, float scale, const float *angles, float *transform)
+{
+    for (int i = 0; i < 16; i++) transform[i] = i % 5 == 0 ? 1.0f : 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float turn[16];
+        rotation(angles[axis], axis, turn);
+        multiply(transform, turn, transform);
+    }
+    for (int i = 0; i < 12; i++) transform[i] *= scale;
+    for (int axis = 0; axis < 3; axis++) transform[12 + axis] = translate[axis];
+}
+
+void scatterInstances(const vector<ScatteredModel>& models, size_t count, float fieldSize, unsigned int seed,
+                      vector<vector<MeshInstance>>& instancesOf)
+{
+    instancesOf.assign(models.size(), vector<MeshInstance>());
+    if (models.empty()) return;
+    mt19937 random(seed);
+    uniform_real_distribution<float> spot(-0.5f * fieldSize, 0.5f * fieldSize), angle(0.0f, 360.0f), shade(2.0f / 3.0f, 1.0f);
+    uniform_int_distribution<size_t> pick(0, models.size() - 1);
+    for (size_t copy = 0; copy < count; copy++) {
+        size_t model = pick(random);
+        const ScatteredModel& scattered = models[model];
+        MeshInstance instance;
+        float origin[3] = {0.0f, 0.0f, 0.0f}, turn[16];
+        setInstanceTransform(origin, scattered.scale, scattered.rotation, instance.transform);
+        rotation(angle(random), 1, turn);
+        multiply(turn, instance.transform, instance.transform);
+        instance.transform[12] = spot(random);
+        instance.transform[13] = scattered.height;
+        instance.transform[14] = spot(random);
+        float brightness = shade(random);
+        for (int i = 0; i < 3; i++) instance.color[i] = scattered.color[i] * brightness;
+        instance.flatShaded = scattered.flatShaded ? 1.0f : 0.0f;
+        instancesOf[model].push_back(instance);
+    }
+}
+
+size_t sortInstancesByLod(const vector<MeshInstance>& instances, const vector<MeshLod>& lods, float radius,
+                          const MeshletView& view, float fieldOfView, int height, float threshold,
+                          vector<vector<MeshInstance>>& levels)
+{
+    levels.resize(lods.size() + 1);
+    for (auto& level : levels) level.clear();
+    size_t kept = 0;
+    for (const MeshInstance& instance : instances) {
+        const float *m = instance.transform, *center = m + 12;
+        float scale = sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]), sphere = radius * scale;
+        bool inside = true;
+        for (const float *plane : view.planes)
+            inside = inside && plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] >= -sphere;
+        if (!inside) continue;
+        float dx = view.camera[0] - center[0], dy = view.camera[1] - center[1], dz = view.camera[2] - center[2];
+        float distance = max(sqrtf(dx * dx + dy * dy + dz * dz) - sphere, 0.01f);
+        int level = selectMeshLod(lods, lodPixelsPerUnit(scale, distance, fieldOfView, height), threshold, 0);
+        levels[level].push_back(instance);
+        kept++;
+    }
+    return kept;
+}
+
+bool InstancedMeshRenderer::create()
+{
+    destroy();
+    if (!GLEW_VERSION_3_3) return false;
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShader && fragmentShader) {
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        const char *attributes[] = {"instanceColumn0", "instanceColumn1", "instanceColumn2", "instanceColumn3", "instanceColor"};
+        for (GLuint i = 0; i < 5; i++) glBindAttribLocation(program, i + 1, attributes[i]);
+        glLinkProgram(program);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            char log[1024] = "";
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            cerr << "Instancing shaders do not link: " << log << endl;
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    if (vertexShader) glDeleteShader(vertexShader);
+    if (fragmentShader) glDeleteShader(fragmentShader);
+    if (!program) return false;
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "image"), 0);
+    texturedLocation = glGetUniformLocation(program, "textured");
+    glUseProgram(0);
+    glGenBuffers(1, &instanceBuffer);
+    return true;
+}
+
+void InstancedMeshRenderer::destroy()
+{
+    if (program) glDeleteProgram(program);
+    if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer);
+    program = instanceBuffer = 0;
+    texturedLocation = -1;
+}
+
+void InstancedMeshRenderer::draw(MeshBuffers& buffers, const vector<MeshInstance>& instances)
+{
+    if (!program || instances.empty()) return;
+    glUseProgram(program);
+    glUniform1i(texturedLocation, buffers.textured() && glIsEnabled(GL_TEXTURE_2D) ? 1 : 0);
+    // a new store for each draw, so the GL need not wait for the draws still reading the last one
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(instances.size() * sizeof(MeshInstance)), instances.data(), GL_STREAM_DRAW);
+    buffers.drawInstanced(instances.size(), [&] {
+        for (GLuint i = 0; i < 5; i++) {
+            glEnableVertexAttribArray(i + 1);
+            glVertexAttribPointer(i + 1, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance), (const void *)(i * 4 * sizeof(float)));
+            glVertexAttribDivisor(i + 1, 1);
+        }
+    });
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
+
+void InstanceBatcher::draw(Mesh& mesh, const vector<MeshInstance>& instances)
+{
+    if (instances.empty() || mesh.faceCount == 0) return;
+    bool textured = mesh.hasTextureCoordinates(), anyFlat = false, anySmooth = false;
+    for (const MeshInstance& instance : instances) {
+        anyFlat = anyFlat || instance.flatShaded > 0.5f;
+        anySmooth = anySmooth || instance.flatShaded <= 0.5f;
+    }
+    const float *faceNormals = anyFlat ? requireFaceNormals(mesh) : nullptr;
+    const float *vertexNormals = anySmooth ? requireVertexNormals(mesh) : nullptr;
+
+    size_t stride = textured ? 11 : 9, instanceCorners = mesh.faceCount * 3;
+    size_t capacity = max(batchCorners, instanceCorners);
+    stream.resize(capacity * stride);
+    allFaces.assign(1, make_pair((size_t)0, mesh.faceCount));
+
+    const float *data = stream.data() + (textured ? 2 : 0);
+    GLsizei bytes = (GLsizei)(stride * sizeof(float));
+    GLboolean texturing = glIsEnabled(GL_TEXTURE_2D);
+    if (!textured && texturing) glDisable(GL_TEXTURE_2D);
+    glEnable(GL_NORMALIZE);
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    glShadeModel(GL_SMOOTH);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glColorPointer(3, GL_FLOAT, bytes, data);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, bytes, data + 3);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, bytes, data + 6);
+    if (textured) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, bytes, stream.data());
+    }
+
+    size_t corners = 0;
+    for (const MeshInstance& instance : instances) {
+        if (corners + instanceCorners > capacity) {
+            flush(corners);
+            corners = 0;
+        }
+        bool flat = instance.flatShaded > 0.5f;
+        InstanceStreamSink sink = {mesh.positions, flat ? faceNormals : vertexNormals, mesh.textureCoordinates,
+                                   &instance, stream.data() + corners * stride, {0.0f, 0.0f, 0.0f}};
+        emitMeshTriangles(flat, textured, mesh.faces, allFaces, sink);
+        corners += instanceCorners;
+    }
+    flush(corners);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_COLOR_MATERIAL);
+    if (!textured && texturing) glEnable(GL_TEXTURE_2D);
+}
+
+void InstanceBatcher::flush(size_t corners)
+{
+    if (corners == 0) return;
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)corners);
+    batches++;
+}
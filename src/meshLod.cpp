@@ -0,0 +1,411 @@
+// Levels of detail, see meshLod.h.
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "../include/meshLod.h"
+#include "../include/meshProcessing.h"
+
+using namespace std;
+
+namespace {
+
+// Weight of the plane of a border or seam edge, per squared edge length, against the face planes weighted by area.
+const double borderWeight = 10.0;
+
+// A collapse is skipped if it turns a face's normal further than this cosine (about 75 degrees).
+const double flipCosine = 0.25;
+
+// Area weighted planes: the sum of w (n . p + d)^2 as the symmetric matrix w n n^T, the vector w d n, w d^2 and
+// the sum of the weights.
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0, weight = 0.0;
+
+    void addPlane(const double *n, double d, double w)
+    {
+        a00 += w * n[0] * n[0]; a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2];
+        a11 += w * n[1] * n[1]; a12 += w * n[1] * n[2]; a22 += w * n[2] * n[2];
+        b0 += w * d * n[0]; b1 += w * d * n[1]; b2 += w * d * n[2];
+        c += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+        weight += q.weight;
+    }
+
+    // weighted sum of the squared distances of a point to the planes
+    double sum(const float *p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        return a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+               2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    }
+};
+
+// Mean squared distance of a point to the planes of two quadrics merged.
+double mergedError(const Quadric& a, const Quadric& b, const float *p)
+{
+    double weight = a.weight + b.weight;
+    return weight > 0.0 ? fabs(a.sum(p) + b.sum(p)) / weight : 0.0;
+}
+
+// Moving the vertices of one group onto those of another, the cheaper way of an edge, ordered by error.
+struct Collapse
+{
+    double error, reverseError; // the other way
+    int from, to;
+
+    bool operator<(const Collapse& other) const
+    {
+        if (error != other.error) return error < other.error;
+        return from != other.from ? from < other.from : to < other.to;
+    }
+};
+
+// The state of simplifyMesh(). Vertices at one position (the copies along a texture seam) form a group, which
+// collapses as a whole; the faces of each vertex and the border edges around it are rebuilt each pass. Collapses
+// rewrite the faces in place, so the faces of a vertex stay right during a pass, apart from those that died.
+struct Simplifier
+{
+    const float *positions;
+    vector<int> groupOf, firstWedge, wedges; // the group of each vertex, and the vertices of each group
+    vector<Quadric> quadrics; // per group
+    vector<int> faces;
+    vector<char> faceDead;
+    size_t liveFaces = 0;
+    vector<int> firstFace, vertexFaces; // live faces of each vertex in compressed sparse rows
+    vector<pair<int, int>> edges; // each edge once, smaller vertex first
+    vector<int> around; // scratch for buildPass()
+    vector<unsigned char> borderEdges; // border edges at each vertex, a seam being a border on both of its sides
+    vector<unsigned int> aroundTarget, oppositeEdge; // == stamp for groups around the target / opposite the edge
+    unsigned int stamp = 0;
+    vector<pair<int, int>> moves; // {vertex, vertex it moves onto} of the collapse last checked
+
+    bool sharesGroup(int face, int group) const
+    {
+        for (int corner = 0; corner < 3; corner++)
+            if (groupOf[faces[face * 3 + corner]] == group) return true;
+        return false;
+    }
+
+    int facesWith(int vertex, int other) const
+    {
+        int count = 0;
+        for (int k = firstFace[vertex]; k < firstFace[vertex + 1]; k++) {
+            const int *face = faces.data() + vertexFaces[k] * 3;
+            if (!faceDead[vertexFaces[k]] && (face[0] == other || face[1] == other || face[2] == other)) count++;
+        }
+        return count;
+    }
+
+    void buildPass();
+    bool canCollapse(int from, int to);
+    void collapse(int from, int to, vector<char>& locked);
+};
+
+void Simplifier::buildPass()
+{
+    size_t vertexCount = groupOf.size();
+    firstFace.assign(vertexCount + 1, 0);
+    for (int vertex : faces) firstFace[vertex + 1]++;
+    for (size_t i = 0; i < vertexCount; i++) firstFace[i + 1] += firstFace[i];
+    vertexFaces.resize(faces.size());
+    vector<int> next(firstFace.begin(), firstFace.end() - 1);
+    for (size_t i = 0; i < faces.size(); i++) vertexFaces[next[faces[i]]++] = (int)(i / 3);
+
+    // the edges of each vertex from its faces: an edge of a single face is a border
+    borderEdges.assign(vertexCount, 0);
+    edges.clear();
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        around.clear();
+        for (int k = firstFace[vertex]; k < firstFace[vertex + 1]; k++)
+            for (int corner = 0; corner < 3; corner++)
+                if (faces[vertexFaces[k] * 3 + corner] != (int)vertex) around.push_back(faces[vertexFaces[k] * 3 + corner]);
+        sort(around.begin(), around.end());
+        for (size_t i = 0; i < around.size();) {
+            size_t end = i + 1;
+            while (end < around.size() && around[end] == around[i]) end++;
+            if (end - i == 1) borderEdges[vertex] = (unsigned char)min(255, borderEdges[vertex] + 1);
+            if (around[i] > (int)vertex) edges.emplace_back((int)vertex, around[i]);
+            i = end;
+        }
+    }
+}
+
+bool Simplifier::canCollapse(int from, int to)
+{
+    moves.clear();
+    stamp++;
+    for (int w = firstWedge[to]; w < firstWedge[to + 1]; w++)
+        for (int k = firstFace[wedges[w]]; k < firstFace[wedges[w] + 1]; k++)
+            if (!faceDead[vertexFaces[k]])
+                for (int corner = 0; corner < 3; corner++) aroundTarget[groupOf[faces[vertexFaces[k] * 3 + corner]]] = stamp;
+
+    // each vertex of the group moves onto a vertex of the target it shares a face with, so along a seam on both
+    // sides, and along the border if it is on one; a vertex where borders meet stays
+    for (int w = firstWedge[from]; w < firstWedge[from + 1]; w++) {
+        int vertex = wedges[w], partner = -1;
+        if (firstFace[vertex] == firstFace[vertex + 1]) continue;
+        if (borderEdges[vertex] != 0 && borderEdges[vertex] != 2) return false;
+        for (int k = firstFace[vertex]; k < firstFace[vertex + 1]; k++) {
+            const int *face = faces.data() + vertexFaces[k] * 3;
+            if (faceDead[vertexFaces[k]] || !sharesGroup(vertexFaces[k], to)) continue;
+            for (int corner = 0; corner < 3; corner++) {
+                int group = groupOf[face[corner]];
+                if (group == to && partner < 0) partner = face[corner];
+                else if (group != to && group != from) oppositeEdge[group] = stamp;
+            }
+        }
+        if (partner < 0 || (borderEdges[vertex] && facesWith(vertex, partner) != 1)) return false;
+        moves.emplace_back(vertex, partner);
+    }
+    if (moves.empty()) return false;
+
+    for (const auto& move : moves)
+        for (int k = firstFace[move.first]; k < firstFace[move.first + 1]; k++) {
+            int face = vertexFaces[k];
+            const int *corners = faces.data() + face * 3;
+            if (faceDead[face]) continue;
+            for (int corner = 0; corner < 3; corner++) {
+                // a neighbour of both ends that is not opposite the edge would be pinched into a non-manifold edge
+                int group = groupOf[corners[corner]];
+                if (group != from && group != to && aroundTarget[group] == stamp && oppositeEdge[group] != stamp) return false;
+            }
+            if (sharesGroup(face, to)) continue;
+
+            // the faces that stay must not flip
+            double before[3][3], after[3][3];
+            for (int corner = 0; corner < 3; corner++) {
+                const float *p = positions + (corners[corner] == move.first ? move.second : corners[corner]) * 3;
+                for (int axis = 0; axis < 3; axis++) {
+                    before[corner][axis] = positions[corners[corner] * 3 + axis];
+                    after[corner][axis] = p[axis];
+                }
+            }
+            double normals[2][3];
+            for (int which = 0; which < 2; which++) {
+                const double (*p)[3] = which ? after : before;
+                double e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+                double e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+                normals[which][0] = e1[1] * e2[2] - e1[2] * e2[1];
+                normals[which][1] = e1[2] * e2[0] - e1[0] * e2[2];
+                normals[which][2] = e1[0] * e2[1] - e1[1] * e2[0];
+            }
+            double dot = normals[0][0] * normals[1][0] + normals[0][1] * normals[1][1] + normals[0][2] * normals[1][2];
+            double lengths = sqrt((normals[0][0] * normals[0][0] + normals[0][1] * normals[0][1] + normals[0][2] * normals[0][2]) *
+                                  (normals[1][0] * normals[1][0] + normals[1][1] * normals[1][1] + normals[1][2] * normals[1][2]));
+            if (dot <= flipCosine * lengths) return false;
+        }
+    return true;
+}
+
+void Simplifier::collapse(int from, int to, vector<char>& locked)
+{
+    for (const auto& move : moves)
+        for (int k = firstFace[move.first]; k < firstFace[move.first + 1]; k++) {
+            int face = vertexFaces[k];
+            if (faceDead[face]) continue;
+            int *corners = faces.data() + face * 3;
+            for (int corner = 0; corner < 3; corner++)
+                if (corners[corner] == move.first) corners[corner] = move.second;
+            if (groupOf[corners[0]] == groupOf[corners[1]] || groupOf[corners[1]] == groupOf[corners[2]] ||
+                groupOf[corners[2]] == groupOf[corners[0]]) {
+                faceDead[face] = 1;
+                liveFaces--;
+            }
+        }
+    quadrics[to].add(quadrics[from]);
+    locked[from] = locked[to] = 1;
+}
+
+} // namespace
+
+float simplifyMesh(const Mesh& mesh, size_t targetFaceCount, Mesh& simplified)
+{
+    size_t vertexCount = mesh.vertexCount;
+    const float *positions = mesh.positions;
+    Simplifier simplifier;
+    simplifier.positions = positions;
+
+    // group the vertices by position
+    vector<int>& wedges = simplifier.wedges;
+    wedges.resize(vertexCount);
+    iota(wedges.begin(), wedges.end(), 0);
+    sort(wedges.begin(), wedges.end(), [positions](int a, int b) {
+        const float *p = positions + a * 3, *q = positions + b * 3;
+        for (int axis = 0; axis < 3; axis++)
+            if (p[axis] != q[axis]) return p[axis] < q[axis];
+        return a < b;
+    });
+    simplifier.groupOf.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float *p = positions + wedges[i] * 3;
+        if (i == 0 || !equal(p, p + 3, positions + wedges[i - 1] * 3)) simplifier.firstWedge.push_back((int)i);
+        simplifier.groupOf[wedges[i]] = (int)simplifier.firstWedge.size() - 1;
+    }
+    size_t groupCount = simplifier.firstWedge.size();
+    simplifier.firstWedge.push_back((int)vertexCount);
+    simplifier.aroundTarget.assign(groupCount, 0);
+    simplifier.oppositeEdge.assign(groupCount, 0);
+
+    // the faces that have an area, and the quadrics of their planes
+    vector<int>& faces = simplifier.faces;
+    vector<Quadric>& quadrics = simplifier.quadrics;
+    quadrics.resize(groupCount);
+    faces.reserve(mesh.faceCount * 3);
+    for (size_t face = 0; face < mesh.faceCount; face++) {
+        const int *corners = mesh.faces + face * 3;
+        const float *p0 = positions + corners[0] * 3, *p1 = positions + corners[1] * 3, *p2 = positions + corners[2] * 3;
+        double e1[3] = {(double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2]};
+        double e2[3] = {(double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2]};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0 || simplifier.groupOf[corners[0]] == simplifier.groupOf[corners[1]] ||
+            simplifier.groupOf[corners[1]] == simplifier.groupOf[corners[2]] ||
+            simplifier.groupOf[corners[2]] == simplifier.groupOf[corners[0]]) continue;
+        for (double& component : n) component /= length;
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int corner = 0; corner < 3; corner++) quadrics[simplifier.groupOf[corners[corner]]].addPlane(n, d, length * 0.5);
+        faces.insert(faces.end(), corners, corners + 3);
+    }
+    simplifier.liveFaces = faces.size() / 3;
+    simplifier.faceDead.assign(simplifier.liveFaces, 0);
+
+    // the planes of the border and seam edges, through the edge and perpendicular to its face
+    simplifier.buildPass();
+    for (size_t i = 0; i < faces.size(); i++) {
+        int a = faces[i], b = faces[i - i % 3 + (i + 1) % 3];
+        if (!simplifier.borderEdges[a] || !simplifier.borderEdges[b] || simplifier.facesWith(a, b) != 1) continue;
+        const int *corners = faces.data() + (i - i % 3);
+        const float *p0 = positions + corners[0] * 3, *p1 = positions + corners[1] * 3, *p2 = positions + corners[2] * 3;
+        double e1[3] = {(double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2]};
+        double e2[3] = {(double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2]};
+        double normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        const float *pa = positions + a * 3, *pb = positions + b * 3;
+        double edge[3] = {(double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2]};
+        double n[3] = {edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2],
+                       edge[0] * normal[1] - edge[1] * normal[0]};
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0) continue;
+        for (double& component : n) component /= length;
+        double d = -(n[0] * pa[0] + n[1] * pa[1] + n[2] * pa[2]);
+        double weight = borderWeight * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+        quadrics[simplifier.groupOf[a]].addPlane(n, d, weight);
+        quadrics[simplifier.groupOf[b]].addPlane(n, d, weight);
+    }
+
+    // passes of independent collapses, cheapest first: the groups of a collapse are locked until the next pass
+    double largestError = 0.0;
+    vector<Collapse> collapses;
+    vector<char> locked;
+    while (simplifier.liveFaces > targetFaceCount) {
+        collapses.clear();
+        for (const auto& edge : simplifier.edges) {
+            int a = edge.first, b = edge.second;
+            int groupA = simplifier.groupOf[a], groupB = simplifier.groupOf[b];
+            double toB = mergedError(quadrics[groupA], quadrics[groupB], positions + b * 3);
+            double toA = mergedError(quadrics[groupA], quadrics[groupB], positions + a * 3);
+            if (toB <= toA) collapses.push_back({toB, toA, groupA, groupB});
+            else collapses.push_back({toA, toB, groupB, groupA});
+        }
+        if (collapses.empty()) break;
+
+        // only the cheapest few per collapse still needed (an eighth of the edges at least) are sorted and tried,
+        // leaving costlier ones for the next pass; the rest only if none of them can collapse
+        size_t goal = max((size_t)1, (simplifier.liveFaces - targetFaceCount) / 2);
+        auto limit = collapses.begin() + min(collapses.size(), max(goal * 3, collapses.size() / 8));
+        nth_element(collapses.begin(), limit - 1, collapses.end());
+        sort(collapses.begin(), limit);
+        locked.assign(groupCount, 0);
+        size_t collapsed = 0;
+        for (auto candidate = collapses.begin(); candidate != collapses.end(); ++candidate) {
+            if (simplifier.liveFaces <= targetFaceCount || (collapsed && candidate >= limit)) break;
+            if (candidate == limit) sort(limit, collapses.end());
+            if (locked[candidate->from] || locked[candidate->to]) continue;
+            // the other way round if this way cannot collapse and that costs no more than the limit
+            int from = candidate->from, to = candidate->to;
+            double error = candidate->error;
+            if (!simplifier.canCollapse(from, to)) {
+                if (candidate < limit && candidate->reverseError > (limit - 1)->error) continue;
+                swap(from, to);
+                error = candidate->reverseError;
+                if (!simplifier.canCollapse(from, to)) continue;
+            }
+            simplifier.collapse(from, to, locked);
+            largestError = max(largestError, error);
+            collapsed++;
+        }
+        if (!collapsed) break;
+
+        size_t live = 0;
+        for (size_t face = 0; face < simplifier.faceDead.size(); face++)
+            if (!simplifier.faceDead[face]) copy(faces.begin() + face * 3, faces.begin() + face * 3 + 3, faces.begin() + live++ * 3);
+        faces.resize(live * 3);
+        simplifier.faceDead.assign(live, 0);
+        simplifier.buildPass();
+    }
+
+    // keep the vertices still used, in the order of first use, those with texture coordinates first
+    vector<int> used, newIndex(vertexCount, -1);
+    for (int vertex : faces)
+        if (newIndex[vertex] < 0) {
+            newIndex[vertex] = 0;
+            used.push_back(vertex);
+        }
+    size_t textureCoordinateCount = mesh.textureCoordinateCount;
+    auto textured = stable_partition(used.begin(), used.end(), [textureCoordinateCount](int vertex) {
+        return (size_t)vertex < textureCoordinateCount;
+    });
+    for (size_t i = 0; i < used.size(); i++) newIndex[used[i]] = (int)i;
+
+    simplified.allocate(used.size(), textured - used.begin(), faces.size() / 3);
+    for (size_t i = 0; i < used.size(); i++) {
+        copy(positions + used[i] * 3, positions + used[i] * 3 + 3, simplified.positions + i * 3);
+        if (i < simplified.textureCoordinateCount)
+            copy(mesh.textureCoordinates + used[i] * 2, mesh.textureCoordinates + used[i] * 2 + 2, simplified.textureCoordinates + i * 2);
+    }
+    for (size_t i = 0; i < faces.size(); i++) simplified.faces[i] = newIndex[faces[i]];
+    copy(mesh.center, mesh.center + 3, simplified.center);
+    simplified.diagonalLength = mesh.diagonalLength;
+    return (float)sqrt(largestError);
+}
+
+void buildMeshLods(const Mesh& mesh, vector<MeshLod>& lods)
+{
+    lods.clear();
+    lods.reserve(MESH_MAX_LODS - 1); // the previous level stays in place while the next is built from it
+    float error = 0.0f;
+    while (lods.size() + 1 < MESH_MAX_LODS) {
+        const Mesh& previous = lods.empty() ? mesh : lods.back().mesh;
+        size_t target = previous.faceCount / 2;
+        if (target < MESH_LOD_MIN_FACES) break;
+        MeshLod lod;
+        error += simplifyMesh(previous, target, lod.mesh);
+        if (lod.mesh.faceCount * 4 > previous.faceCount * 3) break;
+        optimizeVertexCache(lod.mesh);
+        optimizeVertexFetch(lod.mesh);
+        lod.error = error;
+        lods.push_back(move(lod));
+    }
+}
+
+float lodPixelsPerUnit(float scale, float distance, float fieldOfView, int height)
+{
+    return scale * height / (2.0f * distance * tanf(fieldOfView * 0.5f * 3.14159265f / 180.0f));
+}
+
+int selectMeshLod(const vector<MeshLod>& lods, float pixelsPerUnit, float threshold, int current)
+{
+    // the errors grow with the level
+    int level = 0;
+    while (level < (int)lods.size() && lods[level].error * pixelsPerUnit <= threshold) level++;
+    while (level > current && lods[level - 1].error * pixelsPerUnit > threshold * MESH_LOD_HYSTERESIS) level--;
+    return level;
+}
@@ -0,0 +1,1023 @@
+// Model processing shared by the viewer and the asset bake tool: centring, face normals and vertex normals.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+
+#include "../include/cpuFeatures.h"
+#include "../include/mappedFile.h"
+#include "../include/meshProcessing.h"
+#include "../include/objLoader.h"
+#include "../include/plyLoader.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Vertices per thread below which the vertex normals are not worth splitting.
+const size_t minimumVerticesPerThread = 1 << 16;
+
+/**
+ * Run work(begin, end) over count items split into threadCount contiguous ranges, one thread per range.
+ */
+template <typename Work>
+void parallelRanges(size_t count, unsigned int threadCount, Work work)
+{
+    if (threadCount <= 1) {
+        work((size_t)0, count);
+        return;
+    }
+    vector<thread> workers;
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back([=, &work] { work(count * i / threadCount, count * (i + 1) / threadCount); });
+    for (thread& worker : workers) worker.join();
+}
+
+} // namespace
+
+bool loadModelFile(const std::string& fileName, std::vector<float>& vertices, std::vector<float>& textureCoordinates,
+                   std::vector<int>& faces, unsigned int threadCount)
+{
+    string extension = fileName.substr(min(fileName.size(), fileName.find_last_of('.')));
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    if (extension == ".ply") return loadPLYFile(fileName, vertices, textureCoordinates, faces);
+    return loadOBJFile(fileName, vertices, textureCoordinates, faces, threadCount);
+}
+
+bool loadMesh(const std::string& fileName, Mesh& mesh, unsigned int threadCount, size_t streamBudget)
+{
+    string extension = fileName.substr(min(fileName.size(), fileName.find_last_of('.')));
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    if (extension != ".ply" && streamBudget && MappedFile(fileName).size() > streamBudget) {
+        StreamedMesh streamed;
+        if (!streamOBJFile(fileName, streamBudget, streamed) || streamed.vertices.size() < streamed.vertexCount * 12 ||
+            streamed.textureCoordinates.size() < streamed.textureCoordinateCount * 8 ||
+            streamed.faces.size() < streamed.triangleCount * 12)
+            return false;
+        Mesh loaded;
+        loaded.allocate(streamed.vertexCount, streamed.textureCoordinateCount, streamed.triangleCount);
+        // the vertices are left as parsed, not centred, like those of the other importers
+        auto positions = (const float *)streamed.vertices.data();
+        auto textureCoordinates = (const float *)streamed.textureCoordinates.data();
+        auto faces = (const int *)streamed.faces.data();
+        copy(positions, positions + streamed.vertexCount * 3, loaded.positions);
+        copy(textureCoordinates, textureCoordinates + streamed.textureCoordinateCount * 2, loaded.textureCoordinates);
+        copy(faces, faces + streamed.triangleCount * 3, loaded.faces);
+        mesh = move(loaded);
+        return true;
+    }
+    if (extension != ".ply") return loadOBJFile(fileName, mesh, threadCount);
+
+    vector<float> vertices, textureCoordinates;
+    vector<int> faces;
+    if (!loadPLYFile(fileName, vertices, textureCoordinates, faces)) return false;
+    Mesh loaded;
+    loaded.allocate(vertices.size() / 3, textureCoordinates.size() / 2, faces.size() / 3);
+    copy(vertices.begin(), vertices.end(), loaded.positions);
+    copy(textureCoordinates.begin(), textureCoordinates.end(), loaded.textureCoordinates);
+    copy(faces.begin(), faces.end(), loaded.faces);
+    mesh = move(loaded);
+    return true;
+}
+
+namespace {
+
+// Extend minimum and maximum over vertices first to count, scalar.
+void boundsScalar(const float *vertices, size_t first, size_t count, float *minimum, float *maximum)
+{
+    for (size_t i = first * 3; i < count * 3; i += 3)
+        for (int axis = 0; axis < 3; axis++) {
+            if (vertices[i + axis] > maximum[axis]) maximum[axis] = vertices[i + axis];
+            if (vertices[i + axis] < minimum[axis]) minimum[axis] = vertices[i + axis];
+        }
+}
+
+// Face normal and area weight of faces first to count, scalar. The reference for the SIMD kernels.
+void faceNormalsScalar(const float *vertices, const int *faces, float *faceNormals, float *faceVolumes,
+                       size_t first, size_t count)
+{
+    float firstPoint[3] = { 0.0, 0.0, 0.0 };
+    float secondPoint[3] = { 0.0, 0.0, 0.0 };
+    float thirdPoint[3] = { 0.0, 0.0, 0.0 };
+
+    float firstVector[3] = { 0.0,0.0,0.0 };
+    float secondVector[3] = { 0.0,0.0,0.0 };
+
+    float tempNormalX, tempNormalY, tempNormalZ;
+
+    for (size_t i = first * 3; i < count * 3; i += 3)
+    {
+        // get the x,y,z of first, second and third point of the face
+        firstPoint[0]  = vertices[faces[  i  ] * 3];
+        firstPoint[1]  = vertices[faces[  i  ] * 3 + 1];
+        firstPoint[2]  = vertices[faces[  i  ] * 3 + 2];
+        secondPoint[0] = vertices[faces[i + 1] * 3];
+        secondPoint[1] = vertices[faces[i + 1] * 3 + 1];
+        secondPoint[2] = vertices[faces[i + 1] * 3 + 2];
+        thirdPoint[0]  = vertices[faces[i + 2] * 3];
+        thirdPoint[1]  = vertices[faces[i + 2] * 3 + 1];
+        thirdPoint[2]  = vertices[faces[i + 2] * 3 + 2];
+        // FYI:                             ^This is a vertex index^
+
+        // calculate 2 vectors from three ordered points
+        firstVector[0] = secondPoint[0] - firstPoint[0];
+        firstVector[1] = secondPoint[1] - firstPoint[1];
+        firstVector[2] = secondPoint[2] - firstPoint[2];
+        secondVector[0] = thirdPoint[0] - secondPoint[0];
+        secondVector[1] = thirdPoint[1] - secondPoint[1];
+        secondVector[2] = thirdPoint[2] - secondPoint[2];
+
+        // compute normal
+        tempNormalX = firstVector[1] * secondVector[2] - firstVector[2] * secondVector[1];
+        tempNormalY = firstVector[2] * secondVector[0] - firstVector[0] * secondVector[2];
+        tempNormalZ = firstVector[0] * secondVector[1] - firstVector[1] * secondVector[0];
+
+        double tempNormalLength = sqrt(pow(tempNormalX,2) + pow(tempNormalY,2) + pow(tempNormalZ,2));
+        // normalize
+        faceNormals[i]     = (float)(tempNormalX / tempNormalLength);
+        faceNormals[i + 1] = (float)(tempNormalY / tempNormalLength);
+        faceNormals[i + 2] = (float)(tempNormalZ / tempNormalLength);
+
+        // compute face volume for each face, the weight of its normal in the vertex normals.
+        // NB: half the sum of the cross product's components rather than half its length, kept so the
+        // vertex normals stay what they always were.
+        float temp1P = (secondPoint[1] - firstPoint[1]) * (thirdPoint[2] - firstPoint[2]);
+        float temp2P = (secondPoint[2] - firstPoint[2]) * (thirdPoint[0] - firstPoint[0]);
+        float temp3P = (secondPoint[0] - firstPoint[0]) * (thirdPoint[1] - firstPoint[1]);
+        float temp1N = (secondPoint[1] - firstPoint[1]) * (thirdPoint[0] - firstPoint[0]);
+        float temp2N = (secondPoint[0] - firstPoint[0]) * (thirdPoint[2] - firstPoint[2]);
+        float temp3N = (secondPoint[2] - firstPoint[2]) * (thirdPoint[1] - firstPoint[1]);
+        faceVolumes[i / 3] = (float)0.5 * abs(temp1P + temp2P + temp3P - temp1N - temp2N - temp3N);
+    }
+}
+
+
+#ifdef CPU_X86
+/**
+ * The positions are read 4 vertices (12 floats) at a time into 3 registers, whose lanes hold the axes
+ * x y z x | y z x y | z x y z, so lane l of register r is axis (4r + l) % 3 and no shuffles are needed.
+ * @return Number of vertices done, a multiple of 4.
+ */
+TARGET_SSE41 size_t boundsSSE41(const float *vertices, size_t count, float *minimum, float *maximum)
+{
+    if (count < 4) return 0;
+    __m128 low[3], high[3];
+    for (int r = 0; r < 3; r++) low[r] = high[r] = _mm_loadu_ps(vertices + 4 * r);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4)
+        for (int r = 0; r < 3; r++) {
+            __m128 v = _mm_loadu_ps(vertices + 3 * i + 4 * r);
+            low[r] = _mm_min_ps(low[r], v);
+            high[r] = _mm_max_ps(high[r], v);
+        }
+    float lows[12], highs[12];
+    for (int r = 0; r < 3; r++) {
+        _mm_storeu_ps(lows + 4 * r, low[r]);
+        _mm_storeu_ps(highs + 4 * r, high[r]);
+    }
+    for (int lane = 0; lane < 12; lane++) {
+        minimum[lane % 3] = min(minimum[lane % 3], lows[lane]);
+        maximum[lane % 3] = max(maximum[lane % 3], highs[lane]);
+    }
+    return i;
+}
+
+/**
+ * As boundsSSE41 with 8 vertices (24 floats) at a time, lane l of register r being axis (8r + l) % 3.
+ */
+TARGET_AVX2 size_t boundsAVX2(const float *vertices, size_t count, float *minimum, float *maximum)
+{
+    if (count < 8) return 0;
+    __m256 low[3], high[3];
+    for (int r = 0; r < 3; r++) low[r] = high[r] = _mm256_loadu_ps(vertices + 8 * r);
+    size_t i = 8;
+    for (; i + 8 <= count; i += 8)
+        for (int r = 0; r < 3; r++) {
+            __m256 v = _mm256_loadu_ps(vertices + 3 * i + 8 * r);
+            low[r] = _mm256_min_ps(low[r], v);
+            high[r] = _mm256_max_ps(high[r], v);
+        }
+    float lows[24], highs[24];
+    for (int r = 0; r < 3; r++) {
+        _mm256_storeu_ps(lows + 8 * r, low[r]);
+        _mm256_storeu_ps(highs + 8 * r, high[r]);
+    }
+    for (int lane = 0; lane < 24; lane++) {
+        minimum[lane % 3] = min(minimum[lane % 3], lows[lane]);
+        maximum[lane % 3] = max(maximum[lane % 3], highs[lane]);
+    }
+    return i;
+}
+
+// Subtract offset from the first vertices, 8 at a time with the lane layout of boundsAVX2. Returns the number done.
+TARGET_AVX2 size_t translateAVX2(float *vertices, size_t count, const float *offset)
+{
+    __m256 offsets[3];
+    for (int r = 0; r < 3; r++)
+        offsets[r] = _mm256_setr_ps(offset[(8 * r) % 3], offset[(8 * r + 1) % 3], offset[(8 * r + 2) % 3],
+                                    offset[(8 * r + 3) % 3], offset[(8 * r + 4) % 3], offset[(8 * r + 5) % 3],
+                                    offset[(8 * r + 6) % 3], offset[(8 * r + 7) % 3]);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        for (int r = 0; r < 3; r++)
+            _mm256_storeu_ps(vertices + 3 * i + 8 * r, _mm256_sub_ps(_mm256_loadu_ps(vertices + 3 * i + 8 * r), offsets[r]));
+    return i;
+}
+
+// As translateAVX2, 4 vertices at a time.
+TARGET_SSE41 size_t translateSSE41(float *vertices, size_t count, const float *offset)
+{
+    __m128 offsets[3];
+    for (int r = 0; r < 3; r++)
+        offsets[r] = _mm_setr_ps(offset[(4 * r) % 3], offset[(4 * r + 1) % 3], offset[(4 * r + 2) % 3], offset[(4 * r + 3) % 3]);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        for (int r = 0; r < 3; r++)
+            _mm_storeu_ps(vertices + 3 * i + 4 * r, _mm_sub_ps(_mm_loadu_ps(vertices + 3 * i + 4 * r), offsets[r]));
+    return i;
+}
+
+// Divide 4 float components by 4 double lengths (2 per register) in double, as the scalar code does.
+TARGET_SSE41 inline __m128 divideSSE41(__m128 component, __m128d lengthLow, __m128d lengthHigh)
+{
+    __m128d low = _mm_div_pd(_mm_cvtps_pd(component), lengthLow);
+    __m128d high = _mm_div_pd(_mm_cvtps_pd(_mm_movehl_ps(component, component)), lengthHigh);
+    return _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+}
+
+// sqrt(x * x + y * y + z * z) of 2 float components widened to double.
+TARGET_SSE41 inline __m128d lengthSSE41(__m128 x, __m128 y, __m128 z)
+{
+    __m128d dx = _mm_cvtps_pd(x), dy = _mm_cvtps_pd(y), dz = _mm_cvtps_pd(z);
+    return _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz)));
+}
+
+// Store the vectors {x[i], y[i], z[i]} of 4 lanes as 12 interleaved floats.
+TARGET_SSE41 inline void storeInterleavedSSE41(float *out, __m128 x, __m128 y, __m128 z)
+{
+    __m128 xyLow = _mm_unpacklo_ps(x, y), xyHigh = _mm_unpackhi_ps(x, y); // x0 y0 x1 y1, x2 y2 x3 y3
+    _mm_storeu_ps(out, _mm_shuffle_ps(xyLow, _mm_unpacklo_ps(z, x), _MM_SHUFFLE(3, 0, 1, 0)));         // x0 y0 z0 x1
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(_mm_unpacklo_ps(y, z), xyHigh, _MM_SHUFFLE(1, 0, 3, 2)));    // y1 z1 x2 y2
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(_mm_unpackhi_ps(z, x), _mm_unpackhi_ps(y, z), _MM_SHUFFLE(3, 2, 3, 0))); // z2 x3 y3 z3
+}
+
+/**
+ * Face normals and area weights of 4 faces per step. The corners of the 4 faces are gathered into one
+ * register per corner and axis (structure of arrays), so the cross products and areas are computed
+ * 4 faces at a time with the same float operations, in the same order, as faceNormalsScalar, and the
+ * lengths and divisions in double like its sqrt(pow()) - the results are bit-identical.
+ * @return Number of faces done, a multiple of 4.
+ */
+TARGET_SSE41 size_t faceNormalsSSE41(const float *vertices, const int *faces, float *faceNormals, float *faceVolumes,
+                                     size_t count)
+{
+    const __m128 half = _mm_set1_ps(0.5f), sign = _mm_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const int *face = faces + 3 * i;
+        __m128 point[3][3]; // [corner][axis]
+        for (int corner = 0; corner < 3; corner++)
+            for (int axis = 0; axis < 3; axis++)
+                point[corner][axis] = _mm_setr_ps(vertices[face[corner] * 3 + axis], vertices[face[3 + corner] * 3 + axis],
+                                                  vertices[face[6 + corner] * 3 + axis], vertices[face[9 + corner] * 3 + axis]);
+
+        // first to second, second to third and first to third point
+        __m128 firstVector[3], secondVector[3], thirdVector[3];
+        for (int axis = 0; axis < 3; axis++) {
+            firstVector[axis] = _mm_sub_ps(point[1][axis], point[0][axis]);
+            secondVector[axis] = _mm_sub_ps(point[2][axis], point[1][axis]);
+            thirdVector[axis] = _mm_sub_ps(point[2][axis], point[0][axis]);
+        }
+        __m128 x = _mm_sub_ps(_mm_mul_ps(firstVector[1], secondVector[2]), _mm_mul_ps(firstVector[2], secondVector[1]));
+        __m128 y = _mm_sub_ps(_mm_mul_ps(firstVector[2], secondVector[0]), _mm_mul_ps(firstVector[0], secondVector[2]));
+        __m128 z = _mm_sub_ps(_mm_mul_ps(firstVector[0], secondVector[1]), _mm_mul_ps(firstVector[1], secondVector[0]));
+        __m128d lengthLow = lengthSSE41(x, y, z);
+        __m128d lengthHigh = lengthSSE41(_mm_movehl_ps(x, x), _mm_movehl_ps(y, y), _mm_movehl_ps(z, z));
+        storeInterleavedSSE41(faceNormals + 3 * i, divideSSE41(x, lengthLow, lengthHigh),
+                              divideSSE41(y, lengthLow, lengthHigh), divideSSE41(z, lengthLow, lengthHigh));
+
+        __m128 volume = _mm_mul_ps(firstVector[1], thirdVector[2]);
+        volume = _mm_add_ps(volume, _mm_mul_ps(firstVector[2], thirdVector[0]));
+        volume = _mm_add_ps(volume, _mm_mul_ps(firstVector[0], thirdVector[1]));
+        volume = _mm_sub_ps(volume, _mm_mul_ps(firstVector[1], thirdVector[0]));
+        volume = _mm_sub_ps(volume, _mm_mul_ps(firstVector[0], thirdVector[2]));
+        volume = _mm_sub_ps(volume, _mm_mul_ps(firstVector[2], thirdVector[1]));
+        _mm_storeu_ps(faceVolumes + i, _mm_mul_ps(half, _mm_andnot_ps(sign, volume)));
+    }
+    return i;
+}
+
+/**
+ * As faceNormalsSSE41 with 8 faces per step. Only the float parts run 8 wide, the lengths and divisions are
+ * done in double on each half. The corners are loaded one by one, which measured faster than vgatherdps.
+ * Compiled without FMA so that no multiply and subtract is fused and rounded differently.
+ */
+TARGET_AVX2_NOFMA size_t faceNormalsAVX2(const float *vertices, const int *faces, float *faceNormals, float *faceVolumes,
+                                   size_t count)
+{
+    const __m256 half = _mm256_set1_ps(0.5f), sign = _mm256_set1_ps(-0.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 point[3][3]; // [corner][axis]
+        const int *face = faces + 3 * i;
+        for (int corner = 0; corner < 3; corner++)
+            for (int axis = 0; axis < 3; axis++)
+                point[corner][axis] = _mm256_setr_ps(vertices[face[corner] * 3 + axis], vertices[face[3 + corner] * 3 + axis],
+                                                     vertices[face[6 + corner] * 3 + axis], vertices[face[9 + corner] * 3 + axis],
+                                                     vertices[face[12 + corner] * 3 + axis], vertices[face[15 + corner] * 3 + axis],
+                                                     vertices[face[18 + corner] * 3 + axis], vertices[face[21 + corner] * 3 + axis]);
+
+        __m256 firstVector[3], secondVector[3], thirdVector[3];
+        for (int axis = 0; axis < 3; axis++) {
+            firstVector[axis] = _mm256_sub_ps(point[1][axis], point[0][axis]);
+            secondVector[axis] = _mm256_sub_ps(point[2][axis], point[1][axis]);
+            thirdVector[axis] = _mm256_sub_ps(point[2][axis], point[0][axis]);
+        }
+        __m256 normal[3] = {
+            _mm256_sub_ps(_mm256_mul_ps(firstVector[1], secondVector[2]), _mm256_mul_ps(firstVector[2], secondVector[1])),
+            _mm256_sub_ps(_mm256_mul_ps(firstVector[2], secondVector[0]), _mm256_mul_ps(firstVector[0], secondVector[2])),
+            _mm256_sub_ps(_mm256_mul_ps(firstVector[0], secondVector[1]), _mm256_mul_ps(firstVector[1], secondVector[0]))
+        };
+        for (int part = 0; part < 2; part++) {
+            __m256d widened[3];
+            for (int axis = 0; axis < 3; axis++)
+                widened[axis] = _mm256_cvtps_pd(part ? _mm256_extractf128_ps(normal[axis], 1) : _mm256_castps256_ps128(normal[axis]));
+            __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(widened[0], widened[0]),
+                                                                        _mm256_mul_pd(widened[1], widened[1])),
+                                                          _mm256_mul_pd(widened[2], widened[2])));
+            storeInterleavedSSE41(faceNormals + 3 * (i + 4 * part), _mm256_cvtpd_ps(_mm256_div_pd(widened[0], length)),
+                                  _mm256_cvtpd_ps(_mm256_div_pd(widened[1], length)), _mm256_cvtpd_ps(_mm256_div_pd(widened[2], length)));
+        }
+
+        __m256 volume = _mm256_mul_ps(firstVector[1], thirdVector[2]);
+        volume = _mm256_add_ps(volume, _mm256_mul_ps(firstVector[2], thirdVector[0]));
+        volume = _mm256_add_ps(volume, _mm256_mul_ps(firstVector[0], thirdVector[1]));
+        volume = _mm256_sub_ps(volume, _mm256_mul_ps(firstVector[1], thirdVector[0]));
+        volume = _mm256_sub_ps(volume, _mm256_mul_ps(firstVector[0], thirdVector[2]));
+        volume = _mm256_sub_ps(volume, _mm256_mul_ps(firstVector[2], thirdVector[1]));
+        _mm256_storeu_ps(faceVolumes + i, _mm256_mul_ps(half, _mm256_andnot_ps(sign, volume)));
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+namespace {
+
+// Mixes the coordinates of a grid cell into a hash.
+uint64_t cellHash(int64_t x, int64_t y, int64_t z)
+{
+    uint64_t hash = (uint64_t)x * 0x9E3779B97F4A7C15ull ^ (uint64_t)y * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)z * 0x165667B19E3779F9ull;
+    return hash ^ (hash >> 29);
+}
+
+} // namespace
+
+WeldStatistics weldMesh(Mesh& mesh, float tolerance, unsigned int threadCount)
+{
+    WeldStatistics statistics;
+    size_t vertexCount = mesh.vertexCount, textureCoordinateCount = mesh.textureCoordinateCount;
+    if (vertexCount == 0) return statistics;
+    if (threadCount == 0) threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = (unsigned int)min<size_t>(threadCount, vertexCount / minimumVerticesPerThread + 1);
+    const float *positions = mesh.positions, *textureCoordinates = mesh.textureCoordinates;
+
+    float minimum[3], maximum[3];
+    for (int axis = 0; axis < 3; axis++) minimum[axis] = maximum[axis] = positions[axis];
+    boundsScalar(positions, 1, vertexCount, minimum, maximum);
+    double diagonal = sqrt(pow(maximum[0] - minimum[0], 2.0) + pow(maximum[1] - minimum[1], 2.0) +
+                           pow(maximum[2] - minimum[2], 2.0));
+    double radius = tolerance * diagonal;
+    // cells a fraction of the spacing of the vertices of a surface: a vertex compares itself with the vertices of its
+    // cell, so few should share one, but cells stay far wider than the tolerance, so a vertex rarely lies within
+    // tolerance of a cell's side, which is when the neighbouring cell has to be searched too
+    double cellSize = max(radius, diagonal / sqrt((double)vertexCount) / 16.0);
+    if (!(cellSize > 0.0)) cellSize = 1.0; // a single point: only equal vertices merge
+
+    // the vertices of each hash bucket of cells in compressed sparse rows, in index order
+    size_t bucketCount = 1;
+    while (bucketCount < 2 * vertexCount) bucketCount <<= 1;
+    auto bucketOf = [&](int64_t x, int64_t y, int64_t z) { return (int)(cellHash(x, y, z) & (bucketCount - 1)); };
+    vector<int> buckets(vertexCount), firstVertex(bucketCount + 1, 0), bucketVertices(vertexCount);
+    parallelRanges(vertexCount, threadCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float *p = positions + i * 3;
+            buckets[i] = bucketOf((int64_t)floor(p[0] / cellSize), (int64_t)floor(p[1] / cellSize), (int64_t)floor(p[2] / cellSize));
+        }
+    });
+    for (size_t i = 0; i < vertexCount; i++) firstVertex[buckets[i] + 1]++;
+    for (size_t i = 1; i <= bucketCount; i++) firstVertex[i] += firstVertex[i - 1];
+    vector<int> next(firstVertex.begin(), firstVertex.end() - 1);
+    for (size_t i = 0; i < vertexCount; i++) bucketVertices[next[buckets[i]]++] = (int)i;
+
+    // every vertex merges into the first vertex within tolerance, found in the cells its tolerance box overlaps
+    vector<int> representative(vertexCount);
+    parallelRanges(vertexCount, threadCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int first = (int)i;
+            const float *p = positions + i * 3;
+            int64_t low[3], high[3];
+            for (int axis = 0; axis < 3; axis++) {
+                low[axis] = (int64_t)floor((p[axis] - radius) / cellSize);
+                high[axis] = (int64_t)floor((p[axis] + radius) / cellSize);
+            }
+            for (int64_t x = low[0]; x <= high[0]; x++)
+            for (int64_t y = low[1]; y <= high[1]; y++)
+            for (int64_t z = low[2]; z <= high[2]; z++) {
+                int bucket = bucketOf(x, y, z);
+                for (int k = firstVertex[bucket]; k < firstVertex[bucket + 1] && bucketVertices[k] < first; k++) {
+                    int j = bucketVertices[k];
+                    const float *q = positions + (size_t)j * 3;
+                    double dx = (double)p[0] - q[0], dy = (double)p[1] - q[1], dz = (double)p[2] - q[2];
+                    if (dx * dx + dy * dy + dz * dz > radius * radius) continue;
+                    // j < i, so j has texture coordinates whenever i has
+                    if ((size_t)j < textureCoordinateCount &&
+                        (i >= textureCoordinateCount ||
+                         fabs(textureCoordinates[i * 2] - textureCoordinates[(size_t)j * 2]) > tolerance ||
+                         fabs(textureCoordinates[i * 2 + 1] - textureCoordinates[(size_t)j * 2 + 1]) > tolerance))
+                        continue;
+                    first = j;
+                    break;
+                }
+            }
+            representative[i] = first;
+        }
+    });
+    // follow chains of merges to their first vertex, representatives come before the vertices merged into them
+    for (size_t i = 0; i < vertexCount; i++) representative[i] = representative[representative[i]];
+
+    // faces on the merged vertices, without those that have no area
+    const int *faces = mesh.faces;
+    vector<char> keptFaces(mesh.faceCount);
+    parallelRanges(mesh.faceCount, threadCount, [&](size_t begin, size_t end) {
+        for (size_t face = begin; face < end; face++) {
+            int a = representative[faces[face * 3]], b = representative[faces[face * 3 + 1]], c = representative[faces[face * 3 + 2]];
+            const float *first = positions + (size_t)a * 3, *second = positions + (size_t)b * 3, *third = positions + (size_t)c * 3;
+            // the cross product ComputeFaceNormals normalizes
+            float firstVector[3], secondVector[3];
+            for (int axis = 0; axis < 3; axis++) {
+                firstVector[axis] = second[axis] - first[axis];
+                secondVector[axis] = third[axis] - second[axis];
+            }
+            bool hasArea = firstVector[1] * secondVector[2] - firstVector[2] * secondVector[1] != 0.0f ||
+                           firstVector[2] * secondVector[0] - firstVector[0] * secondVector[2] != 0.0f ||
+                           firstVector[0] * secondVector[1] - firstVector[1] * secondVector[0] != 0.0f;
+            keptFaces[face] = a != b && b != c && a != c && hasArea;
+        }
+    });
+
+    // new indices of the vertices that kept faces
+    vector<int> newIndex(vertexCount, -1);
+    size_t faceCount = 0;
+    for (size_t face = 0; face < mesh.faceCount; face++) {
+        if (!keptFaces[face]) continue;
+        faceCount++;
+        for (int corner = 0; corner < 3; corner++) newIndex[representative[faces[face * 3 + corner]]] = 0;
+    }
+    size_t keptVertices = 0, keptTextureCoordinates = 0;
+    for (size_t i = 0; i < vertexCount; i++)
+        if (newIndex[i] == 0) {
+            newIndex[i] = (int)keptVertices++;
+            if (i < textureCoordinateCount) keptTextureCoordinates++;
+        }
+    statistics.removedVertices = vertexCount - keptVertices;
+    statistics.removedFaces = mesh.faceCount - faceCount;
+    if (statistics.removedVertices == 0 && statistics.removedFaces == 0) return statistics;
+
+    // the order is kept, so the vertices with texture coordinates still come first
+    Mesh welded;
+    welded.allocate(keptVertices, keptTextureCoordinates, faceCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (newIndex[i] < 0) continue;
+        copy(positions + i * 3, positions + i * 3 + 3, welded.positions + (size_t)newIndex[i] * 3);
+        if (i < textureCoordinateCount)
+            copy(textureCoordinates + i * 2, textureCoordinates + i * 2 + 2, welded.textureCoordinates + (size_t)newIndex[i] * 2);
+    }
+    int *weldedFaces = welded.faces;
+    for (size_t face = 0; face < mesh.faceCount; face++)
+        if (keptFaces[face])
+            for (int corner = 0; corner < 3; corner++) *weldedFaces++ = newIndex[representative[faces[face * 3 + corner]]];
+    copy(mesh.center, mesh.center + 3, welded.center);
+    welded.diagonalLength = mesh.diagonalLength;
+    mesh = move(welded);
+    return statistics;
+}
+
+VertexCacheStatistics analyzeVertexCache(const Mesh& mesh, int cacheSize)
+{
+    VertexCacheStatistics statistics;
+    if (mesh.faceCount == 0 || mesh.vertexCount == 0) return statistics;
+    // a vertex is still cached while fewer than cacheSize misses happened since it was loaded
+    vector<size_t> loadedAt(mesh.vertexCount, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < mesh.faceCount * 3; i++) {
+        int vertex = mesh.faces[i];
+        if (loadedAt[vertex] && misses + 1 - loadedAt[vertex] < (size_t)cacheSize) continue;
+        misses++;
+        loadedAt[vertex] = misses;
+    }
+    statistics.acmr = (double)misses / mesh.faceCount;
+    statistics.atvr = (double)misses / mesh.vertexCount;
+    return statistics;
+}
+
+namespace {
+
+// Size of the LRU cache optimizeVertexCache() simulates, and the valence up to which its scores are tabulated.
+const int forsythCacheSize = 32;
+const int forsythValences = 32;
+
+/**
+ * Forsyth's vertex scores: the three most recent vertices (the last face's) score 0.75, older ones
+ * decay with their cache position, and vertices with few faces left get a boost so that no lone face is left behind.
+ */
+struct ForsythScores
+{
+    float cache[forsythCacheSize];
+    float valence[forsythValences];
+
+    ForsythScores()
+    {
+        for (int position = 0; position < forsythCacheSize; position++)
+            cache[position] = position < 3 ? 0.75f : powf(1.0f - (float)(position - 3) / (forsythCacheSize - 3), 1.5f);
+        valence[0] = 0.0f;
+        for (int faces = 1; faces < forsythValences; faces++) valence[faces] = 2.0f * powf((float)faces, -0.5f);
+    }
+
+    // -1 for a vertex whose faces were all emitted.
+    float vertex(int cachePosition, int activeFaces) const
+    {
+        if (activeFaces == 0) return -1.0f;
+        return (cachePosition < 0 ? 0.0f : cache[cachePosition]) +
+               (activeFaces < forsythValences ? valence[activeFaces] : 2.0f * powf((float)activeFaces, -0.5f));
+    }
+};
+
+// Reorder count elements of components values each: element order[i] becomes element i.
+template <typename T>
+void gatherElements(T *data, const vector<int>& order, int components)
+{
+    vector<T> copy(data, data + order.size() * components);
+    for (size_t i = 0; i < order.size(); i++)
+        std::copy(copy.begin() + (size_t)order[i] * components, copy.begin() + ((size_t)order[i] + 1) * components,
+                  data + i * components);
+}
+
+/**
+ * Forsyth's order of faceCount faces whose corners index vertexCount vertices.
+ * @param order Receives the faces in the order to draw them.
+ */
+void forsythOrder(const int *faces, size_t faceCount, size_t vertexCount, vector<int>& order)
+{
+    static const ForsythScores scores;
+
+    // the faces of each vertex in compressed sparse rows; the first activeFaces[v] of row v are not emitted yet
+    vector<int> firstFace(vertexCount + 1, 0), vertexFaces(faceCount * 3), activeFaces(vertexCount, 0);
+    for (size_t i = 0; i < faceCount * 3; i++) activeFaces[faces[i]]++;
+    for (size_t i = 0; i < vertexCount; i++) firstFace[i + 1] = firstFace[i] + activeFaces[i];
+    vector<int> next(firstFace.begin(), firstFace.end() - 1);
+    for (size_t i = 0; i < faceCount * 3; i++) vertexFaces[next[faces[i]]++] = (int)(i / 3);
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScores(vertexCount), faceScores(faceCount);
+    for (size_t i = 0; i < vertexCount; i++) vertexScores[i] = scores.vertex(-1, activeFaces[i]);
+    int bestFace = -1;
+    float bestScore = -1.0f;
+    for (size_t face = 0; face < faceCount; face++) {
+        faceScores[face] = vertexScores[faces[face * 3]] + vertexScores[faces[face * 3 + 1]] + vertexScores[faces[face * 3 + 2]];
+        if (faceScores[face] > bestScore) {
+            bestScore = faceScores[face];
+            bestFace = (int)face;
+        }
+    }
+
+    vector<char> emitted(faceCount, 0);
+    order.clear();
+    order.reserve(faceCount);
+    int cache[forsythCacheSize + 3], cacheEntries = 0;
+    size_t cursor = 0;
+    while (order.size() < faceCount) {
+        if (bestFace < 0) {
+            // nothing left around the cached vertices: carry on with the first face not emitted
+            while (emitted[cursor]) cursor++;
+            bestFace = (int)cursor;
+        }
+        int face = bestFace;
+        const int *corners = faces + (size_t)face * 3;
+        emitted[face] = 1;
+        order.push_back(face);
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = corners[corner], *row = vertexFaces.data() + firstFace[vertex];
+            for (int k = 0; k < activeFaces[vertex]; k++)
+                if (row[k] == face) {
+                    swap(row[k], row[activeFaces[vertex] - 1]);
+                    break;
+                }
+            activeFaces[vertex]--;
+        }
+
+        // the face's vertices move to the front of the cache, the oldest vertices drop out of it
+        int newCache[forsythCacheSize + 3], newEntries = 0;
+        for (int corner = 0; corner < 3; corner++)
+            if (find(newCache, newCache + newEntries, corners[corner]) == newCache + newEntries) newCache[newEntries++] = corners[corner];
+        for (int i = 0; i < cacheEntries; i++)
+            if (find(corners, corners + 3, cache[i]) == corners + 3) newCache[newEntries++] = cache[i];
+        for (int i = forsythCacheSize; i < newEntries; i++) {
+            cachePosition[newCache[i]] = -1;
+            vertexScores[newCache[i]] = scores.vertex(-1, activeFaces[newCache[i]]);
+        }
+        cacheEntries = min(newEntries, forsythCacheSize);
+        for (int i = 0; i < cacheEntries; i++) {
+            cache[i] = newCache[i];
+            cachePosition[cache[i]] = i;
+            vertexScores[cache[i]] = scores.vertex(i, activeFaces[cache[i]]);
+        }
+
+        // only the faces of cached vertices changed score, the next face is the best of them
+        bestFace = -1;
+        bestScore = -1.0f;
+        for (int i = 0; i < cacheEntries; i++) {
+            const int *row = vertexFaces.data() + firstFace[cache[i]];
+            for (int k = 0; k < activeFaces[cache[i]]; k++) {
+                const int *other = faces + (size_t)row[k] * 3;
+                float score = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+                faceScores[row[k]] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestFace = row[k];
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+void optimizeVertexCache(Mesh& mesh)
+{
+    if (mesh.faceCount == 0) return;
+    vector<int> order;
+    forsythOrder(mesh.faces, mesh.faceCount, mesh.vertexCount, order);
+    reorderFaces(mesh, order);
+}
+
+void optimizeVertexCache(Mesh& mesh, const vector<pair<size_t, size_t>>& faceRanges)
+{
+    // each range is ordered over its own vertices, numbered locally so that the work stays proportional to the range
+    vector<int> localIndex(mesh.vertexCount, -1), vertices, localFaces, order;
+    for (const auto& range : faceRanges) {
+        int *faces = mesh.faces + range.first * 3;
+        localFaces.resize(range.second * 3);
+        vertices.clear();
+        for (size_t i = 0; i < range.second * 3; i++) {
+            if (localIndex[faces[i]] < 0) {
+                localIndex[faces[i]] = (int)vertices.size();
+                vertices.push_back(faces[i]);
+            }
+            localFaces[i] = localIndex[faces[i]];
+        }
+        for (int vertex : vertices) localIndex[vertex] = -1;
+        if (range.second == 0) continue;
+
+        forsythOrder(localFaces.data(), range.second, vertices.size(), order);
+        gatherElements(faces, order, 3);
+        if (mesh.faceNormals) gatherElements(mesh.faceNormals + range.first * 3, order, 3);
+        if (mesh.faceAreas) gatherElements(mesh.faceAreas + range.first, order, 1);
+    }
+}
+
+void reorderFaces(Mesh& mesh, const vector<int>& order)
+{
+    gatherElements(mesh.faces, order, 3);
+    if (mesh.faceNormals) gatherElements(mesh.faceNormals, order, 3);
+    if (mesh.faceAreas) gatherElements(mesh.faceAreas, order, 1);
+}
+
+void optimizeVertexFetch(Mesh& mesh)
+{
+    size_t vertexCount = mesh.vertexCount, textureCoordinateCount = mesh.textureCoordinateCount;
+    int *faces = mesh.faces;
+    // vertices with texture coordinates and those without are numbered as two groups when a mesh has both
+    bool grouped = textureCoordinateCount > 0 && textureCoordinateCount < vertexCount;
+    vector<int> order, newIndex(vertexCount, -1);
+    order.reserve(vertexCount);
+    for (int group = 0; group < (grouped ? 2 : 1); group++) {
+        auto inGroup = [&](size_t vertex) { return !grouped || (vertex < textureCoordinateCount) == (group == 0); };
+        for (size_t i = 0; i < mesh.faceCount * 3; i++)
+            if (newIndex[faces[i]] < 0 && inGroup(faces[i])) {
+                newIndex[faces[i]] = (int)order.size();
+                order.push_back(faces[i]);
+            }
+        for (size_t vertex = 0; vertex < vertexCount; vertex++)
+            if (newIndex[vertex] < 0 && inGroup(vertex)) {
+                newIndex[vertex] = (int)order.size();
+                order.push_back((int)vertex);
+            }
+    }
+
+    for (size_t i = 0; i < mesh.faceCount * 3; i++) faces[i] = newIndex[faces[i]];
+    gatherElements(mesh.positions, order, 3);
+    if (mesh.vertexNormals) gatherElements(mesh.vertexNormals, order, 3);
+    if (textureCoordinateCount) {
+        order.resize(textureCoordinateCount);
+        gatherElements(mesh.textureCoordinates, order, 2);
+    }
+}
+
+void copyMeshGeometry(const Mesh& mesh, Mesh& copy)
+{
+    copy.allocate(mesh.vertexCount, mesh.textureCoordinateCount, mesh.faceCount);
+    std::copy(mesh.positions, mesh.positions + mesh.vertexCount * 3, copy.positions);
+    std::copy(mesh.textureCoordinates, mesh.textureCoordinates + mesh.textureCoordinateCount * 2, copy.textureCoordinates);
+    std::copy(mesh.faces, mesh.faces + mesh.faceCount * 3, copy.faces);
+    std::copy(mesh.center, mesh.center + 3, copy.center);
+    copy.diagonalLength = mesh.diagonalLength;
+}
+
+void ComputeBoundingBox(Mesh& mesh)
+{
+    float *vertices = mesh.positions;
+    float minimum[3] = {0, 0, 0}, maximum[3] = {0, 0, 0};
+    size_t done = 0;
+    if (mesh.vertexCount > 0) {
+        for (int axis = 0; axis < 3; axis++) minimum[axis] = maximum[axis] = vertices[axis];
+#ifdef CPU_X86
+        SIMDLevel level = activeSIMDLevel();
+        if (level >= SIMD_AVX2) done = boundsAVX2(vertices, mesh.vertexCount, minimum, maximum);
+        else if (level >= SIMD_SSE41) done = boundsSSE41(vertices, mesh.vertexCount, minimum, maximum);
+#endif
+    }
+    boundsScalar(vertices, done, mesh.vertexCount, minimum, maximum);
+
+    float *center = mesh.center;
+    for (int axis = 0; axis < 3; axis++) center[axis] = (minimum[axis] + maximum[axis]) / 2;
+
+    mesh.diagonalLength = (float)sqrt(pow(maximum[0] - minimum[0], 2.0) + pow(maximum[1] - minimum[1], 2.0) +
+                                      pow(maximum[2] - minimum[2], 2.0));
+
+    // center all the vertices
+    done = 0;
+#ifdef CPU_X86
+    if (activeSIMDLevel() >= SIMD_AVX2) done = translateAVX2(vertices, mesh.vertexCount, center);
+    else if (activeSIMDLevel() >= SIMD_SSE41) done = translateSSE41(vertices, mesh.vertexCount, center);
+#endif
+    for (size_t i = done * 3; i < mesh.vertexCount * 3; i += 3) {
+        vertices[i]   -= center[0];
+        vertices[i+1] -= center[1];
+        vertices[i+2] -= center[2];
+    }
+}
+
+void ComputeFaceNormals(Mesh& mesh)
+{
+    mesh.allocateAttribute(MESH_FACE_NORMALS);
+    mesh.allocateAttribute(MESH_FACE_AREAS);
+    size_t done = 0;
+#ifdef CPU_X86
+    SIMDLevel level = activeSIMDLevel();
+    if (level >= SIMD_AVX2) done = faceNormalsAVX2(mesh.positions, mesh.faces, mesh.faceNormals, mesh.faceAreas, mesh.faceCount);
+    else if (level >= SIMD_SSE41) done = faceNormalsSSE41(mesh.positions, mesh.faces, mesh.faceNormals, mesh.faceAreas, mesh.faceCount);
+#endif
+    faceNormalsScalar(mesh.positions, mesh.faces, mesh.faceNormals, mesh.faceAreas, done, mesh.faceCount);
+}
+
+namespace {
+
+/**
+ * Compute the vertex normals of vertices begin to end from their faces' normals and area weights.
+ * @param row Called with a vertex index, returns the range of its faces.
+ */
+template <typename Row>
+void vertexNormalRange(Mesh& mesh, size_t begin, size_t end, Row row)
+{
+    const float *faceNormals = mesh.faceNormals;
+    const float *faceVolumes = mesh.faceAreas;
+    float *vertexNormals = mesh.vertexNormals;
+    for (size_t i = begin; i < end; i++) {
+        pair<const int *, const int *> faces = row(i);
+        float resultNormalX = 0.0;
+        float resultNormalY = 0.0;
+        float resultNormalZ = 0.0;
+        float totalVolume = 0.0;
+        for (const int *face = faces.first; face < faces.second; face++) totalVolume += faceVolumes[*face];
+        for (const int *face = faces.first; face < faces.second; face++) {
+            resultNormalX += (faceVolumes[*face] / totalVolume) * faceNormals[*face * 3];
+            resultNormalY += (faceVolumes[*face] / totalVolume) * faceNormals[*face * 3 + 1];
+            resultNormalZ += (faceVolumes[*face] / totalVolume) * faceNormals[*face * 3 + 2];
+        }
+        auto resultNormalLength = (float)sqrt(pow(resultNormalX, 2) + pow(resultNormalY, 2) + pow(resultNormalZ, 2));
+        // normalize
+        vertexNormals[i * 3]     = resultNormalX / resultNormalLength;
+        vertexNormals[i * 3 + 1] = resultNormalY / resultNormalLength;
+        vertexNormals[i * 3 + 2] = resultNormalZ / resultNormalLength;
+    }
+}
+
+/**
+ * Gather the faces each vertex is in as compressed sparse rows by a counting sort, then compute the vertex
+ * normals over vertex ranges. Counter is int on one thread and atomic<int> on several.
+ */
+template <typename Counter>
+void vertexNormalsFromRows(Mesh& mesh, unsigned int threadCount)
+{
+    const int *faces = mesh.faces;
+    size_t vertexCount = mesh.vertexCount, cornerCount = mesh.faceCount * 3;
+
+    /**
+    * The faces of vertex v are vertexFaces[firstFace[v]] to vertexFaces[firstFace[v + 1] - 1].
+    * In code example:
+    *      vertexFaces[firstFace[vertex0] + face0]
+    */
+    vector<Counter> firstFace(vertexCount + 1);
+    vector<int> vertexFaces(cornerCount);
+
+    // count the faces of every vertex
+    parallelRanges(cornerCount, threadCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) firstFace[faces[i] + 1]++;
+    });
+    // prefix sum, turning the counts into row starts
+    for (size_t i = 1; i <= vertexCount; i++) firstFace[i] = firstFace[i] + firstFace[i - 1];
+    // place every face in the rows of its vertices, firstFace[v] is advanced to the end of row v meanwhile
+    parallelRanges(cornerCount, threadCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) vertexFaces[firstFace[faces[i]]++] = (int)(i / 3);
+    });
+
+    // every vertex normal only reads its own row, so vertex ranges need no synchronisation
+    parallelRanges(vertexCount, threadCount, [&](size_t begin, size_t end) {
+        vertexNormalRange(mesh, begin, end, [&](size_t i) {
+            // row i now ends where row i + 1 starts, and starts where row i - 1 ends
+            int *row = vertexFaces.data() + (i ? (int)firstFace[i - 1] : 0), *rowEnd = vertexFaces.data() + (int)firstFace[i];
+            // several threads place faces in any order, sum them in face order so the result does not depend on it
+            if (threadCount > 1) sort(row, rowEnd);
+            return make_pair((const int *)row, (const int *)rowEnd);
+        });
+    });
+}
+
+} // namespace
+
+void ComputeVertexNormals(Mesh& mesh, unsigned int threadCount)
+{
+    mesh.allocateAttribute(MESH_VERTEX_NORMALS);
+    if (threadCount == 0) threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = (unsigned int)min<size_t>(threadCount, mesh.vertexCount / minimumVerticesPerThread + 1);
+    if (threadCount > 1) vertexNormalsFromRows<atomic<int>>(mesh, threadCount);
+    else vertexNormalsFromRows<int>(mesh, 1);
+}
+
+const float *requireFaceNormals(Mesh& mesh)
+{
+    if (!mesh.faceNormals) {
+        bool hadAreas = mesh.faceAreas != nullptr;
+        ComputeFaceNormals(mesh);
+        // the areas come with the normals but only the vertex normals need them
+        if (!hadAreas) mesh.releaseAttributes(MESH_FACE_AREAS);
+    }
+    return mesh.faceNormals;
+}
+
+const float *requireVertexNormals(Mesh& mesh, unsigned int threadCount)
+{
+    if (!mesh.vertexNormals) {
+        unsigned int intermediate = ~mesh.attributes() & (MESH_FACE_NORMALS | MESH_FACE_AREAS);
+        if (intermediate) ComputeFaceNormals(mesh);
+        ComputeVertexNormals(mesh, threadCount);
+        mesh.releaseAttributes(intermediate);
+    }
+    return mesh.vertexNormals;
+}
+
+namespace {
+
+// Vertices per leaf of MeshEditor's bounds tree.
+const size_t boundsBlockSize = 64;
+
+} // namespace
+
+MeshEditor::MeshEditor(Mesh& mesh)
+    : mesh(mesh), firstFace(mesh.vertexCount + 1, 0), vertexFaces(mesh.faceCount * 3), faceStamps(mesh.faceCount, 0),
+      vertexStamps(mesh.vertexCount, 0)
+{
+    // counting sort in face order, so each row lists its faces as ComputeVertexNormals sums them
+    const int *faces = mesh.faces;
+    for (size_t i = 0; i < mesh.faceCount * 3; i++) firstFace[faces[i] + 1]++;
+    for (size_t i = 1; i <= mesh.vertexCount; i++) firstFace[i] += firstFace[i - 1];
+    vector<int> next(firstFace.begin(), firstFace.end() - 1);
+    for (size_t i = 0; i < mesh.faceCount * 3; i++) vertexFaces[next[faces[i]]++] = (int)(i / 3);
+
+    // leaves blockCount to 2 * blockCount - 1, node i combines nodes 2i and 2i + 1, node 1 is the whole mesh
+    blockCount = (mesh.vertexCount + boundsBlockSize - 1) / boundsBlockSize;
+    blockStamps.assign(blockCount, 0);
+    blockBounds.assign(max<size_t>(2 * blockCount, 2) * 6, 0.0f);
+    for (size_t block = 0; block < blockCount; block++) updateBlock(block);
+    keepFaceAttributes();
+}
+
+MeshEditor::~MeshEditor()
+{
+    mesh.releaseAttributes(addedAttributes);
+}
+
+float *MeshEditor::editPositions(size_t first, size_t count)
+{
+    markEdited(first, count);
+    return mesh.positions + first * 3;
+}
+
+void MeshEditor::markEdited(size_t first, size_t count)
+{
+    if (count > 0) editedRanges.emplace_back(first, count);
+}
+
+void MeshEditor::updateBlock(size_t block)
+{
+    float *node = blockBounds.data() + (blockCount + block) * 6;
+    const float *vertices = mesh.positions;
+    size_t first = block * boundsBlockSize, end = min(first + boundsBlockSize, mesh.vertexCount);
+    for (int axis = 0; axis < 3; axis++) node[axis] = node[3 + axis] = vertices[first * 3 + axis];
+    boundsScalar(vertices, first + 1, end, node, node + 3);
+
+    // the ancestors up to the root
+    for (size_t i = (blockCount + block) / 2; i >= 1; i /= 2) {
+        float *parent = blockBounds.data() + i * 6;
+        const float *left = blockBounds.data() + 2 * i * 6, *right = left + 6;
+        for (int axis = 0; axis < 3; axis++) {
+            parent[axis] = min(left[axis], right[axis]);
+            parent[3 + axis] = max(left[3 + axis], right[3 + axis]);
+        }
+    }
+}
+
+void MeshEditor::keepFaceAttributes()
+{
+    // vertex normals are averaged from the face normals and areas of every face around a vertex, so while the mesh
+    // has either kind of normals both face attributes are kept for all faces
+    if ((mesh.faceNormals || mesh.vertexNormals) && (!mesh.faceNormals || !mesh.faceAreas)) {
+        addedAttributes |= ~mesh.attributes() & (MESH_FACE_NORMALS | MESH_FACE_AREAS);
+        ComputeFaceNormals(mesh);
+    }
+}
+
+void MeshEditor::update()
+{
+    if (editedRanges.empty()) return;
+    // normals computed since the last update need the face attributes too
+    keepFaceAttributes();
+    if (++stamp == 0) {
+        fill(faceStamps.begin(), faceStamps.end(), 0);
+        fill(vertexStamps.begin(), vertexStamps.end(), 0);
+        fill(blockStamps.begin(), blockStamps.end(), 0);
+        stamp = 1;
+    }
+
+    // the faces around the edited vertices, and the blocks of the bounds tree they are in
+    editedFaces.clear();
+    for (const pair<size_t, size_t>& range : editedRanges) {
+        for (size_t vertex = range.first; vertex < range.first + range.second; vertex++)
+            for (int i = firstFace[vertex]; i < firstFace[vertex + 1]; i++) {
+                int face = vertexFaces[i];
+                if (faceStamps[face] == stamp) continue;
+                faceStamps[face] = stamp;
+                editedFaces.push_back(face);
+            }
+        for (size_t block = range.first / boundsBlockSize; block <= (range.first + range.second - 1) / boundsBlockSize; block++)
+            if (blockStamps[block] != stamp) {
+                blockStamps[block] = stamp;
+                updateBlock(block);
+            }
+    }
+    editedRanges.clear();
+    if (!mesh.faceNormals) return;
+
+    for (int face : editedFaces)
+        faceNormalsScalar(mesh.positions, mesh.faces, mesh.faceNormals, mesh.faceAreas, (size_t)face, (size_t)face + 1);
+    if (!mesh.vertexNormals) return;
+
+    // the vertex normals of the one-ring: every vertex of a face that changed
+    for (int face : editedFaces)
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = mesh.faces[face * 3 + corner];
+            if (vertexStamps[vertex] == stamp) continue;
+            vertexStamps[vertex] = stamp;
+            vertexNormalRange(mesh, (size_t)vertex, (size_t)vertex + 1, [&](size_t i) {
+                return make_pair((const int *)vertexFaces.data() + firstFace[i], (const int *)vertexFaces.data() + firstFace[i + 1]);
+            });
+        }
+}
+
+void MeshEditor::bounds(float *minimum, float *maximum) const
+{
+    for (int axis = 0; axis < 3; axis++) {
+        minimum[axis] = blockBounds[6 + axis];
+        maximum[axis] = blockBounds[6 + 3 + axis];
+    }
+}
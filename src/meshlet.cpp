@@ -0,0 +1,236 @@
+// Meshlets and their culling, see meshlet.h.
+
+#include <algorithm>
+#include <cmath>
+
+#include "../include/meshlet.h"
+#include "../include/meshProcessing.h"
+
+using namespace std;
+
+namespace {
+
+// How much buildMeshlets() prefers a face adding no vertex over one agreeing better with the meshlet's normals.
+float meshletVertexWeight = 0.5f;
+
+// Bounding sphere (around the box center) and normal cone of a meshlet's faces.
+void meshletBounds(const Mesh& mesh, Meshlet& meshlet)
+{
+    const float *positions = mesh.positions;
+    const int *faces = mesh.faces + (size_t)meshlet.firstFace * 3;
+    float minimum[3], maximum[3];
+    for (int axis = 0; axis < 3; axis++) minimum[axis] = maximum[axis] = positions[faces[0] * 3 + axis];
+    for (size_t corner = 0; corner < meshlet.faceCount * 3; corner++)
+        for (int axis = 0; axis < 3; axis++) {
+            minimum[axis] = min(minimum[axis], positions[faces[corner] * 3 + axis]);
+            maximum[axis] = max(maximum[axis], positions[faces[corner] * 3 + axis]);
+        }
+    float radius = 0.0f;
+    for (int axis = 0; axis < 3; axis++) meshlet.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+    for (size_t corner = 0; corner < meshlet.faceCount * 3; corner++) {
+        const float *p = positions + faces[corner] * 3;
+        float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radius = max(radius, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = sqrtf(radius);
+
+    // faces without area have no normal and do not widen the cone
+    const float *normals = mesh.faceNormals + (size_t)meshlet.firstFace * 3;
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t face = 0; face < meshlet.faceCount; face++)
+        for (int i = 0; i < 3; i++) axis[i] += normals[face * 3 + i];
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float smallestCosine = length > 0.0f ? 1.0f : -1.0f;
+    for (int i = 0; i < 3; i++) meshlet.coneAxis[i] = length > 0.0f ? axis[i] / length : 0.0f;
+    for (size_t face = 0; face < meshlet.faceCount; face++) {
+        const float *n = normals + face * 3;
+        if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] < 0.5f) continue;
+        smallestCosine = min(smallestCosine, n[0] * meshlet.coneAxis[0] + n[1] * meshlet.coneAxis[1] + n[2] * meshlet.coneAxis[2]);
+    }
+    meshlet.coneCutoff = smallestCosine > 0.0f ? sqrtf(1.0f - smallestCosine * smallestCosine) : 1.0f;
+}
+
+} // namespace
+
+void buildMeshlets(Mesh& mesh, vector<Meshlet>& meshlets)
+{
+    meshlets.clear();
+    bool hadFaceNormals = mesh.faceNormals != nullptr;
+    const float *normals = requireFaceNormals(mesh);
+    size_t faceCount = mesh.faceCount, vertexCount = mesh.vertexCount;
+    const int *faces = mesh.faces;
+
+    // the faces of each vertex in compressed sparse rows
+    vector<int> firstFace(vertexCount + 1, 0), vertexFaces(faceCount * 3);
+    for (size_t i = 0; i < faceCount * 3; i++) firstFace[faces[i] + 1]++;
+    for (size_t i = 0; i < vertexCount; i++) firstFace[i + 1] += firstFace[i];
+    vector<int> next(firstFace.begin(), firstFace.end() - 1);
+    for (size_t i = 0; i < faceCount * 3; i++) vertexFaces[next[faces[i]]++] = (int)(i / 3);
+
+    // a meshlet grows from the first face left over the faces around its vertices, taking the face that agrees
+    // best with its normals and adds the fewest vertices; faces facing away from its normals are left for another,
+    // so that its cone stays narrow enough to be culled
+    vector<unsigned int> seenIn(vertexCount, ~0u), candidateIn(faceCount, ~0u);
+    vector<char> assigned(faceCount, 0);
+    vector<int> order, candidates;
+    order.reserve(faceCount);
+    size_t seed = 0;
+    while (order.size() < faceCount) {
+        while (assigned[seed]) seed++;
+        auto id = (unsigned int)meshlets.size();
+        Meshlet meshlet = {};
+        meshlet.firstFace = (unsigned int)order.size();
+        float axis[3] = {0.0f, 0.0f, 0.0f};
+        candidates.assign(1, (int)seed);
+        candidateIn[seed] = id;
+        while (meshlet.faceCount < MESHLET_MAX_FACES) {
+            float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+            int best = -1;
+            unsigned int bestAdded = 0;
+            float bestScore = 0.0f;
+            for (size_t k = 0; k < candidates.size();) {
+                int face = candidates[k];
+                if (assigned[face]) {
+                    candidates[k] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                k++;
+                const int *corners = faces + (size_t)face * 3;
+                unsigned int added = 0;
+                for (int corner = 0; corner < 3; corner++)
+                    if (seenIn[corners[corner]] != id && find(corners, corners + corner, corners[corner]) == corners + corner) added++;
+                if (meshlet.vertexCount + added > MESHLET_MAX_VERTICES) continue;
+                const float *n = normals + (size_t)face * 3;
+                float agreement = axisLength > 0.0f ? (n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]) / axisLength : 1.0f;
+                if (agreement < 0.0f) continue;
+                float score = agreement - meshletVertexWeight * added;
+                if (best < 0 || score > bestScore) {
+                    best = face;
+                    bestAdded = added;
+                    bestScore = score;
+                }
+            }
+            if (best < 0) break;
+
+            assigned[best] = 1;
+            order.push_back(best);
+            meshlet.faceCount++;
+            meshlet.vertexCount += bestAdded;
+            for (int i = 0; i < 3; i++) axis[i] += normals[(size_t)best * 3 + i];
+            for (int corner = 0; corner < 3; corner++) {
+                int vertex = faces[(size_t)best * 3 + corner];
+                seenIn[vertex] = id;
+                for (int k = firstFace[vertex]; k < firstFace[vertex + 1]; k++)
+                    if (!assigned[vertexFaces[k]] && candidateIn[vertexFaces[k]] != id) {
+                        candidateIn[vertexFaces[k]] = id;
+                        candidates.push_back(vertexFaces[k]);
+                    }
+            }
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    // each meshlet becomes a range of the faces, ordered for the vertex cache again within it
+    reorderFaces(mesh, order);
+    vector<pair<size_t, size_t>> ranges;
+    for (const Meshlet& meshlet : meshlets) ranges.push_back({meshlet.firstFace, meshlet.faceCount});
+    optimizeVertexCache(mesh, ranges);
+    for (Meshlet& meshlet : meshlets) meshletBounds(mesh, meshlet);
+    if (!hadFaceNormals) mesh.releaseAttributes(MESH_FACE_NORMALS);
+}
+
+void meshletViewFromMatrices(const float *modelview, const float *projection, MeshletView& view)
+{
+    // clip = projection * modelview, whichever of them holds the camera
+    double clip[16];
+    for (int column = 0; column < 4; column++)
+        for (int row = 0; row < 4; row++) {
+            clip[column * 4 + row] = 0.0;
+            for (int k = 0; k < 4; k++) clip[column * 4 + row] += (double)projection[k * 4 + row] * modelview[column * 4 + k];
+        }
+
+    // the camera is the point that a perspective projection maps to clip x = y = w = 0, solved by Cramer's rule
+    const int rows[3] = {0, 1, 3};
+    double a[3][3], b[3];
+    for (int i = 0; i < 3; i++) {
+        for (int column = 0; column < 3; column++) a[i][column] = clip[column * 4 + rows[i]];
+        b[i] = -clip[12 + rows[i]];
+    }
+    auto determinant = [](const double (*m)[3]) {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    };
+    double whole = determinant(a);
+    for (int column = 0; column < 3; column++) {
+        double replaced[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int k = 0; k < 3; k++) replaced[i][k] = k == column ? b[i] : a[i][k];
+        view.camera[column] = (float)(determinant(replaced) / whole);
+    }
+
+    // the frustum planes are the sums and differences of its rows (Gribb and Hartmann)
+    for (int plane = 0; plane < 6; plane++) {
+        int row = plane / 2;
+        double sign = plane % 2 ? -1.0 : 1.0, coefficients[4];
+        for (int column = 0; column < 4; column++) coefficients[column] = clip[column * 4 + 3] + sign * clip[column * 4 + row];
+        double length = sqrt(coefficients[0] * coefficients[0] + coefficients[1] * coefficients[1] + coefficients[2] * coefficients[2]);
+        for (int i = 0; i < 4; i++) view.planes[plane][i] = (float)(coefficients[i] / length);
+    }
+}
+
+bool isMeshletVisible(const Meshlet& meshlet, const MeshletView& view)
+{
+    const float *center = meshlet.center;
+    for (const float *plane : view.planes)
+        if (plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] < -meshlet.radius) return false;
+    if (!view.backFacesCulled) return true;
+
+    // every face faces away if the cone, widened by the angle the sphere spans, stays behind the view direction
+    float toCenter[3] = {center[0] - view.camera[0], center[1] - view.camera[1], center[2] - view.camera[2]};
+    float distance = sqrtf(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+    float along = toCenter[0] * meshlet.coneAxis[0] + toCenter[1] * meshlet.coneAxis[1] + toCenter[2] * meshlet.coneAxis[2];
+    return along < meshlet.coneCutoff * distance + meshlet.radius;
+}
+
+size_t cullMeshlets(const vector<Meshlet>& meshlets, const MeshletView& view, vector<pair<size_t, size_t>>& ranges)
+{
+    ranges.clear();
+    size_t faces = 0;
+    for (const Meshlet& meshlet : meshlets) {
+        if (!isMeshletVisible(meshlet, view)) continue;
+        if (!ranges.empty() && ranges.back().first + ranges.back().second == meshlet.firstFace)
+            ranges.back().second += meshlet.faceCount;
+        else
+            ranges.emplace_back(meshlet.firstFace, meshlet.faceCount);
+        faces += meshlet.faceCount;
+    }
+    return faces;
+}
+
+size_t countVisibleFaces(const Mesh& mesh, size_t firstFace, size_t faceCount, const MeshletView& view)
+{
+    size_t visible = 0;
+    for (size_t face = firstFace; face < firstFace + faceCount; face++) {
+        const float *p[3];
+        for (int corner = 0; corner < 3; corner++) p[corner] = mesh.positions + mesh.faces[face * 3 + corner] * 3;
+        float e1[3], e2[3], toCamera[3];
+        for (int axis = 0; axis < 3; axis++) {
+            e1[axis] = p[1][axis] - p[0][axis];
+            e2[axis] = p[2][axis] - p[0][axis];
+            toCamera[axis] = view.camera[axis] - p[0][axis];
+        }
+        float facing = (e1[1] * e2[2] - e1[2] * e2[1]) * toCamera[0] + (e1[2] * e2[0] - e1[0] * e2[2]) * toCamera[1] +
+                       (e1[0] * e2[1] - e1[1] * e2[0]) * toCamera[2];
+        if (facing <= 0.0f && view.backFacesCulled) continue;
+        bool outside = false;
+        for (int plane = 0; plane < 6 && !outside; plane++) {
+            const float *q = view.planes[plane];
+            outside = true;
+            for (int corner = 0; corner < 3 && outside; corner++)
+                outside = q[0] * p[corner][0] + q[1] * p[corner][1] + q[2] * p[corner][2] + q[3] < 0.0f;
+        }
+        if (!outside) visible++;
+    }
+    return visible;
+}
@@ -0,0 +1,635 @@
+// In-place OBJ tokenizer. No per-line strings or streams are created, numbers are converted by hand.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "../include/mappedFile.h"
+#include "../include/objLoader.h"
+
+namespace {
+
+enum LineType { LINE_OTHER, LINE_VERTEX, LINE_TEXTURE_COORDINATE, LINE_FACE };
+
+const double exactPowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+// '\r' is treated as the end of a line so that files with Windows line endings parse the same way.
+inline bool isLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+inline const char *skipBlanks(const char *p, const char *end)
+{
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+inline const char *nextLine(const char *p, const char *end)
+{
+    auto *newLine = (const char *)memchr(p, '\n', (size_t)(end - p));
+    return newLine ? newLine + 1 : end;
+}
+
+/**
+ * Classify a line by its keyword.
+ * @param content Set to the first character after the keyword.
+ */
+inline LineType lineType(const char *p, const char *end, const char *&content)
+{
+    if (end - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+        content = p + 2;
+        return LINE_VERTEX;
+    }
+    if (end - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+        content = p + 2;
+        return LINE_FACE;
+    }
+    if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2])) {
+        content = p + 3;
+        return LINE_TEXTURE_COORDINATE;
+    }
+    return LINE_OTHER;
+}
+
+/**
+ * Read a decimal floating point number such as "-3.4101800e-003".
+ * Up to 19 significant digits are accumulated in an integer and scaled once by an exact power of 10,
+ * so ordinary OBJ values round the same way a stream extraction does.
+ * @return The character after the number; p itself (with value 0) if there is no number.
+ */
+inline const char *parseFloat(const char *p, const char *end, float& value)
+{
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool hasDigits = false;
+    for (; p < end && isDigit(*p); p++) {
+        hasDigits = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) digits++;
+        }
+        else exponent++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isDigit(*p); p++) {
+            hasDigits = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+    if (!hasDigits) {
+        value = 0.0f;
+        return start;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) negativeExponent = (*q++ == '-');
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); q++) if (e < 10000) e = e * 10 + (*q - '0');
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result = (double)mantissa;
+    if (exponent < 0 && exponent >= -22) result /= exactPowersOf10[-exponent];
+    else if (exponent > 0 && exponent <= 22) result *= exactPowersOf10[exponent];
+    else if (exponent != 0) result *= pow(10.0, exponent);
+    value = (float)(negative ? -result : result);
+    return p;
+}
+
+/**
+ * Read a decimal integer with an optional sign.
+ * @return The character after the number; p itself if there is no number.
+ */
+inline const char *parseInt(const char *p, const char *end, int& value)
+{
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+    if (p == end || !isDigit(*p)) return start;
+
+    int result = 0;
+    for (; p < end && isDigit(*p); p++) result = result * 10 + (*p - '0');
+    value = negative ? -result : result;
+    return p;
+}
+
+// Count the vertex entries of a face line, stopping at a comment or the end of line.
+inline int countFaceEntries(const char *p, const char *end)
+{
+    int entries = 0;
+    while (true) {
+        p = skipBlanks(p, end);
+        if (p == end || isLineEnd(*p) || *p == '#') return entries;
+        entries++;
+        while (p < end && !isBlank(*p) && !isLineEnd(*p) && *p != '#') p++;
+    }
+}
+
+/**
+ * Read the vertex indices of a face line and output its fan triangulation.
+ * A vertex index is the number at the start of each blank separated entry,
+ * texture and normal indices after a '/' are ignored.
+ * From the third vertex of a face on output one triangle per vertex, that
+ * being the next triangle in a fan triangulation of the face about the first vertex.
+ * @param p First character after the "f" keyword.
+ * @param vertexBase Number of vertices defined before this line, used to resolve negative (relative) indices.
+ * @param emitTriangle Called with the 3 0-based vertex indices of every triangle.
+ */
+template <typename EmitTriangle>
+void parseFaceLine(const char *p, const char *end, size_t vertexBase, EmitTriangle emitTriangle)
+{
+    int count = 0, vertexIndex1 = 0, vertexIndex2 = 0, vertexIndex3 = 0, index = 0;
+    while (true) {
+        p = skipBlanks(p, end);
+        if (p == end || isLineEnd(*p) || *p == '#') break; // stop processing line at comment
+
+        const char *afterIndex = parseInt(p, end, index);
+        if (afterIndex == p) break; // not a vertex index, the rest of the line is malformed
+        // make the index range start from 0, negative indices count back from the latest vertex
+        index = index < 0 ? (int)vertexBase + index : index - 1;
+
+        if (count == 0) vertexIndex1 = index;
+        else if (count == 1) vertexIndex2 = index;
+        else {
+            if (count > 2) vertexIndex2 = vertexIndex3;
+            vertexIndex3 = index;
+            emitTriangle(vertexIndex1, vertexIndex2, vertexIndex3);
+        }
+        count++;
+
+        // skip the "/vt/vn" part of the entry
+        p = afterIndex;
+        while (p < end && !isBlank(*p) && !isLineEnd(*p) && *p != '#') p++;
+    }
+}
+
+/**
+ * Number of records in a range of lines, used to place each chunk's output.
+ */
+struct ChunkCounts
+{
+    size_t vertices = 0;
+    size_t textureCoordinates = 0;
+    size_t triangles = 0;
+};
+
+ChunkCounts countChunk(const char *begin, const char *end)
+{
+    ChunkCounts counts;
+    const char *content;
+    for (const char *line = begin; line < end; line = nextLine(line, end)) {
+        switch (lineType(line, end, content)) {
+            case LINE_VERTEX: counts.vertices++; break;
+            case LINE_TEXTURE_COORDINATE: counts.textureCoordinates++; break;
+            case LINE_FACE: {
+                int entries = countFaceEntries(content, end);
+                if (entries > 2) counts.triangles += entries - 2;
+                break;
+            }
+            default: break;
+        }
+    }
+    return counts;
+}
+
+/**
+ * Parse a range of whole lines into pre-sized output arrays.
+ * @param vertexBase Number of vertices defined before this range, used to resolve negative (relative) face indices.
+ * @return Number of triangles written, lower than counted if a face line is malformed.
+ */
+size_t parseChunk(const char *begin, const char *end, size_t vertexBase,
+                  float *vertexOut, float *textureCoordinateOut, int *faceOut)
+{
+    int *faceBegin = faceOut;
+    for (const char *line = begin; line < end; line = nextLine(line, end)) {
+        const char *p;
+        switch (lineType(line, end, p)) {
+            case LINE_VERTEX:
+                // Read x, y and z values. The (optional) w value is not read.
+                for (int count = 0; count < 3; count++) p = parseFloat(skipBlanks(p, end), end, *vertexOut++);
+                vertexBase++;
+                break;
+
+            case LINE_TEXTURE_COORDINATE:
+                for (int count = 0; count < 2; count++) p = parseFloat(skipBlanks(p, end), end, *textureCoordinateOut++);
+                break;
+
+            case LINE_FACE:
+                parseFaceLine(p, end, vertexBase, [&faceOut](int vertexIndex1, int vertexIndex2, int vertexIndex3) {
+                    *faceOut++ = vertexIndex1;
+                    *faceOut++ = vertexIndex2;
+                    *faceOut++ = vertexIndex3;
+                });
+                break;
+
+            default: break;
+        }
+    }
+    return (size_t)(faceOut - faceBegin) / 3;
+}
+
+// Files smaller than this per thread are not worth splitting.
+const size_t minimumChunkSize = 1 << 20;
+
+bool seekTo(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/**
+ * Appends to a backing file through a fixed-size buffer.
+ */
+class SpillWriter
+{
+public:
+    ~SpillWriter() { close(); }
+
+    bool open(const std::string& fileName, size_t bufferSize)
+    {
+        file = fopen(fileName.c_str(), "wb");
+        buffer.resize(std::max<size_t>(bufferSize, 4096));
+        return file != nullptr;
+    }
+
+    void append(const void *data, size_t size)
+    {
+        if (used + size > buffer.size()) flush();
+        memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+
+    // Write out the buffer, so that everything appended so far can be read from the file.
+    void flush()
+    {
+        if (used && fwrite(buffer.data(), 1, used, file) != used) failed = true;
+        fflush(file);
+        used = 0;
+    }
+
+    bool close()
+    {
+        if (!file) return !failed;
+        flush();
+        failed = fclose(file) != 0 || failed;
+        file = nullptr;
+        return !failed;
+    }
+
+private:
+    FILE *file = nullptr;
+    std::vector<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+};
+
+/**
+ * Random access to vertices already written to the vertex backing file, through a fixed number of
+ * direct-mapped blocks of consecutive vertices.
+ */
+class VertexBlockCache
+{
+public:
+    ~VertexBlockCache() { if (file) fclose(file); }
+
+    bool open(const std::string& fileName, size_t cacheSize)
+    {
+        file = fopen(fileName.c_str(), "rb");
+        size_t blocks = std::max<size_t>(cacheSize / (blockVertices * 12), 1);
+        storage.resize(blocks * blockVertices * 3);
+        tags.assign(blocks, SIZE_MAX);
+        validVertices.assign(blocks, 0);
+        return file != nullptr;
+    }
+
+    // Forget blocks that were read before more vertices were flushed to the file.
+    void invalidatePartialBlocks()
+    {
+        for (size_t slot = 0; slot < tags.size(); slot++)
+            if (validVertices[slot] < blockVertices) tags[slot] = SIZE_MAX;
+    }
+
+    /**
+     * @return The 3 coordinates of a vertex, nullptr if it is not in the file.
+     */
+    const float *vertex(size_t index)
+    {
+        size_t block = index / blockVertices, slot = block % tags.size(), offset = index % blockVertices;
+        if (tags[slot] != block || offset >= validVertices[slot]) {
+            float *blockData = &storage[slot * blockVertices * 3];
+            tags[slot] = block;
+            validVertices[slot] = seekTo(file, (uint64_t)block * blockVertices * 12)
+                                  ? fread(blockData, 12, blockVertices, file) : 0;
+            if (offset >= validVertices[slot]) return nullptr;
+        }
+        return &storage[(slot * blockVertices + offset) * 3];
+    }
+
+private:
+    static const size_t blockVertices = 1024;
+    FILE *file = nullptr;
+    std::vector<float> storage;
+    std::vector<size_t> tags;
+    std::vector<size_t> validVertices;
+};
+
+// Unit normal of a triangle, computed the same way as ComputeFaceNormals().
+void triangleNormal(const float *firstPoint, const float *secondPoint, const float *thirdPoint, float *normal)
+{
+    float firstVector[3], secondVector[3];
+    for (int i = 0; i < 3; i++) {
+        firstVector[i] = secondPoint[i] - firstPoint[i];
+        secondVector[i] = thirdPoint[i] - secondPoint[i];
+    }
+    float x = firstVector[1] * secondVector[2] - firstVector[2] * secondVector[1];
+    float y = firstVector[2] * secondVector[0] - firstVector[0] * secondVector[2];
+    float z = firstVector[0] * secondVector[1] - firstVector[1] * secondVector[0];
+    double length = sqrt(pow(x, 2) + pow(y, 2) + pow(z, 2));
+    normal[0] = (float)(x / length);
+    normal[1] = (float)(y / length);
+    normal[2] = (float)(z / length);
+}
+
+/**
+ * Where parsing writes its records, sized by the counting pass.
+ */
+struct OutputArrays
+{
+    float *vertices;
+    float *textureCoordinates;
+    int *faces;
+};
+
+/**
+ * Count the records of OBJ text, let allocate() provide arrays for them, then parse into the arrays.
+ * With more than one thread the text is split at line boundaries into one chunk per thread, every chunk is
+ * counted and parsed on its own thread, and prefix sums of the chunk counts place each chunk's records.
+ * @param allocate Called once as allocate(vertexCount, textureCoordinateCount, triangleCount), returns OutputArrays.
+ * @return Number of triangles written, lower than counted if a face line is malformed.
+ */
+template <typename Allocate>
+size_t parseOBJInto(const char *begin, const char *end, unsigned int threadCount, Allocate allocate)
+{
+    if (threadCount <= 1) {
+        // counting pass, so that the arrays are allocated exactly once
+        ChunkCounts counts = countChunk(begin, end);
+        OutputArrays out = allocate(counts.vertices, counts.textureCoordinates, counts.triangles);
+        return parseChunk(begin, end, 0, out.vertices, out.textureCoordinates, out.faces);
+    }
+
+    // split into chunks of roughly equal size, moving each split point forward to the next line start
+    std::vector<const char *> splits(threadCount + 1, end);
+    splits[0] = begin;
+    size_t chunkSize = (size_t)(end - begin) / threadCount;
+    for (unsigned int i = 1; i < threadCount; i++) {
+        const char *split = std::max(splits[i - 1], begin + chunkSize * i);
+        splits[i] = split == begin ? begin : nextLine(split - 1, end);
+    }
+
+    // count every chunk in parallel
+    std::vector<ChunkCounts> counts(threadCount);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back([&, i] { counts[i] = countChunk(splits[i], splits[i + 1]); });
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+
+    // prefix sums give each chunk the place of its records in the whole file
+    std::vector<ChunkCounts> offsets(threadCount + 1);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        offsets[i + 1].vertices = offsets[i].vertices + counts[i].vertices;
+        offsets[i + 1].textureCoordinates = offsets[i].textureCoordinates + counts[i].textureCoordinates;
+        offsets[i + 1].triangles = offsets[i].triangles + counts[i].triangles;
+    }
+    OutputArrays out = allocate(offsets[threadCount].vertices, offsets[threadCount].textureCoordinates,
+                                offsets[threadCount].triangles);
+
+    // parse every chunk in parallel, straight into its slice of the output arrays
+    std::vector<size_t> parsedTriangles(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back([&, i] {
+            parsedTriangles[i] = parseChunk(splits[i], splits[i + 1], offsets[i].vertices,
+                                            out.vertices + offsets[i].vertices * 3,
+                                            out.textureCoordinates + offsets[i].textureCoordinates * 2,
+                                            out.faces + offsets[i].triangles * 3);
+        });
+    for (std::thread& worker : workers) worker.join();
+
+    // close the gaps left by malformed face lines
+    size_t triangles = parsedTriangles[0];
+    for (unsigned int i = 1; i < threadCount; i++) {
+        if (triangles != offsets[i].triangles)
+            memmove(out.faces + triangles * 3, out.faces + offsets[i].triangles * 3, parsedTriangles[i] * 3 * sizeof(int));
+        triangles += parsedTriangles[i];
+    }
+    return triangles;
+}
+
+// One parsing thread per MB of text, at most one per core.
+unsigned int parsingThreads(size_t fileSize)
+{
+    auto threadCount = std::max(1u, std::thread::hardware_concurrency());
+    return (unsigned int)std::min<size_t>(threadCount, fileSize / minimumChunkSize + 1);
+}
+
+} // namespace
+
+void parseOBJ(const char *begin, const char *end, std::vector<float>& vertices,
+              std::vector<float>& textureCoordinates, std::vector<int>& faces)
+{
+    parseOBJParallel(begin, end, 1, vertices, textureCoordinates, faces);
+}
+
+void parseOBJParallel(const char *begin, const char *end, unsigned int threadCount, std::vector<float>& vertices,
+                      std::vector<float>& textureCoordinates, std::vector<int>& faces)
+{
+    size_t triangles = parseOBJInto(begin, end, threadCount, [&](size_t vertexCount, size_t textureCoordinateCount,
+                                                                  size_t triangleCount) {
+        vertices.resize(vertexCount * 3);
+        textureCoordinates.resize(textureCoordinateCount * 2);
+        faces.resize(triangleCount * 3);
+        return OutputArrays{vertices.data(), textureCoordinates.data(), faces.data()};
+    });
+    faces.resize(triangles * 3);
+}
+
+bool loadOBJFile(const std::string& fileName, std::vector<float>& vertices,
+                 std::vector<float>& textureCoordinates, std::vector<int>& faces, unsigned int threadCount)
+{
+    vertices.clear();
+    textureCoordinates.clear();
+    faces.clear();
+
+    MappedFile file;
+    if (!file.open(fileName)) return false;
+
+    if (threadCount == 0) threadCount = parsingThreads(file.size());
+    parseOBJParallel(file.data(), file.data() + file.size(), threadCount, vertices, textureCoordinates, faces);
+    return true;
+}
+
+bool loadOBJFile(const std::string& fileName, Mesh& mesh, unsigned int threadCount)
+{
+    MappedFile file;
+    if (!file.open(fileName)) return false;
+
+    if (threadCount == 0) threadCount = parsingThreads(file.size());
+    Mesh loaded;
+    loaded.faceCount = parseOBJInto(file.data(), file.data() + file.size(), threadCount,
+                                    [&loaded](size_t vertexCount, size_t textureCoordinateCount, size_t triangleCount) {
+        loaded.allocate(vertexCount, textureCoordinateCount, triangleCount);
+        return OutputArrays{loaded.positions, loaded.textureCoordinates, loaded.faces};
+    });
+    mesh = std::move(loaded);
+    return true;
+}
+
+StreamedMesh::~StreamedMesh()
+{
+    vertices.close();
+    textureCoordinates.close();
+    faces.close();
+    faceNormals.close();
+    for (const std::string& fileName : backingFileNames) remove(fileName.c_str());
+}
+
+bool streamOBJFile(const std::string& fileName, size_t memoryBudget, StreamedMesh& mesh,
+                   const std::string& temporaryDirectory)
+{
+    FILE *input = fopen(fileName.c_str(), "rb");
+    if (!input) return false;
+
+    // 15/32 of the budget go to the read window, the write buffers and the vertex cache; the rest is left for the
+    // parser's state, the stdio buffers and the memory of the process around the loader
+    memoryBudget = std::max<size_t>(memoryBudget, 1 << 20);
+    std::vector<char> window(memoryBudget / 8);
+    static std::atomic<unsigned int> streamCount(0);
+    std::string prefix = temporaryDirectory + "/objstream_" +
+                         std::to_string((unsigned long long)(uintptr_t)&mesh) + "_" + std::to_string(streamCount++);
+    const char *kinds[4] = {"_vertices.tmp", "_texcoords.tmp", "_faces.tmp", "_normals.tmp"};
+    mesh.backingFileNames.clear();
+    for (const char *kind : kinds) mesh.backingFileNames.push_back(prefix + kind);
+    SpillWriter vertexWriter, textureCoordinateWriter, faceWriter, normalWriter;
+    VertexBlockCache vertexCache;
+    bool opened = vertexWriter.open(mesh.backingFileNames[0], memoryBudget / 16) &&
+                  textureCoordinateWriter.open(mesh.backingFileNames[1], memoryBudget / 32) &&
+                  faceWriter.open(mesh.backingFileNames[2], memoryBudget / 16) &&
+                  normalWriter.open(mesh.backingFileNames[3], memoryBudget / 16) &&
+                  vertexCache.open(mesh.backingFileNames[0], memoryBudget / 8);
+    if (!opened) {
+        fclose(input);
+        return false;
+    }
+
+    size_t vertexCount = 0, textureCoordinateCount = 0, triangleCount = 0, flushedVertexCount = 0;
+    float minimum[3] = {0.0f, 0.0f, 0.0f}, maximum[3] = {0.0f, 0.0f, 0.0f};
+    bool lineTooLong = false;
+    size_t carried = 0; // bytes of an incomplete last line moved to the start of the window
+    while (true) {
+        size_t read = fread(window.data() + carried, 1, window.size() - carried, input);
+        const char *begin = window.data(), *end = begin + carried + read;
+        bool lastWindow = read == 0 || feof(input);
+        // only whole lines are parsed, unless this is the end of the file
+        const char *parseEnd = end;
+        if (!lastWindow) {
+            while (parseEnd > begin && parseEnd[-1] != '\n') parseEnd--;
+            if (parseEnd == begin) {
+                lineTooLong = true;
+                break;
+            }
+        }
+
+        for (const char *line = begin; line < parseEnd; line = nextLine(line, parseEnd)) {
+            const char *p;
+            switch (lineType(line, parseEnd, p)) {
+                case LINE_VERTEX: {
+                    float vertex[3];
+                    for (int count = 0; count < 3; count++) p = parseFloat(skipBlanks(p, parseEnd), parseEnd, vertex[count]);
+                    for (int i = 0; i < 3; i++) {
+                        if (vertexCount == 0 || vertex[i] < minimum[i]) minimum[i] = vertex[i];
+                        if (vertexCount == 0 || vertex[i] > maximum[i]) maximum[i] = vertex[i];
+                    }
+                    vertexWriter.append(vertex, sizeof(vertex));
+                    vertexCount++;
+                    break;
+                }
+                case LINE_TEXTURE_COORDINATE: {
+                    float textureCoordinate[2];
+                    for (int count = 0; count < 2; count++)
+                        p = parseFloat(skipBlanks(p, parseEnd), parseEnd, textureCoordinate[count]);
+                    textureCoordinateWriter.append(textureCoordinate, sizeof(textureCoordinate));
+                    textureCoordinateCount++;
+                    break;
+                }
+                case LINE_FACE:
+                    // the normals need every vertex defined so far to be readable from the backing file
+                    if (flushedVertexCount != vertexCount) {
+                        vertexWriter.flush();
+                        vertexCache.invalidatePartialBlocks();
+                        flushedVertexCount = vertexCount;
+                    }
+                    parseFaceLine(p, parseEnd, vertexCount, [&](int vertexIndex1, int vertexIndex2, int vertexIndex3) {
+                        int triangle[3] = {vertexIndex1, vertexIndex2, vertexIndex3};
+                        float normal[3] = {0.0f, 0.0f, 0.0f};
+                        float points[3][3];
+                        bool valid = true;
+                        for (int i = 0; i < 3 && valid; i++) {
+                            const float *point = triangle[i] >= 0 ? vertexCache.vertex((size_t)triangle[i]) : nullptr;
+                            valid = point != nullptr;
+                            if (valid) memcpy(points[i], point, sizeof(points[i]));
+                        }
+                        if (valid) triangleNormal(points[0], points[1], points[2], normal);
+                        faceWriter.append(triangle, sizeof(triangle));
+                        normalWriter.append(normal, sizeof(normal));
+                        triangleCount++;
+                    });
+                    break;
+                default: break;
+            }
+        }
+
+        if (lastWindow) break;
+        carried = (size_t)(end - parseEnd);
+        memmove(window.data(), parseEnd, carried);
+    }
+    fclose(input);
+    window = std::vector<char>();
+
+    bool written = vertexWriter.close() & textureCoordinateWriter.close() & faceWriter.close() & normalWriter.close();
+    if (lineTooLong || !written) return false;
+
+    mesh.vertexCount = vertexCount;
+    mesh.textureCoordinateCount = textureCoordinateCount;
+    mesh.triangleCount = triangleCount;
+    for (int i = 0; i < 3; i++) {
+        mesh.minimum[i] = minimum[i];
+        mesh.maximum[i] = maximum[i];
+        mesh.center[i] = (minimum[i] + maximum[i]) / 2;
+    }
+    mesh.diagonalLength = (float)sqrt(pow(maximum[0] - minimum[0], 2.0) + pow(maximum[1] - minimum[1], 2.0) +
+                                      pow(maximum[2] - minimum[2], 2.0));
+    return mesh.vertices.open(mesh.backingFileNames[0]) && mesh.textureCoordinates.open(mesh.backingFileNames[1]) &&
+           mesh.faces.open(mesh.backingFileNames[2]) && mesh.faceNormals.open(mesh.backingFileNames[3]);
+}
@@ -0,0 +1,349 @@
+// Binary little-endian PLY import and export.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "../include/mappedFile.h"
+#include "../include/plyLoader.h"
+
+namespace {
+
+enum PLYType { PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+struct PLYProperty
+{
+    std::string name;
+    PLYType type = PLY_INVALID;
+    bool isList = false;
+    PLYType countType = PLY_INVALID; // list length type, for list properties
+};
+
+struct PLYElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PLYProperty> properties;
+};
+
+PLYType typeFromName(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+}
+
+size_t typeSize(PLYType type)
+{
+    switch (type) {
+        case PLY_INT8: case PLY_UINT8: return 1;
+        case PLY_INT16: case PLY_UINT16: return 2;
+        case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+        case PLY_FLOAT64: return 8;
+        default: return 0;
+    }
+}
+
+// Read one little-endian scalar as a double, p must have typeSize(type) bytes.
+double readScalar(const char *p, PLYType type)
+{
+    switch (type) {
+        case PLY_INT8: return (int8_t)*p;
+        case PLY_UINT8: return (uint8_t)*p;
+        case PLY_INT16: { int16_t value; memcpy(&value, p, 2); return value; }
+        case PLY_UINT16: { uint16_t value; memcpy(&value, p, 2); return value; }
+        case PLY_INT32: { int32_t value; memcpy(&value, p, 4); return value; }
+        case PLY_UINT32: { uint32_t value; memcpy(&value, p, 4); return value; }
+        case PLY_FLOAT32: { float value; memcpy(&value, p, 4); return value; }
+        case PLY_FLOAT64: { double value; memcpy(&value, p, 8); return value; }
+        default: return 0.0;
+    }
+}
+
+bool isLittleEndianHost()
+{
+    uint16_t probe = 1;
+    return *(const unsigned char *)&probe == 1;
+}
+
+/**
+ * Parse the ASCII header.
+ * @param dataStart Receives the offset of the first byte after "end_header\n".
+ */
+bool parseHeader(const char *begin, size_t size, std::vector<PLYElement>& elements, size_t& dataStart)
+{
+    const char *headerEnd = nullptr;
+    static const char endHeader[] = "end_header";
+    for (const char *p = begin; p + sizeof(endHeader) - 1 <= begin + size; p++) {
+        if ((p == begin || p[-1] == '\n') && memcmp(p, endHeader, sizeof(endHeader) - 1) == 0) {
+            headerEnd = p;
+            break;
+        }
+    }
+    if (!headerEnd) return false;
+    const char *newLine = (const char *)memchr(headerEnd, '\n', (size_t)(begin + size - headerEnd));
+    if (!newLine) return false;
+    dataStart = (size_t)(newLine + 1 - begin);
+
+    std::istringstream header(std::string(begin, headerEnd));
+    std::string line, keyword;
+    bool isPLY = false, isBinaryLittleEndian = false;
+    while (getline(header, line)) {
+        std::istringstream words(line);
+        if (!(words >> keyword)) continue;
+        if (keyword == "ply") isPLY = true;
+        else if (keyword == "format") {
+            std::string format;
+            words >> format;
+            isBinaryLittleEndian = format == "binary_little_endian";
+        }
+        else if (keyword == "element") {
+            PLYElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property" && !elements.empty()) {
+            PLYProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.isList = true;
+                property.countType = typeFromName(countType);
+                property.type = typeFromName(itemType);
+                if (property.countType == PLY_INVALID) return false;
+            }
+            else property.type = typeFromName(type);
+            words >> property.name;
+            if (property.type == PLY_INVALID) return false;
+            elements.back().properties.push_back(property);
+        }
+    }
+    return isPLY && isBinaryLittleEndian;
+}
+
+int findProperty(const PLYElement& element, const char *name)
+{
+    for (size_t i = 0; i < element.properties.size(); i++)
+        if (element.properties[i].name == name) return (int)i;
+    return -1;
+}
+
+/**
+ * Skip over an element the importer does not use.
+ * @return The position after the element, nullptr if the data ends early.
+ */
+const char *skipElement(const PLYElement& element, const char *p, const char *end)
+{
+    bool fixedSize = true;
+    size_t stride = 0;
+    for (const PLYProperty& property : element.properties) {
+        fixedSize = fixedSize && !property.isList;
+        stride += typeSize(property.type);
+    }
+    if (fixedSize) return (size_t)(end - p) / (stride ? stride : 1) >= element.count ? p + stride * element.count : nullptr;
+
+    for (size_t i = 0; i < element.count; i++) {
+        for (const PLYProperty& property : element.properties) {
+            if (property.isList) {
+                if ((size_t)(end - p) < typeSize(property.countType)) return nullptr;
+                auto length = (size_t)readScalar(p, property.countType);
+                p += typeSize(property.countType);
+                if ((size_t)(end - p) / typeSize(property.type) < length) return nullptr;
+                p += length * typeSize(property.type);
+            }
+            else {
+                if ((size_t)(end - p) < typeSize(property.type)) return nullptr;
+                p += typeSize(property.type);
+            }
+        }
+    }
+    return p;
+}
+
+const char *readVertices(const PLYElement& element, const char *p, const char *end,
+                         std::vector<float>& vertices, std::vector<float>& textureCoordinates)
+{
+    int x = findProperty(element, "x"), y = findProperty(element, "y"), z = findProperty(element, "z");
+    if (x < 0 || y < 0 || z < 0) return nullptr;
+    int u = findProperty(element, "u"), v = findProperty(element, "v");
+    if (u < 0 || v < 0) { u = findProperty(element, "s"); v = findProperty(element, "t"); }
+    if (u < 0 || v < 0) { u = findProperty(element, "texture_u"); v = findProperty(element, "texture_v"); }
+
+    // byte offset of every property within a vertex record
+    std::vector<size_t> offsets;
+    size_t stride = 0;
+    for (const PLYProperty& property : element.properties) {
+        if (property.isList) return nullptr;
+        offsets.push_back(stride);
+        stride += typeSize(property.type);
+    }
+    if ((size_t)(end - p) / stride < element.count) return nullptr;
+
+    vertices.resize(element.count * 3);
+    const auto& properties = element.properties;
+    if (properties.size() == 3 && x == 0 && y == 1 && z == 2 && properties[0].type == PLY_FLOAT32 &&
+        properties[1].type == PLY_FLOAT32 && properties[2].type == PLY_FLOAT32) {
+        // the vertex block already is the {x0, y0, z0, x1, ... } array
+        memcpy(vertices.data(), p, element.count * 12);
+        return p + element.count * 12;
+    }
+
+    bool hasTexture = u >= 0 && v >= 0;
+    if (hasTexture) textureCoordinates.resize(element.count * 2);
+    for (size_t i = 0; i < element.count; i++, p += stride) {
+        vertices[i * 3] = (float)readScalar(p + offsets[x], properties[x].type);
+        vertices[i * 3 + 1] = (float)readScalar(p + offsets[y], properties[y].type);
+        vertices[i * 3 + 2] = (float)readScalar(p + offsets[z], properties[z].type);
+        if (hasTexture) {
+            textureCoordinates[i * 2] = (float)readScalar(p + offsets[u], properties[u].type);
+            textureCoordinates[i * 2 + 1] = (float)readScalar(p + offsets[v], properties[v].type);
+        }
+    }
+    return p;
+}
+
+const char *readFaces(const PLYElement& element, const char *p, const char *end, std::vector<int>& faces)
+{
+    int indices = findProperty(element, "vertex_indices");
+    if (indices < 0) indices = findProperty(element, "vertex_index");
+    if (indices < 0 || !element.properties[indices].isList) return nullptr;
+    const PLYProperty& list = element.properties[indices];
+    size_t countSize = typeSize(list.countType), indexSize = typeSize(list.type);
+
+    // a record holds at least its list lengths and scalars, so a count the data cannot hold is rejected before
+    // reserving for it; the reservation assumes triangles, the smallest faces that are kept
+    size_t recordSize = 0;
+    for (const PLYProperty& property : element.properties) recordSize += typeSize(property.isList ? property.countType : property.type);
+    if ((size_t)(end - p) / recordSize < element.count) return nullptr;
+    faces.clear();
+    faces.reserve(std::min(element.count, (size_t)(end - p) / (countSize + 3 * indexSize)) * 3);
+    if (element.properties.size() == 1 && indexSize == 4 && (list.type == PLY_INT32 || list.type == PLY_UINT32)) {
+        // plain triangle lists: read the 3 indices of a record as one block
+        for (size_t i = 0; i < element.count; i++) {
+            if ((size_t)(end - p) < countSize) return nullptr;
+            auto length = (size_t)readScalar(p, list.countType);
+            p += countSize;
+            if ((size_t)(end - p) / 4 < length) return nullptr;
+            if (length == 3) {
+                size_t size = faces.size();
+                faces.resize(size + 3);
+                memcpy(&faces[size], p, 12);
+            }
+            else {
+                for (size_t j = 2; j < length; j++) {
+                    int32_t first, previous, current;
+                    memcpy(&first, p, 4);
+                    memcpy(&previous, p + (j - 1) * 4, 4);
+                    memcpy(&current, p + j * 4, 4);
+                    faces.push_back(first);
+                    faces.push_back(previous);
+                    faces.push_back(current);
+                }
+            }
+            p += length * 4;
+        }
+        return p;
+    }
+
+    for (size_t i = 0; i < element.count; i++) {
+        for (size_t k = 0; k < element.properties.size(); k++) {
+            const PLYProperty& property = element.properties[k];
+            if (!property.isList) {
+                if ((size_t)(end - p) < typeSize(property.type)) return nullptr;
+                p += typeSize(property.type);
+                continue;
+            }
+            if ((size_t)(end - p) < typeSize(property.countType)) return nullptr;
+            auto length = (size_t)readScalar(p, property.countType);
+            p += typeSize(property.countType);
+            if ((size_t)(end - p) / typeSize(property.type) < length) return nullptr;
+            if ((int)k == indices) {
+                // fan triangulation about the first vertex, as for OBJ faces
+                for (size_t j = 2; j < length; j++) {
+                    faces.push_back((int)readScalar(p, property.type));
+                    faces.push_back((int)readScalar(p + (j - 1) * indexSize, property.type));
+                    faces.push_back((int)readScalar(p + j * indexSize, property.type));
+                }
+            }
+            p += length * typeSize(property.type);
+        }
+    }
+    return p;
+}
+
+} // namespace
+
+bool loadPLYFile(const std::string& fileName, std::vector<float>& vertices,
+                 std::vector<float>& textureCoordinates, std::vector<int>& faces)
+{
+    vertices.clear();
+    textureCoordinates.clear();
+    faces.clear();
+    if (!isLittleEndianHost()) return false;
+
+    MappedFile file;
+    if (!file.open(fileName)) return false;
+    std::vector<PLYElement> elements;
+    size_t dataStart;
+    if (!parseHeader(file.data(), file.size(), elements, dataStart)) return false;
+
+    const char *p = file.data() + dataStart, *end = file.data() + file.size();
+    for (const PLYElement& element : elements) {
+        if (element.name == "vertex") p = readVertices(element, p, end, vertices, textureCoordinates);
+        else if (element.name == "face") p = readFaces(element, p, end, faces);
+        else p = skipElement(element, p, end);
+        if (!p) break;
+    }
+    // faces may only refer to the vertices read
+    auto vertexCount = (int64_t)(vertices.size() / 3);
+    bool valid = p && std::all_of(faces.begin(), faces.end(), [vertexCount](int index) { return index >= 0 && index < vertexCount; });
+    if (!valid) {
+        vertices.clear();
+        textureCoordinates.clear();
+        faces.clear();
+    }
+    return valid;
+}
+
+bool writePLYFile(const std::string& fileName, const std::vector<float>& vertices,
+                  const std::vector<float>& textureCoordinates, const std::vector<int>& faces)
+{
+    if (!isLittleEndianHost()) return false;
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file) return false;
+
+    size_t vertexCount = vertices.size() / 3, faceCount = faces.size() / 3;
+    bool hasTexture = textureCoordinates.size() == vertexCount * 2 && vertexCount > 0;
+    fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n"
+                  "property float x\nproperty float y\nproperty float z\n", vertexCount);
+    if (hasTexture) fprintf(file, "property float u\nproperty float v\n");
+    fprintf(file, "element face %zu\nproperty list uchar int vertex_indices\nend_header\n", faceCount);
+
+    bool written = true;
+    if (hasTexture) {
+        for (size_t i = 0; i < vertexCount && written; i++) {
+            float record[5] = { vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2],
+                                textureCoordinates[i * 2], textureCoordinates[i * 2 + 1] };
+            written = fwrite(record, sizeof(record), 1, file) == 1;
+        }
+    }
+    else written = fwrite(vertices.data(), 4, vertices.size(), file) == vertices.size();
+
+    char record[13];
+    record[0] = 3;
+    for (size_t i = 0; i < faceCount && written; i++) {
+        memcpy(record + 1, &faces[i * 3], 12);
+        written = fwrite(record, sizeof(record), 1, file) == 1;
+    }
+    return fclose(file) == 0 && written;
+}
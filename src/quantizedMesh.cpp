@@ -0,0 +1,121 @@
+// Compact meshes for drawing, see quantizedMesh.h.
+
+#include <algorithm>
+#include <cmath>
+
+#include "../include/quantizedMesh.h"
+
+using namespace std;
+
+namespace {
+
+// The code that decodes nearest to value as offset + scale * code, computed in double against the float offset and
+// scale the decoder uses.
+long quantize(float value, float offset, float scale, long lowest, long highest)
+{
+    return max(lowest, min(highest, lrint(((double)value - offset) / scale)));
+}
+
+// Encode unit vectors (count of them, 3 floats apart) octahedrally.
+void encodeNormals(const float *normals, size_t count, vector<short>& encoded)
+{
+    encoded.resize(count * 2);
+    for (size_t i = 0; i < count; i++) encodeOctahedral(normals + i * 3, encoded.data() + i * 2);
+}
+
+} // namespace
+
+size_t QuantizedMesh::bytes() const
+{
+    return (positions.size() + textureCoordinates.size() + faceNormals.size() + vertexNormals.size() + shortFaces.size()) * 2 +
+           faces.size() * 4;
+}
+
+void encodeOctahedral(const float *normal, short *encoded)
+{
+    float length = fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]);
+    if (length == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    float x = normal[0] / length, y = normal[1] / length;
+    if (normal[2] < 0.0f) {
+        float foldedX = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+    }
+
+    // rounding each coordinate on its own is not always closest once decoded, so try both neighbours of each
+    double bestCosine = -2.0;
+    for (int i = 0; i < 4; i++) {
+        short candidate[2] = {(short)max(-32767.0f, min(32767.0f, (i & 1 ? ceilf : floorf)(x * 32767.0f))),
+                              (short)max(-32767.0f, min(32767.0f, (i & 2 ? ceilf : floorf)(y * 32767.0f)))};
+        float decoded[3];
+        decodeOctahedral(candidate, decoded);
+        // in double: the float cosine of angles this small is 1
+        double cosine = ((double)decoded[0] * normal[0] + (double)decoded[1] * normal[1] + (double)decoded[2] * normal[2]) /
+                        sqrt((double)decoded[0] * decoded[0] + (double)decoded[1] * decoded[1] + (double)decoded[2] * decoded[2]);
+        if (cosine > bestCosine) {
+            bestCosine = cosine;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+void quantizeMesh(const Mesh& mesh, QuantizedMesh& quantized)
+{
+    quantized.vertexCount = mesh.vertexCount;
+    quantized.textureCoordinateCount = mesh.textureCoordinateCount;
+    quantized.faceCount = mesh.faceCount;
+
+    // positions, centred on their bounding box and scaled by its longest side
+    float minimum[3] = {0.0f, 0.0f, 0.0f}, maximum[3] = {0.0f, 0.0f, 0.0f};
+    if (mesh.vertexCount) {
+        copy(mesh.positions, mesh.positions + 3, minimum);
+        copy(mesh.positions, mesh.positions + 3, maximum);
+    }
+    for (size_t i = 0; i < mesh.vertexCount * 3; i++) {
+        minimum[i % 3] = min(minimum[i % 3], mesh.positions[i]);
+        maximum[i % 3] = max(maximum[i % 3], mesh.positions[i]);
+    }
+    float halfSide = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        quantized.positionOffset[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+        halfSide = max(halfSide, (maximum[axis] - minimum[axis]) * 0.5f);
+    }
+    quantized.positionScale = halfSide > 0.0f ? halfSide / 32767.0f : 1.0f;
+    quantized.positions.resize(mesh.vertexCount * 3);
+    for (size_t i = 0; i < mesh.vertexCount * 3; i++)
+        quantized.positions[i] = (short)quantize(mesh.positions[i], quantized.positionOffset[i % 3], quantized.positionScale, -32767, 32767);
+
+    // texture coordinates over their range
+    float low[2] = {0.0f, 0.0f}, high[2] = {0.0f, 0.0f};
+    if (mesh.textureCoordinateCount) {
+        copy(mesh.textureCoordinates, mesh.textureCoordinates + 2, low);
+        copy(mesh.textureCoordinates, mesh.textureCoordinates + 2, high);
+    }
+    for (size_t i = 0; i < mesh.textureCoordinateCount * 2; i++) {
+        low[i % 2] = min(low[i % 2], mesh.textureCoordinates[i]);
+        high[i % 2] = max(high[i % 2], mesh.textureCoordinates[i]);
+    }
+    for (int axis = 0; axis < 2; axis++) {
+        quantized.textureCoordinateOffset[axis] = low[axis];
+        quantized.textureCoordinateScale[axis] = (high[axis] - low[axis]) / 65535.0f;
+    }
+    quantized.textureCoordinates.resize(mesh.textureCoordinateCount * 2);
+    for (size_t i = 0; i < mesh.textureCoordinateCount * 2; i++) {
+        float scale = quantized.textureCoordinateScale[i % 2];
+        quantized.textureCoordinates[i] = scale > 0.0f ? (unsigned short)quantize(mesh.textureCoordinates[i], low[i % 2], scale, 0, 65535) : 0;
+    }
+
+    quantized.faceNormals.clear();
+    quantized.vertexNormals.clear();
+    if (mesh.faceNormals) encodeNormals(mesh.faceNormals, mesh.faceCount, quantized.faceNormals);
+    if (mesh.vertexNormals) encodeNormals(mesh.vertexNormals, mesh.vertexCount, quantized.vertexNormals);
+
+    quantized.shortFaces.clear();
+    quantized.faces.clear();
+    if (mesh.vertexCount <= 65536) quantized.shortFaces.assign(mesh.faces, mesh.faces + mesh.faceCount * 3);
+    else quantized.faces.assign(mesh.faces, mesh.faces + mesh.faceCount * 3);
+}
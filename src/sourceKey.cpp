@@ -0,0 +1,50 @@
+// Size, modification time and content hash of asset source files.
+
+#include <sys/stat.h>
+
+#include "../include/mappedFile.h"
+#include "../include/sourceKey.h"
+
+namespace {
+
+bool fileStamp(const std::string& fileName, uint64_t& size, int64_t& modificationTime)
+{
+#ifdef _WIN32
+    struct _stat64 fileStat;
+    if (_stat64(fileName.c_str(), &fileStat) != 0) return false;
+#else
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) return false;
+#endif
+    size = (uint64_t)fileStat.st_size;
+    modificationTime = (int64_t)fileStat.st_mtime;
+    return true;
+}
+
+bool fileHash(const std::string& fileName, uint64_t& hash)
+{
+    MappedFile file;
+    if (!file.open(fileName)) return false;
+    hash = 14695981039346656037ull;
+    auto *p = (const unsigned char *)file.data();
+    for (size_t i = 0; i < file.size(); i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return true;
+}
+
+} // namespace
+
+bool makeSourceKey(const std::string& fileName, SourceKey& key)
+{
+    return fileStamp(fileName, key.size, key.modificationTime) && fileHash(fileName, key.hash);
+}
+
+bool sourceKeyMatches(const SourceKey& key, const std::string& fileName)
+{
+    uint64_t size, hash;
+    int64_t modificationTime;
+    if (!fileStamp(fileName, size, modificationTime) || size != key.size) return false;
+    return modificationTime == key.modificationTime || (fileHash(fileName, hash) && hash == key.hash);
+}
@@ -0,0 +1,171 @@
+// Padded texture atlases assembled from processed textures, see textureAtlas.h.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../include/textureAtlas.h"
+
+namespace {
+
+// Pixels are copied in blocks: 4x4 texels of 8 bytes for BC1, single texels of 4 bytes for RGBA8.
+int blockSize(TextureFormat format)
+{
+    return format == TEXTURE_BC1 ? 4 : 1;
+}
+
+size_t blockBytes(TextureFormat format)
+{
+    return format == TEXTURE_BC1 ? 8 : 4;
+}
+
+// Read one texel of a level as RGBA, decoding its BC1 block.
+void fetchTexel(TextureFormat format, const unsigned char *level, int width, int x, int y, unsigned char *rgba)
+{
+    if (format == TEXTURE_RGBA8) {
+        memcpy(rgba, level + 4 * ((size_t)width * y + x), 4);
+        return;
+    }
+    unsigned char texels[64];
+    decodeBC1(level + 8 * ((size_t)((width + 3) / 4) * (y / 4) + x / 4), 4, 4, texels);
+    memcpy(rgba, texels + 4 * (4 * (y % 4) + x % 4), 4);
+}
+
+// Shelf packing of padded cells into rows of the given width. Returns the height used.
+int packShelves(const std::vector<int>& widths, const std::vector<int>& heights, const std::vector<int>& order,
+                int atlasWidth, std::vector<AtlasEntry>& cells)
+{
+    int x = 0, y = 0, shelfHeight = 0;
+    for (int i : order) {
+        if (x + widths[i] > atlasWidth) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        cells[i] = {x, y, widths[i], heights[i]};
+        x += widths[i];
+        shelfHeight = std::max(shelfHeight, heights[i]);
+    }
+    return y + shelfHeight;
+}
+
+} // namespace
+
+int textureAtlasAlignment(TextureFormat format, int levelCount)
+{
+    return blockSize(format) << (levelCount - 1);
+}
+
+bool buildTextureAtlas(const std::vector<const ProcessedTexture *>& textures, int levelCount, TextureAtlas& atlas)
+{
+    if (textures.empty() || levelCount < 1) return false;
+    TextureFormat format = textures[0]->format;
+    int alignment = textureAtlasAlignment(format, levelCount);
+    for (const ProcessedTexture *texture : textures)
+        if (texture->format != format || (int)texture->levels.size() < levelCount ||
+            texture->levels[0].width % alignment || texture->levels[0].height % alignment)
+            return false;
+
+    // cells are the textures plus a gutter of one alignment on every side; try every atlas width from the
+    // widest cell to all cells in one row and keep the smallest area
+    size_t count = textures.size();
+    std::vector<int> widths(count), heights(count), order(count);
+    int widest = 0, totalWidth = 0;
+    for (size_t i = 0; i < count; i++) {
+        widths[i] = textures[i]->levels[0].width + 2 * alignment;
+        heights[i] = textures[i]->levels[0].height + 2 * alignment;
+        widest = std::max(widest, widths[i]);
+        totalWidth += widths[i];
+        order[i] = (int)i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return heights[a] > heights[b]; });
+    std::vector<AtlasEntry> cells(count);
+    int atlasWidth = widest, atlasHeight = packShelves(widths, heights, order, widest, cells);
+    for (int width = widest + alignment; width <= totalWidth; width += alignment) {
+        int height = packShelves(widths, heights, order, width, cells);
+        if ((double)width * height < (double)atlasWidth * atlasHeight) {
+            atlasWidth = width;
+            atlasHeight = height;
+        }
+    }
+    packShelves(widths, heights, order, atlasWidth, cells);
+
+    atlas.entries.resize(count);
+    for (size_t i = 0; i < count; i++)
+        atlas.entries[i] = {cells[i].x + alignment, cells[i].y + alignment,
+                            textures[i]->levels[0].width, textures[i]->levels[0].height};
+
+    ProcessedTexture& texture = atlas.texture;
+    texture.format = format;
+    texture.levels.clear();
+    size_t total = 0;
+    for (int level = 0; level < levelCount; level++) {
+        int width = atlasWidth >> level, height = atlasHeight >> level;
+        texture.levels.push_back({width, height, total, textureLevelSize(format, width, height)});
+        total += texture.levels.back().size;
+    }
+    texture.data.assign(total, 0);
+
+    int size = blockSize(format);
+    size_t bytes = blockBytes(format);
+    unsigned char texels[64];
+    for (int level = 0; level < levelCount; level++) {
+        const TextureLevel& out = texture.levels[level];
+        unsigned char *outData = texture.data.data() + out.offset;
+        size_t outBlocksPerRow = (size_t)out.width / size;
+        for (size_t i = 0; i < count; i++) {
+            const TextureLevel& in = textures[i]->levels[level];
+            const unsigned char *inData = textures[i]->data.data() + in.offset;
+            size_t inBlocksPerRow = (size_t)in.width / size;
+            int x = atlas.entries[i].x >> level, y = atlas.entries[i].y >> level, gutter = alignment >> level;
+
+            // the texture itself, a row of blocks at a time
+            for (int row = 0; row < in.height / size; row++)
+                memcpy(outData + (outBlocksPerRow * (y / size + row) + x / size) * bytes,
+                       inData + inBlocksPerRow * row * bytes, inBlocksPerRow * bytes);
+
+            // the gutter repeats the nearest edge texel
+            for (int blockY = (y - gutter) / size; blockY < (y + in.height + gutter) / size; blockY++)
+                for (int blockX = (x - gutter) / size; blockX < (x + in.width + gutter) / size; blockX++) {
+                    if (blockX * size >= x && blockX * size < x + in.width && blockY * size >= y && blockY * size < y + in.height)
+                        continue;
+                    for (int texelY = 0; texelY < size; texelY++)
+                        for (int texelX = 0; texelX < size; texelX++)
+                            fetchTexel(format, inData, in.width,
+                                       std::min(std::max(blockX * size + texelX - x, 0), in.width - 1),
+                                       std::min(std::max(blockY * size + texelY - y, 0), in.height - 1),
+                                       texels + 4 * (size * texelY + texelX));
+                    unsigned char *block = outData + (outBlocksPerRow * blockY + blockX) * bytes;
+                    if (format == TEXTURE_BC1) encodeBC1(texels, 4, 4, block);
+                    else memcpy(block, texels, 4);
+                }
+        }
+    }
+    return true;
+}
+
+void atlasTextureCoordinate(const TextureAtlas& atlas, int entry, float u, float v, float& atlasU, float& atlasV)
+{
+    const AtlasEntry& placed = atlas.entries[entry];
+    atlasU = (placed.x + u * placed.width) / atlas.texture.levels[0].width;
+    atlasV = (placed.y + v * placed.height) / atlas.texture.levels[0].height;
+}
+
+bool remapTextureCoordinates(const TextureAtlas& atlas, int entry, float *textureCoordinates, size_t count)
+{
+    if (count == 0) return true;
+    float minimum[2] = {textureCoordinates[0], textureCoordinates[1]}, maximum[2] = {minimum[0], minimum[1]};
+    for (size_t i = 0; i < count * 2; i++) {
+        minimum[i % 2] = std::min(minimum[i % 2], textureCoordinates[i]);
+        maximum[i % 2] = std::max(maximum[i % 2], textureCoordinates[i]);
+    }
+    float tile[2];
+    for (int axis = 0; axis < 2; axis++) {
+        tile[axis] = std::floor(minimum[axis]);
+        if (maximum[axis] - tile[axis] > 1.0f + 1e-4f) return false;
+    }
+    for (size_t i = 0; i < count * 2; i += 2)
+        atlasTextureCoordinate(atlas, entry, textureCoordinates[i] - tile[0], textureCoordinates[i + 1] - tile[1],
+                               textureCoordinates[i], textureCoordinates[i + 1]);
+    return true;
+}
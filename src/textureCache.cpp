@@ -0,0 +1,123 @@
+// Baked texture files, see textureCache.h for the format.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../include/mappedFile.h"
+#include "../include/sourceKey.h"
+#include "../include/textureCache.h"
+
+namespace {
+
+const char textureCacheMagic[8] = {'O', 'G', 'A', 'T', 'E', 'X', '\0', '\0'};
+
+struct TextureCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // 0x01020304 written natively
+    SourceKey source;
+    uint32_t format; // TextureFormat
+    uint32_t levelCount; // TextureCacheLevel entries following the header
+    uint64_t dataOffset; // pixels of all levels, 16 byte aligned
+};
+
+struct TextureCacheLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // from dataOffset
+    uint64_t size;
+};
+
+// Map a baked texture and check that it is a valid bake of the source image.
+bool openTextureCache(const std::string& cacheFileName, const std::string& sourceFileName,
+                      MappedFile& file, TextureCacheHeader& header)
+{
+    if (!file.open(cacheFileName) || file.size() < sizeof(TextureCacheHeader)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, textureCacheMagic, sizeof(textureCacheMagic)) != 0 ||
+        header.version != TEXTURE_CACHE_VERSION || header.byteOrder != 0x01020304u ||
+        (header.format != TEXTURE_RGBA8 && header.format != TEXTURE_BC1) || header.levelCount == 0 ||
+        header.levelCount > 32 || header.dataOffset > file.size() ||
+        sizeof(header) + header.levelCount * sizeof(TextureCacheLevel) > header.dataOffset)
+        return false;
+
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        TextureCacheLevel level;
+        memcpy(&level, file.data() + sizeof(header) + i * sizeof(level), sizeof(level));
+        if (level.size != textureLevelSize((TextureFormat)header.format, (int)level.width, (int)level.height) ||
+            level.offset > file.size() - header.dataOffset || level.size > file.size() - header.dataOffset - level.offset)
+            return false;
+    }
+    return sourceKeyMatches(header.source, sourceFileName);
+}
+
+} // namespace
+
+std::string textureCacheFileName(const std::string& sourceFileName)
+{
+    size_t slash = sourceFileName.find_last_of("/\\");
+    return (slash == std::string::npos ? sourceFileName : sourceFileName.substr(slash + 1)) + ".texcache";
+}
+
+bool isTextureCacheCurrent(const std::string& cacheFileName, const std::string& sourceFileName, TextureFormat format)
+{
+    MappedFile file;
+    TextureCacheHeader header;
+    return openTextureCache(cacheFileName, sourceFileName, file, header) && header.format == (uint32_t)format;
+}
+
+bool readTextureCache(const std::string& cacheFileName, const std::string& sourceFileName, ProcessedTexture& texture)
+{
+    MappedFile file;
+    TextureCacheHeader header;
+    if (!openTextureCache(cacheFileName, sourceFileName, file, header)) return false;
+
+    texture.format = (TextureFormat)header.format;
+    texture.levels.clear();
+    size_t total = 0;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        TextureCacheLevel level;
+        memcpy(&level, file.data() + sizeof(header) + i * sizeof(level), sizeof(level));
+        texture.levels.push_back({(int)level.width, (int)level.height, (size_t)level.offset, (size_t)level.size});
+        total = std::max(total, (size_t)(level.offset + level.size));
+    }
+    texture.data.assign(file.data() + header.dataOffset, file.data() + header.dataOffset + total);
+    return true;
+}
+
+bool writeTextureCache(const std::string& cacheFileName, const std::string& sourceFileName, const ProcessedTexture& texture)
+{
+    TextureCacheHeader header = {};
+    memcpy(header.magic, textureCacheMagic, sizeof(textureCacheMagic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.byteOrder = 0x01020304u;
+    if (!makeSourceKey(sourceFileName, header.source)) return false;
+    header.format = (uint32_t)texture.format;
+    header.levelCount = (uint32_t)texture.levels.size();
+    size_t tableEnd = sizeof(header) + texture.levels.size() * sizeof(TextureCacheLevel);
+    header.dataOffset = (tableEnd + 15) / 16 * 16;
+
+    std::string temporaryFileName = cacheFileName + ".tmp";
+    FILE *file = fopen(temporaryFileName.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (const TextureLevel& level : texture.levels) {
+        TextureCacheLevel entry = {(uint32_t)level.width, (uint32_t)level.height, level.offset, level.size};
+        written = written && fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+    const char padding[16] = {};
+    written = written && fwrite(padding, 1, header.dataOffset - tableEnd, file) == header.dataOffset - tableEnd &&
+              fwrite(texture.data.data(), 1, texture.data.size(), file) == texture.data.size();
+    written = fclose(file) == 0 && written;
+
+    remove(cacheFileName.c_str()); // rename does not replace an existing file on Windows
+    if (!written || rename(temporaryFileName.c_str(), cacheFileName.c_str()) != 0) {
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
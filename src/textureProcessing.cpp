@@ -0,0 +1,266 @@
+// Mip chain generation and BC1 encoding, see textureProcessing.h.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "../include/cpuFeatures.h"
+#include "../include/textureProcessing.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Average 2x2 pixels of row0 and row1 into each output pixel, rounding to nearest.
+void downsampleRowScalar(const unsigned char *row0, const unsigned char *row1, unsigned char *out,
+                         int first, int outWidth, int inWidth)
+{
+    for (int x = first; x < outWidth; x++) {
+        const unsigned char *a = row0 + 8 * x, *b = row1 + 8 * x;
+        int next = 2 * x + 1 < inWidth ? 4 : 0;
+        for (int c = 0; c < 4; c++)
+            out[4 * x + c] = (unsigned char)((a[c] + a[c + next] + b[c] + b[c + next] + 2) >> 2);
+    }
+}
+
+#ifdef CPU_X86
+/**
+ * 2 output pixels per step: the 4 input pixels of each row are widened to 16 bits, the rows added,
+ * then each pair of neighbouring pixels. Only used where both columns of a pair exist.
+ * @return Number of pixels written.
+ */
+TARGET_SSSE3 int downsampleRowSSSE3(const unsigned char *row0, const unsigned char *row1, unsigned char *out,
+                                    int outWidth, int inWidth)
+{
+    const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+    int x = 0;
+    for (; x + 2 <= outWidth && 2 * x + 4 <= inWidth; x += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(row0 + 8 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(row1 + 8 * x));
+        __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+        high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+        __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), two), 2);
+        _mm_storel_epi64((__m128i *)(out + 4 * x), _mm_packus_epi16(sum, sum));
+    }
+    return x;
+}
+
+/**
+ * As downsampleRowSSSE3 with 4 output pixels per step, one pair in each 128 bit lane.
+ */
+TARGET_AVX2 int downsampleRowAVX2(const unsigned char *row0, const unsigned char *row1, unsigned char *out,
+                                  int outWidth, int inWidth)
+{
+    const __m256i zero = _mm256_setzero_si256(), two = _mm256_set1_epi16(2);
+    int x = 0;
+    for (; x + 4 <= outWidth && 2 * x + 8 <= inWidth; x += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + 8 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + 8 * x));
+        __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+        __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+        low = _mm256_add_epi16(low, _mm256_srli_si256(low, 8));
+        high = _mm256_add_epi16(high, _mm256_srli_si256(high, 8));
+        __m256i sum = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(low, high), two), 2);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0x08); // qwords 0 and 2
+        _mm_storeu_si128((__m128i *)(out + 4 * x), _mm256_castsi256_si128(packed));
+    }
+    return x;
+}
+#endif
+
+void downsample(const unsigned char *in, int inWidth, int inHeight, unsigned char *out, int outWidth, int outHeight)
+{
+#ifdef CPU_X86
+    SIMDLevel level = activeSIMDLevel();
+#endif
+    for (int y = 0; y < outHeight; y++) {
+        const unsigned char *row0 = in + (size_t)4 * inWidth * (2 * y);
+        const unsigned char *row1 = in + (size_t)4 * inWidth * std::min(2 * y + 1, inHeight - 1);
+        unsigned char *outRow = out + (size_t)4 * outWidth * y;
+        int done = 0;
+#ifdef CPU_X86
+        if (level >= SIMD_AVX2) done = downsampleRowAVX2(row0, row1, outRow, outWidth, inWidth);
+        if (level >= SIMD_SSSE3) done += downsampleRowSSSE3(row0 + 8 * done, row1 + 8 * done, outRow + 4 * done,
+                                                            outWidth - done, inWidth - 2 * done);
+#endif
+        downsampleRowScalar(row0, row1, outRow, done, outWidth, inWidth);
+    }
+}
+
+uint16_t packRGB565(const int *rgb)
+{
+    return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | (rgb[2] * 31 + 127) / 255);
+}
+
+void unpackRGB565(uint16_t packed, int *rgb)
+{
+    int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    rgb[0] = r << 3 | r >> 2;
+    rgb[1] = g << 2 | g >> 4;
+    rgb[2] = b << 3 | b >> 2;
+}
+
+void storeUint16(unsigned char *p, uint16_t value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+/**
+ * Encode one 4x4 block of RGBA pixels (row by row, 16 pixels) into 8 bytes. End points are the corners
+ * of the colour bounding box, on the diagonal that follows the block's colour correlation and inset by
+ * 1/16 of the range, as in van Waveren's real-time DXT compression; each pixel then takes the nearest
+ * of the 4 palette colours.
+ */
+void encodeBlock(const unsigned char *block, unsigned char *out)
+{
+    int minimum[3] = {255, 255, 255}, maximum[3] = {0, 0, 0}, mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++) {
+            minimum[c] = std::min(minimum[c], (int)block[4 * i + c]);
+            maximum[c] = std::max(maximum[c], (int)block[4 * i + c]);
+            mean[c] += block[4 * i + c];
+        }
+
+    // red and blue run against green: swap their ends so the end points lie on the right diagonal
+    int covarianceRG = 0, covarianceBG = 0;
+    for (int i = 0; i < 16; i++) {
+        int g = 16 * block[4 * i + 1] - mean[1];
+        covarianceRG += (16 * block[4 * i] - mean[0]) * g;
+        covarianceBG += (16 * block[4 * i + 2] - mean[2]) * g;
+    }
+    if (covarianceRG < 0) std::swap(minimum[0], maximum[0]);
+    if (covarianceBG < 0) std::swap(minimum[2], maximum[2]);
+    for (int c = 0; c < 3; c++) {
+        int inset = (maximum[c] - minimum[c]) / 16;
+        maximum[c] -= inset;
+        minimum[c] += inset;
+    }
+
+    uint16_t color0 = packRGB565(maximum), color1 = packRGB565(minimum);
+    if (color0 < color1) std::swap(color0, color1); // color0 > color1 selects the 4 colour mode
+    storeUint16(out, color0);
+    storeUint16(out + 2, color1);
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int distance = 0;
+                for (int c = 0; c < 3; c++) {
+                    int difference = block[4 * i + c] - palette[p][c];
+                    distance += difference * difference;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    for (int i = 0; i < 4; i++) out[4 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+} // namespace
+
+size_t textureLevelSize(TextureFormat format, int width, int height)
+{
+    if (format == TEXTURE_BC1) return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+    return (size_t)width * height * 4;
+}
+
+void buildMipChain(const imageFile *image, ProcessedTexture& texture)
+{
+    texture.format = TEXTURE_RGBA8;
+    texture.levels.clear();
+    size_t total = 0;
+    for (int width = image->width, height = image->height;; width = std::max(1, width / 2), height = std::max(1, height / 2)) {
+        texture.levels.push_back({width, height, total, textureLevelSize(TEXTURE_RGBA8, width, height)});
+        total += texture.levels.back().size;
+        if (width == 1 && height == 1) break;
+    }
+    texture.data.resize(total);
+    memcpy(texture.data.data(), image->data, texture.levels[0].size);
+    for (size_t i = 1; i < texture.levels.size(); i++) {
+        const TextureLevel& in = texture.levels[i - 1];
+        const TextureLevel& out = texture.levels[i];
+        downsample(texture.data.data() + in.offset, in.width, in.height,
+                   texture.data.data() + out.offset, out.width, out.height);
+    }
+}
+
+void encodeBC1(const unsigned char *rgba, int width, int height, unsigned char *out)
+{
+    unsigned char block[64];
+    for (int blockY = 0; blockY < height; blockY += 4)
+        for (int blockX = 0; blockX < width; blockX += 4, out += 8) {
+            for (int y = 0; y < 4; y++) {
+                const unsigned char *row = rgba + (size_t)4 * width * std::min(blockY + y, height - 1);
+                for (int x = 0; x < 4; x++)
+                    memcpy(block + 16 * y + 4 * x, row + 4 * std::min(blockX + x, width - 1), 4);
+            }
+            encodeBlock(block, out);
+        }
+}
+
+void decodeBC1(const unsigned char *blocks, int width, int height, unsigned char *rgba)
+{
+    for (int blockY = 0; blockY < height; blockY += 4)
+        for (int blockX = 0; blockX < width; blockX += 4, blocks += 8) {
+            uint16_t color0 = (uint16_t)(blocks[0] | blocks[1] << 8), color1 = (uint16_t)(blocks[2] | blocks[3] << 8);
+            int palette[4][4];
+            unpackRGB565(color0, palette[0]);
+            unpackRGB565(color1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                if (color0 > color1) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            palette[0][3] = palette[1][3] = palette[2][3] = 255;
+            palette[3][3] = color0 > color1 ? 255 : 0;
+
+            uint32_t indices = blocks[4] | blocks[5] << 8 | blocks[6] << 16 | (uint32_t)blocks[7] << 24;
+            for (int y = 0; y < 4 && blockY + y < height; y++)
+                for (int x = 0; x < 4 && blockX + x < width; x++) {
+                    const int *color = palette[(indices >> (2 * (4 * y + x))) & 3];
+                    unsigned char *pixel = rgba + 4 * ((size_t)width * (blockY + y) + blockX + x);
+                    for (int c = 0; c < 4; c++) pixel[c] = (unsigned char)color[c];
+                }
+        }
+}
+
+void convertTexture(ProcessedTexture& texture, TextureFormat format)
+{
+    if (texture.format == format) return;
+    std::vector<unsigned char> data;
+    size_t total = 0;
+    for (TextureLevel& level : texture.levels) total += textureLevelSize(format, level.width, level.height);
+    data.resize(total);
+    total = 0;
+    for (TextureLevel& level : texture.levels) {
+        if (format == TEXTURE_BC1) encodeBC1(texture.data.data() + level.offset, level.width, level.height, data.data() + total);
+        else decodeBC1(texture.data.data() + level.offset, level.width, level.height, data.data() + total);
+        level.offset = total;
+        level.size = textureLevelSize(format, level.width, level.height);
+        total += level.size;
+    }
+    texture.data.swap(data);
+    texture.format = format;
+}
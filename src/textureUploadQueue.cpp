@@ -0,0 +1,168 @@
+// Texture uploads through a persistently mapped pixel buffer ring, see textureUploadQueue.h.
+
+#include <cstdint>
+#include <cstring>
+
+#include "../include/textureUploadQueue.h"
+
+namespace {
+
+const size_t ringAlignment = 16;
+
+} // namespace
+
+bool TextureUploadQueue::create(size_t ringBytes)
+{
+    destroy();
+    if (!GLEW_ARB_buffer_storage || !GLEW_ARB_sync) return false;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)ringBytes, nullptr, flags);
+    mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)ringBytes, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!mapped) {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        return false;
+    }
+    ringSize = ringBytes / ringAlignment * ringAlignment;
+    head = used = 0;
+    return true;
+}
+
+void TextureUploadQueue::destroy()
+{
+    retire(true);
+    pending.clear();
+    if (buffer) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    ringSize = head = used = 0;
+}
+
+void TextureUploadQueue::enqueue(GLuint texture, std::weak_ptr<const void> owner, GLenum bindTarget,
+                                 std::vector<TextureUpload> uploads, std::shared_ptr<const void> pixels,
+                                 std::function<void()> onReady)
+{
+    Job job;
+    job.texture = texture;
+    job.owner = std::move(owner);
+    job.bindTarget = bindTarget;
+    job.uploads = std::move(uploads);
+    job.pixels = std::move(pixels);
+    job.onReady = std::move(onReady);
+    pending.push_back(std::move(job));
+    counters.texturesQueued++;
+}
+
+bool TextureUploadQueue::allocate(size_t size, size_t& offset, Batch& batch)
+{
+    size_t skipped = head + size > ringSize ? ringSize - head : 0; // the level must not wrap around the ring end
+    if (used + skipped + size > ringSize) return false;
+    offset = skipped ? 0 : head;
+    head = (offset + size + ringAlignment - 1) / ringAlignment * ringAlignment;
+    size_t reserved = skipped + (head - offset);
+    if (head >= ringSize) {
+        reserved -= head - ringSize;
+        head = 0;
+    }
+    used += reserved;
+    batch.bytes += reserved;
+    return true;
+}
+
+void TextureUploadQueue::retire(bool wait)
+{
+    while (!inFlight.empty()) {
+        Batch& batch = inFlight.front();
+        if (batch.fence) {
+            GLenum status = glClientWaitSync(batch.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                             wait ? 1000000000ull : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                if (!wait || status == GL_WAIT_FAILED) break;
+                continue; // timed out while waiting, wait again
+            }
+            glDeleteSync(batch.fence);
+        }
+        used -= batch.bytes;
+        for (std::function<void()>& ready : batch.ready) {
+            counters.texturesReady++;
+            if (ready) ready();
+        }
+        inFlight.pop_front();
+    }
+    if (inFlight.empty()) head = used = 0;
+}
+
+void TextureUploadQueue::issue(const Job& job, const TextureUpload& upload, const void *source)
+{
+    glBindTexture(job.bindTarget, job.texture);
+    if (upload.format == 0)
+        glCompressedTexImage2D(upload.target, upload.level, upload.internalFormat, upload.width, upload.height, 0,
+                               (GLsizei)upload.size, source);
+    else
+        glTexImage2D(upload.target, upload.level, (GLint)upload.internalFormat, upload.width, upload.height, 0,
+                     upload.format, GL_UNSIGNED_BYTE, source);
+}
+
+void TextureUploadQueue::update(size_t byteBudget)
+{
+    retire(false);
+    if (pending.empty()) return;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    Batch batch;
+    size_t issued = 0;
+    while (!pending.empty() && issued < byteBudget) {
+        Job& job = pending.front();
+        if (job.owner.expired()) {
+            // the texture name was deleted with its owner and may have been reused
+            counters.texturesDropped++;
+            pending.pop_front();
+            continue;
+        }
+        if (job.uploads.empty()) {
+            batch.ready.push_back(std::move(job.onReady));
+            pending.pop_front();
+            continue;
+        }
+        const TextureUpload& upload = job.uploads[job.next];
+        size_t offset;
+        if (!mapped || upload.size > ringSize) {
+            // synchronous from client memory
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            issue(job, upload, upload.pixels);
+            counters.bytesDirect += upload.size;
+        }
+        else if (allocate(upload.size, offset, batch)) {
+            memcpy(mapped + offset, upload.pixels, upload.size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            issue(job, upload, (const void *)(uintptr_t)offset);
+            counters.bytesStaged += upload.size;
+        }
+        else {
+            counters.framesRingFull++;
+            break;
+        }
+        issued += upload.size;
+
+        if (++job.next == job.uploads.size()) {
+            batch.ready.push_back(std::move(job.onReady));
+            pending.pop_front();
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (batch.bytes || !batch.ready.empty()) {
+        if (mapped) batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        inFlight.push_back(std::move(batch));
+    }
+    if (!mapped) retire(false); // nothing to wait for
+}
@@ -0,0 +1,129 @@
+// Tests of the SIMD kernels of meshProcessing.cpp: face normals, area weights and bounding boxes computed with
+// SSE4.1 and AVX2 must be bit-identical to the scalar code's, for every tail length and for degenerate faces.
+// Levels the CPU does not have are skipped. Returns non-zero if a check fails.
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/cpuFeatures.h"
+#include "../include/mesh.h"
+#include "../include/meshProcessing.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool passed, const string& what)
+{
+    if (!passed) {
+        cout << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+/**
+ * A mesh of random triangles over vertexCount random vertices, with degenerate faces mixed in: faces with a repeated
+ * corner (no area, a zero normal divided by zero), faces whose corners are on one line, and faces whose corners are
+ * one point.
+ */
+void makeMesh(size_t vertexCount, size_t faceCount, unsigned int seed, Mesh& mesh)
+{
+    mt19937 random(seed);
+    uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+    mesh.allocate(vertexCount, 0, faceCount);
+    for (size_t i = 0; i < vertexCount * 3; i++) mesh.positions[i] = coordinate(random);
+    if (vertexCount >= 3) {
+        // vertices 0, 1 and 2 on one line
+        for (int axis = 0; axis < 3; axis++) mesh.positions[6 + axis] = 2.0f * mesh.positions[3 + axis] - mesh.positions[axis];
+    }
+    uniform_int_distribution<int> vertex(0, vertexCount ? (int)vertexCount - 1 : 0);
+    for (size_t face = 0; face < faceCount; face++) {
+        int *corners = mesh.faces + face * 3;
+        for (int corner = 0; corner < 3; corner++) corners[corner] = vertex(random);
+        switch (face % 7) {
+            case 2: corners[2] = corners[1]; break;
+            case 4: corners[1] = corners[2] = corners[0]; break;
+            case 5: if (vertexCount >= 3) corners[0] = 0, corners[1] = 1, corners[2] = 2; break;
+            default: break;
+        }
+    }
+}
+
+/**
+ * Compute the face normals and areas of a mesh at the scalar level and at each SIMD level the CPU has, and compare.
+ */
+void testFaceNormals(size_t faceCount, unsigned int seed)
+{
+    Mesh mesh;
+    makeMesh(64, faceCount, seed, mesh);
+    setSIMDLevelLimit(SIMD_SCALAR);
+    ComputeFaceNormals(mesh);
+    vector<float> normals(mesh.faceNormals, mesh.faceNormals + faceCount * 3), areas(mesh.faceAreas, mesh.faceAreas + faceCount);
+
+    for (SIMDLevel level : {SIMD_SSE41, SIMD_AVX2}) {
+        if (level > cpuSIMDLevel()) continue;
+        setSIMDLevelLimit(level);
+        mesh.releaseAttributes(MESH_ALL_ATTRIBUTES);
+        ComputeFaceNormals(mesh);
+        string what = string(simdLevelName(level)) + " face normals of " + to_string(faceCount) + " faces";
+        check(memcmp(mesh.faceNormals, normals.data(), normals.size() * sizeof(float)) == 0, what);
+        check(memcmp(mesh.faceAreas, areas.data(), areas.size() * sizeof(float)) == 0, what + ", areas");
+    }
+}
+
+/**
+ * Compute the bounding box of a mesh and centre it at the scalar level and at each SIMD level the CPU has, and
+ * compare the centred positions, the center and the diagonal.
+ */
+void testBoundingBox(size_t vertexCount, unsigned int seed)
+{
+    Mesh original;
+    makeMesh(vertexCount, 0, seed, original);
+    vector<float> positions(original.positions, original.positions + vertexCount * 3), centred;
+    float center[3], diagonalLength = 0.0f;
+
+    for (SIMDLevel level : {SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2}) {
+        if (level > cpuSIMDLevel()) continue;
+        setSIMDLevelLimit(level);
+        Mesh mesh;
+        mesh.allocate(vertexCount, 0, 0);
+        copy(positions.begin(), positions.end(), mesh.positions);
+        ComputeBoundingBox(mesh);
+        if (level == SIMD_SCALAR) {
+            centred.assign(mesh.positions, mesh.positions + vertexCount * 3);
+            memcpy(center, mesh.center, sizeof(center));
+            diagonalLength = mesh.diagonalLength;
+            continue;
+        }
+        string what = string(simdLevelName(level)) + " bounding box of " + to_string(vertexCount) + " vertices";
+        check(memcmp(mesh.positions, centred.data(), centred.size() * sizeof(float)) == 0, what + ", positions");
+        check(memcmp(mesh.center, center, sizeof(center)) == 0, what + ", center");
+        check(memcmp(&mesh.diagonalLength, &diagonalLength, sizeof(float)) == 0, what + ", diagonal");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    cout << "CPU SIMD level: " << simdLevelName(cpuSIMDLevel()) << endl;
+    // every tail after the 4 and 8 wide steps, then sizes well past them
+    for (size_t count = 0; count <= 33; count++) {
+        testFaceNormals(count, (unsigned int)count);
+        testBoundingBox(count, (unsigned int)count);
+    }
+    for (size_t count : {255, 1000, 4099}) {
+        testFaceNormals(count, (unsigned int)count);
+        testBoundingBox(count, (unsigned int)count);
+    }
+    setSIMDLevelLimit(SIMD_AVX2);
+
+    if (failures) cout << failures << " checks failed" << endl;
+    else cout << "SIMD face normals, areas and bounding boxes identical to the scalar code" << endl;
+    return failures ? 1 : 0;
+}
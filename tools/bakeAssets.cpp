@@ -0,0 +1,179 @@
+// Offline asset bake tool. Converts every OBJ or PLY model and BMP image under a directory into the
+// mesh cache and baked texture files that the viewer loads directly, one parallel job per file.
+//
+// Usage: bakeAssets [--force] [--jobs N] [--rgba] <input directory> [output directory]
+// The output directory defaults to the working directory, which is where the viewer looks for them.
+// Models are baked with their face and vertex normals. Images are baked with their mip chain in BC1, or in RGBA8 with --rgba.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/getBMP.h"
+#include "../include/meshCache.h"
+#include "../include/meshProcessing.h"
+#include "../include/textureCache.h"
+#include "../include/textureProcessing.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+enum AssetKind { ASSET_MODEL, ASSET_IMAGE };
+
+enum BakeStatus { BAKE_DONE, BAKE_UP_TO_DATE, BAKE_FAILED };
+
+static TextureFormat textureFormat = TEXTURE_BC1;
+
+struct BakeJob
+{
+    AssetKind kind;
+    string sourceFileName;
+    string bakedFileName;
+
+    // filled in by the worker
+    BakeStatus status = BAKE_FAILED;
+    double milliseconds = 0.0;
+};
+
+string lowerCaseExtension(const fs::path& path)
+{
+    string extension = path.extension().string();
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return extension;
+}
+
+/**
+ * Process a model exactly the way the viewer's loadOBJAndProcess() does and write its mesh cache, with the face and
+ * vertex normals the viewer would otherwise compute on its first draw.
+ */
+bool bakeModel(const BakeJob& job)
+{
+    Mesh mesh;
+    // files are already baked in parallel, so each file is parsed on a single thread
+    if (!loadMesh(job.sourceFileName, mesh, 1)) return false;
+    weldMesh(mesh, 1e-6f, 1);
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    ComputeBoundingBox(mesh);
+    requireFaceNormals(mesh);
+    requireVertexNormals(mesh, 1);
+    return writeMeshCache(job.bakedFileName, job.sourceFileName, mesh);
+}
+
+/**
+ * Decode an image with getBMP(), build its mip chain and write it as a baked texture, like the viewer's loadImage().
+ */
+bool bakeImage(const BakeJob& job)
+{
+    imageFile *image = getBMP(job.sourceFileName);
+    if (!image) return false;
+    ProcessedTexture texture;
+    buildMipChain(image, texture);
+    delete[] image->data;
+    delete image;
+    convertTexture(texture, textureFormat);
+    return writeTextureCache(job.bakedFileName, job.sourceFileName, texture);
+}
+
+void runJob(BakeJob& job, bool force)
+{
+    auto start = chrono::steady_clock::now();
+    bool upToDate = !force && (job.kind == ASSET_MODEL ? isMeshCacheCurrent(job.bakedFileName, job.sourceFileName)
+                                                       : isTextureCacheCurrent(job.bakedFileName, job.sourceFileName, textureFormat));
+    if (upToDate) job.status = BAKE_UP_TO_DATE;
+    else job.status = (job.kind == ASSET_MODEL ? bakeModel(job) : bakeImage(job)) ? BAKE_DONE : BAKE_FAILED;
+    job.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+uintmax_t fileSize(const string& fileName)
+{
+    error_code error;
+    uintmax_t size = fs::file_size(fileName, error);
+    return error ? 0 : size;
+}
+
+int main(int argc, char **argv)
+{
+    bool force = false;
+    unsigned int jobCount = max(1u, thread::hardware_concurrency());
+    vector<string> directories;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--force") force = true;
+        else if (argument == "--jobs" && i + 1 < argc) jobCount = max(1, atoi(argv[++i]));
+        else if (argument == "--rgba") textureFormat = TEXTURE_RGBA8;
+        else directories.push_back(argument);
+    }
+    if (directories.empty() || directories.size() > 2) {
+        cout << "Usage: bakeAssets [--force] [--jobs N] [--rgba] <input directory> [output directory]" << endl;
+        return 1;
+    }
+    fs::path outputDirectory = directories.size() > 1 ? directories[1] : ".";
+    error_code error;
+    fs::create_directories(outputDirectory, error);
+
+    // collect one job per asset file
+    vector<BakeJob> jobs;
+    map<string, string> bakedBy; // baked file name -> source, to catch two sources with the same file name
+    for (fs::recursive_directory_iterator entry(directories[0], error), end; !error && entry != end; entry.increment(error)) {
+        if (!entry->is_regular_file()) continue;
+        string extension = lowerCaseExtension(entry->path());
+        BakeJob job;
+        if (extension == ".obj" || extension == ".ply") job.kind = ASSET_MODEL;
+        else if (extension == ".bmp") job.kind = ASSET_IMAGE;
+        else continue;
+        job.sourceFileName = entry->path().string();
+        string bakedName = job.kind == ASSET_MODEL ? meshCacheFileName(job.sourceFileName)
+                                                   : textureCacheFileName(job.sourceFileName);
+        job.bakedFileName = (outputDirectory / bakedName).string();
+        if (bakedBy.count(bakedName)) {
+            cout << "Skipping " << job.sourceFileName << ": " << bakedBy[bakedName] << " is also baked as " << bakedName << endl;
+            continue;
+        }
+        bakedBy[bakedName] = job.sourceFileName;
+        jobs.push_back(job);
+    }
+    if (error) {
+        cout << "Cannot read " << directories[0] << ": " << error.message() << endl;
+        return 1;
+    }
+
+    // bake in parallel, every worker takes the next unclaimed file
+    auto start = chrono::steady_clock::now();
+    atomic<size_t> nextJob(0);
+    vector<thread> workers;
+    for (unsigned int i = 0; i < min<size_t>(jobCount, jobs.size()); i++)
+        workers.emplace_back([&] {
+            for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) runJob(jobs[j], force);
+        });
+    for (thread& worker : workers) worker.join();
+    double totalTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // report
+    const char *statusNames[] = {"baked", "up to date", "FAILED"};
+    int counts[3] = {0, 0, 0};
+    uintmax_t totalSource = 0, totalBaked = 0;
+    cout << left << setw(40) << "source" << setw(12) << "status" << right << setw(10) << "ms"
+         << setw(12) << "source KB" << setw(12) << "baked KB" << endl;
+    for (const BakeJob& job : jobs) {
+        uintmax_t sourceSize = fileSize(job.sourceFileName), bakedSize = fileSize(job.bakedFileName);
+        totalSource += sourceSize;
+        totalBaked += bakedSize;
+        counts[job.status]++;
+        cout << left << setw(40) << job.sourceFileName << setw(12) << statusNames[job.status] << right
+             << fixed << setprecision(2) << setw(10) << job.milliseconds
+             << setprecision(1) << setw(12) << sourceSize / 1024.0 << setw(12) << bakedSize / 1024.0 << endl;
+    }
+    cout << jobs.size() << " files: " << counts[BAKE_DONE] << " baked, " << counts[BAKE_UP_TO_DATE] << " up to date, "
+         << counts[BAKE_FAILED] << " failed, " << totalSource / 1024 << " KB in, " << totalBaked / 1024 << " KB out, "
+         << setprecision(1) << totalTime << " ms on " << workers.size() << " threads." << endl;
+    return counts[BAKE_FAILED] ? 1 : 0;
+}